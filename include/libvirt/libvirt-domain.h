@@ -1224,6 +1224,21 @@ typedef enum {
  */
 # define VIR_MIGRATE_PARAM_BANDWIDTH_AVAIL_SWITCHOVER "bandwidth.avail.switchover"
 
+/**
+ * VIR_MIGRATE_PARAM_DOWNTIME_MAX:
+ *
+ * virDomainMigrate* params field: the upper bound (in milliseconds) for
+ * automatically raising the maximum tolerable downtime (see
+ * virDomainMigrateSetMaxDowntime) as VIR_TYPED_PARAM_ULLONG. When set,
+ * the maximum tolerable downtime is doubled, up to this value, every time
+ * an iteration of (pre-copy) migration fails to reduce the amount of memory
+ * which still needs to be transferred. If set to 0 or omitted, the maximum
+ * tolerable downtime is never changed automatically.
+ *
+ * Since: 11.6.0
+ */
+# define VIR_MIGRATE_PARAM_DOWNTIME_MAX "downtime.max"
+
 /**
  * VIR_MIGRATE_PARAM_GRAPHICS_URI:
  *
@@ -5840,6 +5855,26 @@ typedef enum {
  */
 # define VIR_DOMAIN_JOB_VFIO_DATA_TRANSFERRED "vfio_data_transferred"
 
+/**
+ * VIR_DOMAIN_JOB_DOWNTIME_LIMIT:
+ * virDomainGetJobStats field: current maximum tolerable downtime (in
+ * milliseconds) of a migration started with VIR_MIGRATE_PARAM_DOWNTIME_MAX,
+ * as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 11.6.0
+ */
+# define VIR_DOMAIN_JOB_DOWNTIME_LIMIT "downtime_limit"
+
+/**
+ * VIR_DOMAIN_JOB_DOWNTIME_LIMIT_RAISES:
+ * virDomainGetJobStats field: number of times the maximum tolerable downtime
+ * was raised automatically because a migration started with
+ * VIR_MIGRATE_PARAM_DOWNTIME_MAX did not converge, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 11.6.0
+ */
+# define VIR_DOMAIN_JOB_DOWNTIME_LIMIT_RAISES "downtime_limit_raises"
+
 /**
  * virConnectDomainEventGenericCallback:
  * @conn: the connection pointer
@@ -6611,6 +6646,27 @@ typedef void (*virConnectDomainEventJobCompletedCallback)(virConnectPtr conn,
  */
 # define VIR_DOMAIN_TUNABLE_CPU_IOTHREAD_QUOTA "cputune.iothread_quota"
 
+/**
+ * VIR_DOMAIN_TUNABLE_NUMA_NODESET:
+ *
+ * Macro represents the host NUMA nodes the domain was automatically placed
+ * on, as VIR_TYPED_PARAM_STRING.
+ *
+ * Since: 11.6.0
+ */
+# define VIR_DOMAIN_TUNABLE_NUMA_NODESET "numatune.nodeset"
+
+/**
+ * VIR_DOMAIN_TUNABLE_NUMA_CPUSET:
+ *
+ * Macro represents the host CPUs the domain threads which are not pinned
+ * explicitly may run on after automatic NUMA placement, as
+ * VIR_TYPED_PARAM_STRING.
+ *
+ * Since: 11.6.0
+ */
+# define VIR_DOMAIN_TUNABLE_NUMA_CPUSET "numatune.cpuset"
+
 /**
  * VIR_DOMAIN_TUNABLE_BLKDEV_DISK:
  *
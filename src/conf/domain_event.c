@@ -714,6 +714,7 @@ virDomainEventRTCChangeNewFromDom(virDomainPtr dom,
         return NULL;
 
     ev->offset = offset;
+    virObjectEventSetCoalesce((virObjectEvent *)ev);
 
     return (virObjectEvent *)ev;
 }
@@ -733,6 +734,7 @@ virDomainEventRTCChangeNewFromObj(virDomainObj *obj,
         return NULL;
 
     ev->offset = offset;
+    virObjectEventSetCoalesce((virObjectEvent *)ev);
 
     return (virObjectEvent *)ev;
 }
@@ -1248,6 +1250,7 @@ virDomainEventBalloonChangeNewFromDom(virDomainPtr dom,
         return NULL;
 
     ev->actual = actual;
+    virObjectEventSetCoalesce((virObjectEvent *)ev);
 
     return (virObjectEvent *)ev;
 }
@@ -1266,6 +1269,7 @@ virDomainEventBalloonChangeNewFromObj(virDomainObj *obj,
         return NULL;
 
     ev->actual = actual;
+    virObjectEventSetCoalesce((virObjectEvent *)ev);
 
     return (virObjectEvent *)ev;
 }
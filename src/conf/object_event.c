@@ -28,6 +28,7 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virobject.h"
+#include "virhash.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -55,6 +56,10 @@ struct _virObjectEventCallbackList {
     unsigned int nextID;
     size_t count;
     virObjectEventCallback **callbacks;
+    /* Callbacks indexed by eventID and key, so that dispatching an
+     * event only has to look at callbacks it can match. The value is
+     * a GPtrArray kept in registration (callbackID) order. */
+    GHashTable *index;
 };
 
 struct _virObjectEventQueue {
@@ -138,6 +143,86 @@ virObjectEventCallbackFree(virObjectEventCallback *cb)
     g_free(cb);
 }
 
+static char *
+virObjectEventCallbackIndexName(int eventID,
+                                const char *key)
+{
+    if (key)
+        return g_strdup_printf("%d:%s", eventID, key);
+    return g_strdup_printf("%d", eventID);
+}
+
+
+/**
+ * virObjectEventCallbackIndexLookup:
+ * @cbList: the list
+ * @eventID: the event ID
+ * @key: the key of the object, or NULL for global callbacks
+ *
+ * Returns the array of callbacks registered for @eventID with
+ * exactly @key (or without a key), or NULL if there are none.
+ */
+static GPtrArray *
+virObjectEventCallbackIndexLookup(virObjectEventCallbackList *cbList,
+                                  int eventID,
+                                  const char *key)
+{
+    g_autofree char *name = virObjectEventCallbackIndexName(eventID, key);
+
+    return virHashLookup(cbList->index, name);
+}
+
+
+static void
+virObjectEventCallbackIndexAdd(virObjectEventCallbackList *cbList,
+                               virObjectEventCallback *cb)
+{
+    const char *key = cb->key_filter ? cb->key : NULL;
+    GPtrArray *bucket;
+
+    if (!(bucket = virObjectEventCallbackIndexLookup(cbList, cb->eventID, key))) {
+        bucket = g_ptr_array_new();
+        g_hash_table_insert(cbList->index,
+                            virObjectEventCallbackIndexName(cb->eventID, key),
+                            bucket);
+    }
+
+    g_ptr_array_add(bucket, cb);
+}
+
+
+static void
+virObjectEventCallbackIndexRemove(virObjectEventCallbackList *cbList,
+                                  virObjectEventCallback *cb)
+{
+    g_autofree char *name = NULL;
+    GPtrArray *bucket;
+
+    name = virObjectEventCallbackIndexName(cb->eventID,
+                                           cb->key_filter ? cb->key : NULL);
+
+    if (!(bucket = virHashLookup(cbList->index, name)))
+        return;
+
+    /* Keeps the order of the remaining callbacks */
+    g_ptr_array_remove(bucket, cb);
+
+    if (bucket->len == 0)
+        virHashRemoveEntry(cbList->index, name);
+}
+
+
+static virObjectEventCallbackList *
+virObjectEventCallbackListNew(void)
+{
+    virObjectEventCallbackList *list = g_new0(virObjectEventCallbackList, 1);
+
+    list->index = virHashNew((GDestroyNotify) g_ptr_array_unref);
+
+    return list;
+}
+
+
 /**
  * virObjectEventCallbackListFree:
  * @list: event callback list head
@@ -158,6 +243,7 @@ virObjectEventCallbackListFree(virObjectEventCallbackList *list)
         g_free(list->callbacks[i]);
     }
     g_free(list->callbacks);
+    g_clear_pointer(&list->index, g_hash_table_unref);
     g_free(list);
 }
 
@@ -247,6 +333,7 @@ virObjectEventCallbackListRemoveID(virConnectPtr conn,
              * function won't end up with a double free error */
             if (doFreeCb && cb->freecb)
                 (*cb->freecb)(cb->opaque);
+            virObjectEventCallbackIndexRemove(cbList, cb);
             virObjectEventCallbackFree(cb);
             VIR_DELETE_ELEMENT(cbList->callbacks, i, cbList->count);
             return ret;
@@ -296,6 +383,7 @@ virObjectEventCallbackListPurgeMarked(virObjectEventCallbackList *cbList)
             virFreeCallback freecb = cbList->callbacks[n]->freecb;
             if (freecb)
                 (*freecb)(cbList->callbacks[n]->opaque);
+            virObjectEventCallbackIndexRemove(cbList, cbList->callbacks[n]);
             virObjectEventCallbackFree(cbList->callbacks[n]);
 
             VIR_DELETE_ELEMENT(cbList->callbacks, n, cbList->count);
@@ -334,21 +422,22 @@ virObjectEventCallbackLookup(virConnectPtr conn,
                              bool legacy,
                              int *remoteID)
 {
+    GPtrArray *bucket;
     size_t i;
 
     if (remoteID)
         *remoteID = -1;
 
-    for (i = 0; i < cbList->count; i++) {
-        virObjectEventCallback *cb = cbList->callbacks[i];
+    if (!(bucket = virObjectEventCallbackIndexLookup(cbList, eventID, key)))
+        return -1;
+
+    for (i = 0; i < bucket->len; i++) {
+        virObjectEventCallback *cb = g_ptr_array_index(bucket, i);
 
         if (cb->deleted)
             continue;
         if (cb->klass == klass &&
-            cb->eventID == eventID &&
-            cb->conn == conn &&
-            ((key && cb->key_filter && STREQ(cb->key, key)) ||
-             (!key && !cb->key_filter))) {
+            cb->conn == conn) {
             if (remoteID)
                 *remoteID = cb->remoteID;
             if (cb->legacy == legacy &&
@@ -437,6 +526,7 @@ virObjectEventCallbackListAddID(virConnectPtr conn,
     cb->legacy = legacy;
 
     VIR_APPEND_ELEMENT(cbList->callbacks, cbList->count, cb);
+    virObjectEventCallbackIndexAdd(cbList, cb);
 
     /* When additional filtering is being done, every client callback
      * is matched to exactly one server callback.  */
@@ -553,7 +643,7 @@ virObjectEventStateNew(void)
     if (!(state = virObjectLockableNew(virObjectEventStateClass)))
         return NULL;
 
-    state->callbacks = g_new0(virObjectEventCallbackList, 1);
+    state->callbacks = virObjectEventCallbackListNew();
 
     if (!(state->queue = virObjectEventQueueNew()))
         goto error;
@@ -619,6 +709,57 @@ virObjectEventNew(virClass *klass,
 }
 
 
+/**
+ * virObjectEventSetCoalesce:
+ * @event: the event
+ *
+ * Mark @event as reporting the current value of something, which
+ * makes any older event of the same type for the same object still
+ * waiting in the queue obsolete. Such an event is dropped when @event
+ * is queued, which protects the event loop and clients from guests
+ * triggering high rate events. Queuing @event doesn't delay its
+ * delivery.
+ */
+void
+virObjectEventSetCoalesce(virObjectEvent *event)
+{
+    event->coalesce = true;
+}
+
+
+/**
+ * virObjectEventQueueCoalesce:
+ * @evtQueue: the object event queue
+ * @event: the event about to be added
+ *
+ * Internal function to drop an event superseded by @event from the
+ * queue. There's at most one such event, as the queue is coalesced
+ * on every push.
+ */
+static void
+virObjectEventQueueCoalesce(virObjectEventQueue *evtQueue,
+                            virObjectEvent *event)
+{
+    size_t i;
+
+    for (i = 0; i < evtQueue->count; i++) {
+        virObjectEvent *queued = evtQueue->events[i];
+
+        if (!queued->coalesce ||
+            queued->dispatch != event->dispatch ||
+            queued->eventID != event->eventID ||
+            queued->remoteID != event->remoteID ||
+            memcmp(queued->meta.uuid, event->meta.uuid, VIR_UUID_BUFLEN) != 0)
+            continue;
+
+        VIR_DEBUG("event=%p superseded by event=%p", queued, event);
+        virObjectUnref(queued);
+        VIR_DELETE_ELEMENT(evtQueue->events, i, evtQueue->count);
+        return;
+    }
+}
+
+
 /**
  * virObjectEventQueuePush:
  * @evtQueue: the object event queue
@@ -670,14 +811,39 @@ virObjectEventStateDispatchCallbacks(virObjectEventState *state,
                                      virObjectEvent *event,
                                      virObjectEventCallbackList *callbacks)
 {
-    size_t i;
-    /* Cache this now, since we may be dropping the lock,
-       and have more callbacks added. We're guaranteed not
-       to have any removed */
-    size_t cbCount = callbacks->count;
-
-    for (i = 0; i < cbCount; i++) {
-        virObjectEventCallback *cb = callbacks->callbacks[i];
+    GPtrArray *global;
+    GPtrArray *keyed = NULL;
+    size_t nglobal = 0;
+    size_t nkeyed = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* Only callbacks registered for this event ID, either globally or
+     * for this very object, can possibly match */
+    if ((global = virObjectEventCallbackIndexLookup(callbacks, event->eventID,
+                                                    NULL)))
+        nglobal = global->len;
+    if (event->meta.key &&
+        (keyed = virObjectEventCallbackIndexLookup(callbacks, event->eventID,
+                                                   event->meta.key)))
+        nkeyed = keyed->len;
+
+    /* The lengths are cached, since we may be dropping the lock, and
+     * have more callbacks added. We're guaranteed not to have any
+     * removed. Both arrays are sorted by callbackID, so merging them
+     * preserves the registration order of callbacks. */
+    while (i < nglobal || j < nkeyed) {
+        virObjectEventCallback *gcb = i < nglobal ? g_ptr_array_index(global, i) : NULL;
+        virObjectEventCallback *kcb = j < nkeyed ? g_ptr_array_index(keyed, j) : NULL;
+        virObjectEventCallback *cb;
+
+        if (gcb && (!kcb || gcb->callbackID < kcb->callbackID)) {
+            cb = gcb;
+            i++;
+        } else {
+            cb = kcb;
+            j++;
+        }
 
         if (!virObjectEventDispatchMatchCallback(event, cb))
             continue;
@@ -735,6 +901,9 @@ virObjectEventStateQueueRemote(virObjectEventState *state,
     virObjectLock(state);
 
     event->remoteID = remoteID;
+    if (event->coalesce)
+        virObjectEventQueueCoalesce(state->queue, event);
+
     if (virObjectEventQueuePush(state->queue, event) < 0) {
         VIR_DEBUG("Error adding event to queue");
         virObjectUnref(event);
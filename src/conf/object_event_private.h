@@ -46,6 +46,9 @@ struct  __attribute__((aligned(8))) _virObjectEvent {
     virObjectMeta meta;
     int remoteID;
     virObjectEventDispatchFunc dispatch;
+    /* Newer event of the same type for the same object supersedes
+     * this one while it is queued */
+    bool coalesce;
 };
 
 /**
@@ -102,3 +105,7 @@ virObjectEventNew(virClass *klass,
                   const char *key)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(5)
     ATTRIBUTE_NONNULL(7);
+
+void
+virObjectEventSetCoalesce(virObjectEvent *event)
+    ATTRIBUTE_NONNULL(1);
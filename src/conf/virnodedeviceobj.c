@@ -41,6 +41,12 @@ struct _virNodeDeviceObj {
     bool active;
     bool persistent;
     bool autostart;
+
+    /* Keys under which the object is stored in the secondary indexes of
+     * virNodeDeviceObjList. @def may be modified in place, e.g., sysfs path
+     * is cleared when a persistent mediated device is stopped. */
+    char *indexSysfsPath;
+    char *indexMdev;
 };
 
 struct _virNodeDeviceObjList {
@@ -50,6 +56,20 @@ struct _virNodeDeviceObjList {
      * for O(1), lookup-by-name */
     GHashTable *objs;
 
+    /* Secondary indexes, none of them holds a reference to the objects
+     * stored in @objs. They are maintained by AssignDef and Remove. */
+
+    /* sysfs path -> virNodeDeviceObj */
+    GHashTable *sysfsPaths;
+
+    /* "parent_addr/uuid" -> virNodeDeviceObj of mediated devices */
+    GHashTable *mdevs;
+
+    /* capability type -> set of virNodeDeviceObj which have or may gain the
+     * capability. Capabilities derived from flags (e.g., fc_host or
+     * mdev_types) and WWNs are refreshed from sysfs in place so they still
+     * need to be checked on the candidates. */
+    GHashTable *caps[VIR_NODE_DEV_CAP_LAST];
 };
 
 
@@ -79,6 +99,8 @@ virNodeDeviceObjDispose(void *opaque)
     virNodeDeviceObj *obj = opaque;
 
     virNodeDeviceDefFree(obj->def);
+    g_free(obj->indexSysfsPath);
+    g_free(obj->indexMdev);
 }
 
 
@@ -197,21 +219,154 @@ virNodeDeviceObjListSearch(virNodeDeviceObjList *devs,
 }
 
 
-static int
-virNodeDeviceObjListFindBySysfsPathCallback(const void *payload,
-                                            const char *name G_GNUC_UNUSED,
-                                            const void *opaque)
+/**
+ * virNodeDeviceObjListSearchCap:
+ * @devs: Pointer to object list
+ * @type: capability type
+ * @callback: function to test the device
+ * @data: opaque data passed to @callback
+ *
+ * Same as virNodeDeviceObjListSearch, but only devices which may provide
+ * capability @type are passed to @callback.
+ */
+static virNodeDeviceObj *
+virNodeDeviceObjListSearchCap(virNodeDeviceObjList *devs,
+                              virNodeDevCapType type,
+                              virHashSearcher callback,
+                              const void *data)
 {
-    virNodeDeviceObj *obj = (virNodeDeviceObj *) payload;
-    const char *sysfs_path = opaque;
-    int want = 0;
+    virNodeDeviceObj *obj = NULL;
+    GHashTableIter iter;
+    void *key;
 
-    virObjectLock(obj);
-    if (obj->def->sysfs_path &&
-        STREQ_NULLABLE(obj->def->sysfs_path, sysfs_path))
-        want = 1;
-    virObjectUnlock(obj);
-    return want;
+    virObjectRWLockRead(devs);
+    g_hash_table_iter_init(&iter, devs->caps[type]);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        if (callback(key, NULL, data)) {
+            obj = virObjectRef(key);
+            break;
+        }
+    }
+    virObjectRWUnlock(devs);
+
+    if (obj)
+        virObjectLock(obj);
+
+    return obj;
+}
+
+
+static char *
+virNodeDeviceObjMdevKey(const char *uuid,
+                        const char *parent_addr)
+{
+    return g_strdup_printf("%s/%s", parent_addr, uuid);
+}
+
+
+/* Marks @cap->data.type and capabilities @cap may gain at runtime in
+ * @types array. */
+static void
+virNodeDeviceCapGetTypes(virNodeDevCapsDef *cap,
+                         bool *types)
+{
+    types[cap->data.type] = true;
+
+    switch (cap->data.type) {
+    case VIR_NODE_DEV_CAP_PCI_DEV:
+        types[VIR_NODE_DEV_CAP_MDEV_TYPES] = true;
+        types[VIR_NODE_DEV_CAP_VPD] = true;
+        break;
+    case VIR_NODE_DEV_CAP_SCSI_HOST:
+        types[VIR_NODE_DEV_CAP_FC_HOST] = true;
+        types[VIR_NODE_DEV_CAP_VPORTS] = true;
+        break;
+    case VIR_NODE_DEV_CAP_CSS_DEV:
+    case VIR_NODE_DEV_CAP_AP_MATRIX:
+        types[VIR_NODE_DEV_CAP_MDEV_TYPES] = true;
+        break;
+    case VIR_NODE_DEV_CAP_CCW_DEV:
+        types[VIR_NODE_DEV_CAP_CCWGROUP_MEMBER] = true;
+        break;
+    case VIR_NODE_DEV_CAP_SYSTEM:
+    case VIR_NODE_DEV_CAP_USB_DEV:
+    case VIR_NODE_DEV_CAP_USB_INTERFACE:
+    case VIR_NODE_DEV_CAP_NET:
+    case VIR_NODE_DEV_CAP_SCSI_TARGET:
+    case VIR_NODE_DEV_CAP_SCSI:
+    case VIR_NODE_DEV_CAP_STORAGE:
+    case VIR_NODE_DEV_CAP_FC_HOST:
+    case VIR_NODE_DEV_CAP_VPORTS:
+    case VIR_NODE_DEV_CAP_SCSI_GENERIC:
+    case VIR_NODE_DEV_CAP_DRM:
+    case VIR_NODE_DEV_CAP_MDEV_TYPES:
+    case VIR_NODE_DEV_CAP_MDEV:
+    case VIR_NODE_DEV_CAP_VDPA:
+    case VIR_NODE_DEV_CAP_AP_CARD:
+    case VIR_NODE_DEV_CAP_AP_QUEUE:
+    case VIR_NODE_DEV_CAP_VPD:
+    case VIR_NODE_DEV_CAP_CCWGROUP_DEV:
+    case VIR_NODE_DEV_CAP_CCWGROUP_MEMBER:
+    case VIR_NODE_DEV_CAP_LAST:
+        break;
+    }
+}
+
+
+/* The caller must hold write lock on @devs */
+static void
+virNodeDeviceObjListIndex(virNodeDeviceObjList *devs,
+                          virNodeDeviceObj *obj)
+{
+    virNodeDeviceDef *def = obj->def;
+    virNodeDevCapsDef *cap;
+    bool types[VIR_NODE_DEV_CAP_LAST] = { false };
+    size_t i;
+
+    if (def->sysfs_path) {
+        obj->indexSysfsPath = g_strdup(def->sysfs_path);
+        ignore_value(virHashUpdateEntry(devs->sysfsPaths,
+                                        obj->indexSysfsPath, obj));
+    }
+
+    for (cap = def->caps; cap; cap = cap->next) {
+        if (cap->data.type == VIR_NODE_DEV_CAP_MDEV && !obj->indexMdev &&
+            cap->data.mdev.uuid && cap->data.mdev.parent_addr) {
+            obj->indexMdev = virNodeDeviceObjMdevKey(cap->data.mdev.uuid,
+                                                     cap->data.mdev.parent_addr);
+            ignore_value(virHashUpdateEntry(devs->mdevs, obj->indexMdev, obj));
+        }
+
+        virNodeDeviceCapGetTypes(cap, types);
+    }
+
+    for (i = 0; i < VIR_NODE_DEV_CAP_LAST; i++) {
+        if (types[i])
+            g_hash_table_add(devs->caps[i], obj);
+    }
+}
+
+
+/* The caller must hold write lock on @devs */
+static void
+virNodeDeviceObjListUnindex(virNodeDeviceObjList *devs,
+                            virNodeDeviceObj *obj)
+{
+    size_t i;
+
+    /* Another device may have claimed the same key in the meantime */
+    if (obj->indexSysfsPath &&
+        virHashLookup(devs->sysfsPaths, obj->indexSysfsPath) == obj)
+        virHashRemoveEntry(devs->sysfsPaths, obj->indexSysfsPath);
+    g_clear_pointer(&obj->indexSysfsPath, g_free);
+
+    if (obj->indexMdev &&
+        virHashLookup(devs->mdevs, obj->indexMdev) == obj)
+        virHashRemoveEntry(devs->mdevs, obj->indexMdev);
+    g_clear_pointer(&obj->indexMdev, g_free);
+
+    for (i = 0; i < VIR_NODE_DEV_CAP_LAST; i++)
+        g_hash_table_remove(devs->caps[i], obj);
 }
 
 
@@ -219,9 +374,23 @@ virNodeDeviceObj *
 virNodeDeviceObjListFindBySysfsPath(virNodeDeviceObjList *devs,
                                     const char *sysfs_path)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindBySysfsPathCallback,
-                                      sysfs_path);
+    virNodeDeviceObj *obj;
+
+    if (!sysfs_path)
+        return NULL;
+
+    virObjectRWLockRead(devs);
+    obj = virObjectRef(virHashLookup(devs->sysfsPaths, sysfs_path));
+    virObjectRWUnlock(devs);
+
+    if (!obj)
+        return NULL;
+
+    virObjectLock(obj);
+    if (STRNEQ_NULLABLE(obj->def->sysfs_path, sysfs_path))
+        virNodeDeviceObjEndAPI(&obj);
+
+    return obj;
 }
 
 
@@ -284,9 +453,9 @@ virNodeDeviceObjListFindByWWNs(virNodeDeviceObjList *devs,
     struct virNodeDeviceObjListFindByWWNsData data = {
         .parent_wwnn = parent_wwnn, .parent_wwpn = parent_wwpn };
 
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByWWNsCallback,
-                                      &data);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindByWWNsCallback,
+                                         &data);
 }
 
 
@@ -314,9 +483,9 @@ static virNodeDeviceObj *
 virNodeDeviceObjListFindByFabricWWN(virNodeDeviceObjList *devs,
                                     const char *parent_fabric_wwn)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByFabricWWNCallback,
-                                      parent_fabric_wwn);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindByFabricWWNCallback,
+                                         parent_fabric_wwn);
 }
 
 
@@ -341,9 +510,14 @@ static virNodeDeviceObj *
 virNodeDeviceObjListFindByCap(virNodeDeviceObjList *devs,
                               const char *cap)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByCapCallback,
-                                      cap);
+    int type;
+
+    if ((type = virNodeDevCapTypeFromString(cap)) < 0)
+        return NULL;
+
+    return virNodeDeviceObjListSearchCap(devs, type,
+                                         virNodeDeviceObjListFindByCapCallback,
+                                         cap);
 }
 
 
@@ -394,62 +568,51 @@ virNodeDeviceObjListFindSCSIHostByWWNs(virNodeDeviceObjList *devs,
     struct virNodeDeviceObjListFindSCSIHostByWWNsData data = {
         .wwnn = wwnn, .wwpn = wwpn };
 
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindSCSIHostByWWNsCallback,
-                                      &data);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindSCSIHostByWWNsCallback,
+                                         &data);
 }
 
 
-typedef struct _FindMediatedDeviceData FindMediatedDeviceData;
-struct _FindMediatedDeviceData {
-    const char *uuid;
-    const char *parent_addr;
-};
-
-
-static int
-virNodeDeviceObjListFindMediatedDeviceByUUIDCallback(const void *payload,
-                                                     const char *name G_GNUC_UNUSED,
-                                                     const void *opaque)
+virNodeDeviceObj *
+virNodeDeviceObjListFindMediatedDeviceByUUID(virNodeDeviceObjList *devs,
+                                             const char *uuid,
+                                             const char *parent_addr)
 {
-    virNodeDeviceObj *obj = (virNodeDeviceObj *) payload;
-    const FindMediatedDeviceData* data = opaque;
+    g_autofree char *key = virNodeDeviceObjMdevKey(uuid, parent_addr);
+    virNodeDeviceObj *obj;
     virNodeDevCapsDef *cap;
-    int want = 0;
-
-    virObjectLock(obj);
 
-    for (cap = obj->def->caps; cap != NULL; cap = cap->next) {
-        if (cap->data.type == VIR_NODE_DEV_CAP_MDEV) {
-            if (STREQ(cap->data.mdev.uuid, data->uuid) &&
-                STREQ(cap->data.mdev.parent_addr, data->parent_addr)) {
-                want = 1;
-                break;
-            }
-        }
-     }
+    virObjectRWLockRead(devs);
+    obj = virObjectRef(virHashLookup(devs->mdevs, key));
+    virObjectRWUnlock(devs);
 
-    virObjectUnlock(obj);
-    return want;
-}
+    if (!obj)
+        return NULL;
 
+    virObjectLock(obj);
+    for (cap = obj->def->caps; cap; cap = cap->next) {
+        if (cap->data.type == VIR_NODE_DEV_CAP_MDEV &&
+            STREQ_NULLABLE(cap->data.mdev.uuid, uuid) &&
+            STREQ_NULLABLE(cap->data.mdev.parent_addr, parent_addr))
+            return obj;
+    }
 
-virNodeDeviceObj *
-virNodeDeviceObjListFindMediatedDeviceByUUID(virNodeDeviceObjList *devs,
-                                             const char *uuid,
-                                             const char *parent_addr)
-{
-    const FindMediatedDeviceData data = {uuid, parent_addr};
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindMediatedDeviceByUUIDCallback,
-                                      &data);
+    virNodeDeviceObjEndAPI(&obj);
+    return NULL;
 }
 
+
 static void
 virNodeDeviceObjListDispose(void *obj)
 {
     virNodeDeviceObjList *devs = obj;
+    size_t i;
 
+    for (i = 0; i < VIR_NODE_DEV_CAP_LAST; i++)
+        g_clear_pointer(&devs->caps[i], g_hash_table_unref);
+    g_clear_pointer(&devs->mdevs, g_hash_table_unref);
+    g_clear_pointer(&devs->sysfsPaths, g_hash_table_unref);
     g_clear_pointer(&devs->objs, g_hash_table_unref);
 }
 
@@ -458,6 +621,7 @@ virNodeDeviceObjList *
 virNodeDeviceObjListNew(void)
 {
     virNodeDeviceObjList *devs;
+    size_t i;
 
     if (virNodeDeviceObjInitialize() < 0)
         return NULL;
@@ -466,6 +630,10 @@ virNodeDeviceObjListNew(void)
         return NULL;
 
     devs->objs = virHashNew(virObjectUnref);
+    devs->sysfsPaths = virHashNew(NULL);
+    devs->mdevs = virHashNew(NULL);
+    for (i = 0; i < VIR_NODE_DEV_CAP_LAST; i++)
+        devs->caps[i] = g_hash_table_new(g_direct_hash, g_direct_equal);
 
     return devs;
 }
@@ -488,6 +656,7 @@ virNodeDeviceObjListAssignDef(virNodeDeviceObjList *devs,
 
     if ((obj = virNodeDeviceObjListFindByNameLocked(devs, def->name))) {
         virObjectLock(obj);
+        virNodeDeviceObjListUnindex(devs, obj);
         virNodeDeviceDefFree(obj->def);
         obj->def = def;
     } else {
@@ -503,6 +672,8 @@ virNodeDeviceObjListAssignDef(virNodeDeviceObjList *devs,
         virObjectRef(obj);
     }
 
+    virNodeDeviceObjListIndex(devs, obj);
+
  cleanup:
     virObjectRWUnlock(devs);
     return obj;
@@ -531,6 +702,7 @@ void
 virNodeDeviceObjListRemoveLocked(virNodeDeviceObjList *devs,
                                  virNodeDeviceObj *dev)
 {
+    virNodeDeviceObjListUnindex(devs, dev);
     virHashRemoveEntry(devs->objs, dev->def->name);
 }
 
@@ -1071,6 +1243,7 @@ typedef struct _PredicateHelperData PredicateHelperData;
 struct _PredicateHelperData {
     virNodeDeviceObjListPredicate predicate;
     void *opaque;
+    virNodeDeviceObjList *devs;
 };
 
 static int virNodeDeviceObjListRemoveHelper(void *key G_GNUC_UNUSED,
@@ -1079,7 +1252,11 @@ static int virNodeDeviceObjListRemoveHelper(void *key G_GNUC_UNUSED,
 {
     PredicateHelperData *data = opaque;
 
-    return data->predicate(value, data->opaque);
+    if (!data->predicate(value, data->opaque))
+        return 0;
+
+    virNodeDeviceObjListUnindex(data->devs, value);
+    return 1;
 }
 
 
@@ -1100,7 +1277,8 @@ virNodeDeviceObjListForEachRemove(virNodeDeviceObjList *devs,
 {
     PredicateHelperData data = {
         .predicate = callback,
-        .opaque = opaque
+        .opaque = opaque,
+        .devs = devs,
     };
 
     virObjectRWLockWrite(devs);
@@ -31,6 +31,7 @@
 #include "cpu_x86.h"
 #include "virbuffer.h"
 #include "virendian.h"
+#include "virhash.h"
 #include "virhostcpu.h"
 
 #define VIR_FROM_THIS VIR_FROM_CPU
@@ -206,8 +207,10 @@ struct _virCPUx86Map {
     virCPUx86Vendor **vendors;
     size_t nfeatures;
     virCPUx86Feature **features;
+    GHashTable *featuresByName; /* name -> feature from @features */
     size_t nmodels;
     virCPUx86Model **models;
+    GHashTable *modelsByName; /* name -> model from @models */
     size_t nblockers;
     virCPUx86Feature **migrate_blockers;
 };
@@ -416,14 +419,7 @@ static virCPUx86Feature *
 x86FeatureFind(virCPUx86Map *map,
                const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nfeatures; i++) {
-        if (STREQ(map->features[i]->name, name))
-            return map->features[i];
-    }
-
-    return NULL;
+    return virHashLookup(map->featuresByName, name);
 }
 
 
@@ -493,6 +489,14 @@ virCPUx86DataItemCmp(const virCPUx86DataItem *item1,
 }
 
 
+static int
+virCPUx86DataItemSearch(const void *key,
+                        const void *item)
+{
+    return virCPUx86DataSorter(key, item, NULL);
+}
+
+
 /* skips all zero CPUID leaves */
 static virCPUx86DataItem *
 virCPUx86DataNext(virCPUx86DataIterator *iterator)
@@ -514,19 +518,17 @@ virCPUx86DataNext(virCPUx86DataIterator *iterator)
 }
 
 
+/* The items in @data are kept sorted by virCPUx86DataSorter and each CPUID
+ * leaf or MSR index is stored at most once. */
 static virCPUx86DataItem *
 virCPUx86DataGet(const virCPUx86Data *data,
                  const virCPUx86DataItem *item)
 {
-    size_t i;
-
-    for (i = 0; i < data->len; i++) {
-        virCPUx86DataItem *di = data->items + i;
-        if (virCPUx86DataItemCmp(di, item) == 0)
-            return di;
-    }
+    if (data->len == 0)
+        return NULL;
 
-    return NULL;
+    return bsearch(item, data->items, data->len, sizeof(*data->items),
+                   virCPUx86DataItemSearch);
 }
 
 static void
@@ -586,17 +588,23 @@ virCPUx86DataAddItem(virCPUx86Data *data,
                      const virCPUx86DataItem *item)
 {
     virCPUx86DataItem *existing;
+    virCPUx86DataItem copy;
+    size_t pos;
 
     if ((existing = virCPUx86DataGet(data, item))) {
         virCPUx86DataItemSetBits(existing, item);
-    } else {
-        VIR_APPEND_ELEMENT_COPY(data->items, data->len,
-                                *((virCPUx86DataItem *)item));
+        return;
+    }
 
-        g_qsort_with_data(data->items, data->len,
-                          sizeof(virCPUx86DataItem),
-                          virCPUx86DataSorter, NULL);
+    /* Items are usually added in order, look for the right position from
+     * the end to keep the array sorted. */
+    for (pos = data->len; pos > 0; pos--) {
+        if (virCPUx86DataItemCmp(data->items + pos - 1, item) < 0)
+            break;
     }
+
+    copy = *item;
+    VIR_INSERT_ELEMENT(data->items, pos, data->len, copy);
 }
 
 
@@ -613,18 +621,39 @@ x86DataAdd(virCPUx86Data *data1,
 }
 
 
+/* Both @data and @other are sorted, returns the item from @other matching
+ * @item or NULL. @pos points to the first item in @other which needs to be
+ * checked and it is advanced so that walking through @data in order passes
+ * through @other only once. */
+static const virCPUx86DataItem *
+virCPUx86DataGetNext(const virCPUx86Data *other,
+                     size_t *pos,
+                     const virCPUx86DataItem *item)
+{
+    int cmp = 1;
+
+    while (*pos < other->len &&
+           (cmp = virCPUx86DataItemCmp(other->items + *pos, item)) < 0)
+        (*pos)++;
+
+    if (*pos < other->len && cmp == 0)
+        return other->items + *pos;
+
+    return NULL;
+}
+
+
 static void
 x86DataSubtract(virCPUx86Data *data1,
                 const virCPUx86Data *data2)
 {
-    virCPUx86DataIterator iter;
-    virCPUx86DataItem *item1;
-    virCPUx86DataItem *item2;
+    const virCPUx86DataItem *item2;
+    size_t pos = 0;
+    size_t i;
 
-    virCPUx86DataIteratorInit(&iter, data1);
-    while ((item1 = virCPUx86DataNext(&iter))) {
-        item2 = virCPUx86DataGet(data2, item1);
-        virCPUx86DataItemClearBits(item1, item2);
+    for (i = 0; i < data1->len; i++) {
+        if ((item2 = virCPUx86DataGetNext(data2, &pos, data1->items + i)))
+            virCPUx86DataItemClearBits(data1->items + i, item2);
     }
 }
 
@@ -633,14 +662,15 @@ static void
 x86DataIntersect(virCPUx86Data *data1,
                  const virCPUx86Data *data2)
 {
-    virCPUx86DataIterator iter;
     virCPUx86DataItem *item1;
-    virCPUx86DataItem *item2;
+    const virCPUx86DataItem *item2;
+    size_t pos = 0;
+    size_t i;
+
+    for (i = 0; i < data1->len; i++) {
+        item1 = data1->items + i;
 
-    virCPUx86DataIteratorInit(&iter, data1);
-    while ((item1 = virCPUx86DataNext(&iter))) {
-        item2 = virCPUx86DataGet(data2, item1);
-        if (item2)
+        if ((item2 = virCPUx86DataGetNext(data2, &pos, item1)))
             virCPUx86DataItemAndBits(item1, item2);
         else
             virCPUx86DataItemClearBits(item1, item1);
@@ -665,10 +695,11 @@ x86DataIsSubset(const virCPUx86Data *data,
     virCPUx86DataIterator iter;
     const virCPUx86DataItem *item;
     const virCPUx86DataItem *itemSubset;
+    size_t pos = 0;
 
     virCPUx86DataIteratorInit(&iter, subset);
     while ((itemSubset = virCPUx86DataNext(&iter))) {
-        if (!(item = virCPUx86DataGet(data, itemSubset)) ||
+        if (!(item = virCPUx86DataGetNext(data, &pos, itemSubset)) ||
             !virCPUx86DataItemMatchMasked(item, itemSubset))
             return false;
     }
@@ -1205,6 +1236,9 @@ x86FeatureParse(xmlXPathContextPtr ctxt,
     if (x86ParseDataItemList(&feature->data, ctxt->node) < 0)
         return -1;
 
+    if (virHashAddEntry(map->featuresByName, feature->name, feature) < 0)
+        return -1;
+
     if (!feature->migratable)
         VIR_APPEND_ELEMENT_COPY(map->migrate_blockers, map->nblockers, feature);
 
@@ -1355,14 +1389,7 @@ static virCPUx86Model *
 x86ModelFind(virCPUx86Map *map,
              const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nmodels; i++) {
-        if (STREQ(map->models[i]->name, name))
-            return map->models[i];
-    }
-
-    return NULL;
+    return virHashLookup(map->modelsByName, name);
 }
 
 
@@ -1806,6 +1833,9 @@ x86ModelParse(xmlXPathContextPtr ctxt,
         model->ancestor->canonical = model;
     }
 
+    if (virHashAddEntry(map->modelsByName, model->name, model) < 0)
+        return -1;
+
     VIR_APPEND_ELEMENT(map->models, map->nmodels, model);
 
     return 0;
@@ -1820,6 +1850,9 @@ x86MapFree(virCPUx86Map *map)
     if (!map)
         return;
 
+    g_clear_pointer(&map->featuresByName, g_hash_table_unref);
+    g_clear_pointer(&map->modelsByName, g_hash_table_unref);
+
     for (i = 0; i < map->nfeatures; i++)
         x86FeatureFree(map->features[i]);
     g_free(map->features);
@@ -1848,6 +1881,8 @@ virCPUx86LoadMap(void)
     g_autoptr(virCPUx86Map) map = NULL;
 
     map = g_new0(virCPUx86Map, 1);
+    map->featuresByName = virHashNew(NULL);
+    map->modelsByName = virHashNew(NULL);
 
     if (cpuMapLoad("x86", x86VendorParse, x86FeatureParse, x86ModelParse, map) < 0)
         return NULL;
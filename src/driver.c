@@ -346,11 +346,12 @@ virDriverFeatureIsGlobal(virDrvFeature feat,
     /* keepalive is handled at RPC level, driver implementations must always
      * return 0, to signal that direct/embedded use doesn't use keepalive */
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
-    /* Support for close callbacks and remote event filtering are both features
-     * of the RPC protocol and thus normal drivers must not signal support
-     * for them. */
+    /* Support for close callbacks, remote event filtering and large stream
+     * packets are all features of the RPC protocol and thus normal drivers
+     * must not signal support for them. */
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD:
         *supported = 0;
         return true;
 
@@ -29,9 +29,35 @@ VIR_LOG_INIT("libvirt.stream");
 #define VIR_FROM_THIS VIR_FROM_STREAMS
 
 /* To avoid dragging in RPC code (which may be not compiled in),
- * redefine this constant. Its value can't ever change, so we're
+ * redefine these constants. Their values can't ever change, so we're
  * safe to do so. */
 #define VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX 262120
+#define VIR_NET_MESSAGE_STREAM_PAYLOAD_MAX 4194304
+
+
+/*
+ * virStreamGetChunkSize:
+ * @stream: pointer to the stream object
+ *
+ * Returns the size of data chunks the *All helpers should move at
+ * once. Larger chunks are used only if the other side of a remote
+ * connection negotiated them, otherwise the legacy size is kept.
+ */
+static size_t
+virStreamGetChunkSize(virStreamPtr stream)
+{
+    int rc = VIR_DRV_SUPPORTS_FEATURE(stream->conn->driver, stream->conn,
+                                      VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD);
+
+    if (rc > 0)
+        return VIR_NET_MESSAGE_STREAM_PAYLOAD_MAX;
+
+    /* Failure to query the feature is not fatal */
+    if (rc < 0)
+        virResetLastError();
+
+    return VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+}
 
 
 /**
@@ -600,7 +626,7 @@ virStreamSendAll(virStreamPtr stream,
                  void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     int ret = -1;
     VIR_DEBUG("stream=%p, handler=%p, opaque=%p", stream, handler, opaque);
 
@@ -615,6 +641,7 @@ virStreamSendAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    want = virStreamGetChunkSize(stream);
     bytes = g_new0(char, want);
 
     errno = 0;
@@ -732,7 +759,7 @@ int virStreamSparseSendAll(virStreamPtr stream,
                            void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t bufLen = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t bufLen;
     int ret = -1;
     unsigned long long dataLen = 0;
 
@@ -752,6 +779,7 @@ int virStreamSparseSendAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    bufLen = virStreamGetChunkSize(stream);
     bytes = g_new0(char, bufLen);
 
     errno = 0;
@@ -872,7 +900,7 @@ virStreamRecvAll(virStreamPtr stream,
                  void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     int ret = -1;
     VIR_DEBUG("stream=%p, handler=%p, opaque=%p", stream, handler, opaque);
 
@@ -888,6 +916,7 @@ virStreamRecvAll(virStreamPtr stream,
     }
 
 
+    want = virStreamGetChunkSize(stream);
     bytes = g_new0(char, want);
 
     errno = 0;
@@ -988,7 +1017,7 @@ virStreamSparseRecvAll(virStreamPtr stream,
                        void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     const unsigned int flags = VIR_STREAM_RECV_STOP_AT_HOLE;
     int ret = -1;
 
@@ -1007,6 +1036,7 @@ virStreamSparseRecvAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    want = virStreamGetChunkSize(stream);
     bytes = g_new0(char, want);
 
     errno = 0;
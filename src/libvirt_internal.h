@@ -132,6 +132,13 @@ typedef enum {
      * Whether the virNetworkUpdate() API implementation passes arguments to
      * the driver's callback in correct order. */
     VIR_DRV_FEATURE_NETWORK_UPDATE_HAS_CORRECT_ORDER = 16,
+
+    /*
+     * Remote party accepts and sends stream data packets larger than
+     * VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX, up to
+     * VIR_NET_MESSAGE_STREAM_PAYLOAD_MAX
+     */
+    VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD = 17,
 } virDrvFeature;
 
 
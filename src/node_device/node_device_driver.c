@@ -245,6 +245,30 @@ nodeDeviceObjFindByName(const char *name)
 }
 
 
+/**
+ * nodeDeviceObjFindByNameEarly:
+ * @name: device name
+ *
+ * Initial enumeration of host devices may take quite some time. Devices
+ * which were already enumerated are returned immediately, otherwise the
+ * function waits until the enumeration finishes. Only for APIs which do not
+ * depend on data added at the end of enumeration, such as mdevctl config.
+ */
+static virNodeDeviceObj *
+nodeDeviceObjFindByNameEarly(const char *name)
+{
+    virNodeDeviceObj *obj;
+
+    if ((obj = virNodeDeviceObjListFindByName(driver->devs, name)))
+        return obj;
+
+    if (nodeDeviceInitWait() < 0)
+        return NULL;
+
+    return nodeDeviceObjFindByName(name);
+}
+
+
 virNodeDevicePtr
 nodeDeviceLookupByName(virConnectPtr conn,
                        const char *name)
@@ -253,10 +277,7 @@ nodeDeviceLookupByName(virConnectPtr conn,
     virNodeDeviceDef *def;
     virNodeDevicePtr device = NULL;
 
-    if (nodeDeviceInitWait() < 0)
-        return NULL;
-
-    if (!(obj = nodeDeviceObjFindByName(name)))
+    if (!(obj = nodeDeviceObjFindByNameEarly(name)))
         return NULL;
     def = virNodeDeviceObjGetDef(obj);
 
@@ -383,10 +404,7 @@ nodeDeviceGetParent(virNodeDevicePtr device)
     virNodeDeviceDef *def;
     char *ret = NULL;
 
-    if (nodeDeviceInitWait() < 0)
-        return NULL;
-
-    if (!(obj = nodeDeviceObjFindByName(device->name)))
+    if (!(obj = nodeDeviceObjFindByNameEarly(device->name)))
         return NULL;
     def = virNodeDeviceObjGetDef(obj);
 
@@ -413,10 +431,7 @@ nodeDeviceNumOfCaps(virNodeDevicePtr device)
     virNodeDeviceDef *def;
     int ret = -1;
 
-    if (nodeDeviceInitWait() < 0)
-        return -1;
-
-    if (!(obj = nodeDeviceObjFindByName(device->name)))
+    if (!(obj = nodeDeviceObjFindByNameEarly(device->name)))
         return -1;
     def = virNodeDeviceObjGetDef(obj);
 
@@ -444,10 +459,7 @@ nodeDeviceListCaps(virNodeDevicePtr device,
     int ret = -1;
     size_t i = 0;
 
-    if (nodeDeviceInitWait() < 0)
-        return -1;
-
-    if (!(obj = nodeDeviceObjFindByName(device->name)))
+    if (!(obj = nodeDeviceObjFindByNameEarly(device->name)))
         return -1;
     def = virNodeDeviceObjGetDef(obj);
 
@@ -2240,10 +2252,7 @@ nodeDeviceIsActive(virNodeDevice *device)
     virNodeDeviceDef *def = NULL;
     int ret = -1;
 
-    if (nodeDeviceInitWait() < 0)
-        return -1;
-
-    if (!(obj = nodeDeviceObjFindByName(device->name)))
+    if (!(obj = nodeDeviceObjFindByNameEarly(device->name)))
         return -1;
     def = virNodeDeviceObjGetDef(obj);
 
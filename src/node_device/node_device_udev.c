@@ -44,6 +44,7 @@
 #include "virmdev.h"
 #include "virutil.h"
 #include "virthreadpool.h"
+#include "virhostcpu.h"
 
 #include "configmake.h"
 
@@ -1689,12 +1690,60 @@ udevSetParent(virNodeDeviceDriverState *driver_state,
     return 0;
 }
 
+/**
+ * udevNewDeviceDef:
+ * @driver_state: driver state
+ * @device: udev device
+ *
+ * Gathers details about @device from udev and sysfs. The parent of the device
+ * is not filled in as it depends on other devices already known to the driver.
+ * Other than that the function does not touch the list of devices so it may
+ * be called for several devices in parallel.
+ *
+ * Returns the new definition or NULL on error.
+ */
+static virNodeDeviceDef *
+udevNewDeviceDef(virNodeDeviceDriverState *driver_state,
+                 struct udev_device *device)
+{
+    g_autoptr(virNodeDeviceDef) def = g_new0(virNodeDeviceDef, 1);
+
+    def->sysfs_path = g_strdup(udev_device_get_syspath(device));
+
+    udevGetStringProperty(device, "DRIVER", &def->driver);
+
+    def->caps = g_new0(virNodeDevCapsDef, 1);
+
+    if (udevGetDeviceType(device, &def->caps->data.type) != 0 ||
+        udevGetDeviceNodes(device, def) != 0 ||
+        udevGetDeviceDetails(driver_state, device, def) != 0) {
+        VIR_DEBUG("Discarding device %p %s", def, NULLSTR(def->sysfs_path));
+        return NULL;
+    }
+
+    return g_steal_pointer(&def);
+}
+
+
+/**
+ * udevAddDeviceDef:
+ * @driver_state: driver state
+ * @device: udev device
+ * @def: definition of @device created by udevNewDeviceDef
+ * @enumerating: whether the device is being added during initial enumeration
+ *
+ * Links @def to its parent and adds it to the list of devices, replacing any
+ * existing definition of the same device. @def is consumed in any case.
+ *
+ * Returns 0 on success, -1 on error.
+ */
 static int
-processNodeDeviceAddAndChangeEvent(virNodeDeviceDriverState *driver_state,
-                                   struct udev_device *device)
+udevAddDeviceDef(virNodeDeviceDriverState *driver_state,
+                 struct udev_device *device,
+                 virNodeDeviceDef *def,
+                 bool enumerating)
 {
     g_autofree char *sysfs_path = NULL;
-    virNodeDeviceDef *def = NULL;
     virNodeDeviceObj *obj = NULL;
     virNodeDeviceDef *objdef;
     virObjectEvent *event = NULL;
@@ -1705,26 +1754,10 @@ processNodeDeviceAddAndChangeEvent(virNodeDeviceDriverState *driver_state,
     bool is_mdev;
     bool has_mdev_types = false;
 
-    def = g_new0(virNodeDeviceDef, 1);
-
-    def->sysfs_path = g_strdup(udev_device_get_syspath(device));
     /* Create a copy of sysfs_path so it can be safely accessed, even without
      * holding the @obj lock during the VIR_WARN(...) call at the end. */
     sysfs_path = g_strdup(def->sysfs_path);
 
-    udevGetStringProperty(device, "DRIVER", &def->driver);
-
-    def->caps = g_new0(virNodeDevCapsDef, 1);
-
-    if (udevGetDeviceType(device, &def->caps->data.type) != 0)
-        goto cleanup;
-
-    if (udevGetDeviceNodes(device, def) != 0)
-        goto cleanup;
-
-    if (udevGetDeviceDetails(driver_state, device, def) != 0)
-        goto cleanup;
-
     if (udevSetParent(driver_state, device, def) != 0)
         goto cleanup;
 
@@ -1769,8 +1802,10 @@ processNodeDeviceAddAndChangeEvent(virNodeDeviceDriverState *driver_state,
 
     /* The added mdev needs an immediate active config update before the event
      * is issued so that full device information is available at the time that
-     * the 'created' event is emitted. */
-    if ((has_mdev_types || is_mdev) && (nodeDeviceUpdateMediatedDevices(driver_state) < 0)) {
+     * the 'created' event is emitted. Mediated devices are updated once all
+     * devices are known when enumerating. */
+    if ((has_mdev_types || is_mdev) && !enumerating &&
+        (nodeDeviceUpdateMediatedDevices(driver_state) < 0)) {
         VIR_WARN("Update of mediated device %s failed",
                  NULLSTR_EMPTY(sysfs_path));
     }
@@ -1791,29 +1826,15 @@ processNodeDeviceAddAndChangeEvent(virNodeDeviceDriverState *driver_state,
 
 
 static int
-udevProcessDeviceListEntry(virNodeDeviceDriverState *driver_state,
-                           struct udev *udev,
-                           struct udev_list_entry *list_entry)
+processNodeDeviceAddAndChangeEvent(virNodeDeviceDriverState *driver_state,
+                                   struct udev_device *device)
 {
-    struct udev_device *device;
-    const char *name = NULL;
-    int ret = -1;
-
-    name = udev_list_entry_get_name(list_entry);
-
-    device = udev_device_new_from_syspath(udev, name);
-
-    if (device != NULL) {
-        if (processNodeDeviceAddAndChangeEvent(driver_state, device) != 0) {
-            VIR_DEBUG("Failed to create node device for udev device '%s'",
-                      name);
-        }
-        ret = 0;
-    }
+    virNodeDeviceDef *def;
 
-    udev_device_unref(device);
+    if (!(def = udevNewDeviceDef(driver_state, device)))
+        return -1;
 
-    return ret;
+    return udevAddDeviceDef(driver_state, device, def, false);
 }
 
 
@@ -1841,12 +1862,99 @@ udevEnumerateAddMatches(struct udev_enumerate *udev_enumerate)
 }
 
 
+/* Upper limit of threads gathering device details during enumeration */
+#define UDEV_ENUMERATE_MAX_WORKERS 16
+
+typedef struct _udevEnumerateJob udevEnumerateJob;
+struct _udevEnumerateJob {
+    char *syspath;
+    virNodeDeviceDef *def;
+    bool done;
+};
+
+typedef struct _udevEnumerateData udevEnumerateData;
+struct _udevEnumerateData {
+    virNodeDeviceDriverState *driver_state;
+    virMutex lock;
+    virCond cond;
+    /* udev contexts not used by any worker at the moment */
+    struct udev **udevs;
+    size_t nudevs;
+};
+
+
+/* libudev objects must not be used from several threads at once, so each
+ * worker looks up its device in a udev context of its own rather than the
+ * one of the enumerating thread. */
+static void
+udevEnumerateWorker(void *jobdata,
+                    void *opaque)
+{
+    udevEnumerateJob *job = jobdata;
+    udevEnumerateData *data = opaque;
+    struct udev *udev = NULL;
+    struct udev_device *device = NULL;
+    virNodeDeviceDef *def = NULL;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&data->lock) {
+        if (data->nudevs > 0)
+            udev = data->udevs[--data->nudevs];
+    }
+
+    if (!udev)
+        udev = udev_new();
+
+    if (udev &&
+        (device = udev_device_new_from_syspath(udev, job->syspath))) {
+        def = udevNewDeviceDef(data->driver_state, device);
+        udev_device_unref(device);
+    }
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&data->lock) {
+        job->def = def;
+        job->done = true;
+        if (udev)
+            VIR_APPEND_ELEMENT(data->udevs, data->nudevs, udev);
+        virCondBroadcast(&data->cond);
+    }
+}
+
+
+static size_t
+udevEnumerateWorkers(size_t ndevices)
+{
+    int ncpus = virHostCPUGetCount();
+
+    if (ncpus <= 0)
+        ncpus = 1;
+
+    return MIN(ndevices, MIN(ncpus, UDEV_ENUMERATE_MAX_WORKERS));
+}
+
+
+/**
+ * udevEnumerateDevices:
+ * @driver_state: driver state
+ * @udev: udev context
+ *
+ * Adds all devices known to udev. Gathering details about each device, which
+ * means reading quite a lot of files from sysfs, is done by a pool of worker
+ * threads, each using its own udev context. The devices are then added to
+ * the list in the order in which udev reported them so that parents are
+ * always known before their children. Each device is available to node
+ * device APIs as soon as it is added.
+ */
 static int
 udevEnumerateDevices(virNodeDeviceDriverState *driver_state,
                      struct udev *udev)
 {
     struct udev_enumerate *udev_enumerate = NULL;
     struct udev_list_entry *list_entry = NULL;
+    udevEnumerateData data = { .driver_state = driver_state };
+    g_autofree udevEnumerateJob *jobs = NULL;
+    virThreadPool *pool = NULL;
+    size_t njobs = 0;
+    size_t i;
     int ret = -1;
 
     udev_enumerate = udev_enumerate_new(udev);
@@ -1857,13 +1965,83 @@ udevEnumerateDevices(virNodeDeviceDriverState *driver_state,
         VIR_WARN("udev scan devices failed");
 
     udev_list_entry_foreach(list_entry,
-                            udev_enumerate_get_list_entry(udev_enumerate)) {
+                            udev_enumerate_get_list_entry(udev_enumerate))
+        njobs++;
 
-        udevProcessDeviceListEntry(driver_state, udev, list_entry);
+    jobs = g_new0(udevEnumerateJob, njobs);
+    i = 0;
+    udev_list_entry_foreach(list_entry,
+                            udev_enumerate_get_list_entry(udev_enumerate))
+        jobs[i++].syspath = g_strdup(udev_list_entry_get_name(list_entry));
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unable to initialize mutex"));
+        goto cleanup;
+    }
+
+    if (virCondInit(&data.cond) < 0) {
+        virReportSystemError(errno, "%s", _("unable to initialize condition"));
+        virMutexDestroy(&data.lock);
+        goto cleanup;
+    }
+
+    if (njobs > 0) {
+        size_t nworkers = udevEnumerateWorkers(njobs);
+
+        VIR_DEBUG("Gathering details of %zu devices in %zu threads",
+                  njobs, nworkers);
+
+        /* Devices will be processed sequentially if we fail to create the
+         * pool or send a job to it. */
+        pool = virThreadPoolNewFull(nworkers, nworkers, 0,
+                                    udevEnumerateWorker,
+                                    "nodedev-enumerate",
+                                    NULL, &data);
+    }
+
+    for (i = 0; i < njobs; i++) {
+        if (!pool || virThreadPoolSendJob(pool, 0, &jobs[i]) < 0)
+            udevEnumerateWorker(&jobs[i], &data);
+    }
+
+    for (i = 0; i < njobs; i++) {
+        struct udev_device *device;
+        virNodeDeviceDef *def;
+
+        VIR_WITH_MUTEX_LOCK_GUARD(&data.lock) {
+            while (!jobs[i].done)
+                ignore_value(virCondWait(&data.cond, &data.lock));
+            def = g_steal_pointer(&jobs[i].def);
+        }
+
+        if (!def)
+            continue;
+
+        if (!(device = udev_device_new_from_syspath(udev, jobs[i].syspath))) {
+            virNodeDeviceDefFree(def);
+            continue;
+        }
+
+        if (udevAddDeviceDef(driver_state, device, def, true) < 0) {
+            VIR_DEBUG("Failed to create node device for udev device '%s'",
+                      jobs[i].syspath);
+        }
+
+        udev_device_unref(device);
     }
 
+    virThreadPoolFree(pool);
+    for (i = 0; i < data.nudevs; i++)
+        udev_unref(data.udevs[i]);
+    g_free(data.udevs);
+    virCondDestroy(&data.cond);
+    virMutexDestroy(&data.lock);
+
     ret = 0;
  cleanup:
+    for (i = 0; i < njobs; i++)
+        g_free(jobs[i].syspath);
     udev_enumerate_unref(udev_enumerate);
     return ret;
 }
@@ -168,6 +168,7 @@ nwfilterStateCleanupLocked(void)
         virNWFilterLearnShutdown();
         virNWFilterIPAddrMapShutdown();
         virNWFilterTechDriversShutdown();
+        virNWFilterForgetTemplates();
         nwfilterDriverRemoveDBusMatches();
 
         if (driver->lockFD != -1)
@@ -330,9 +331,13 @@ nwfilterStateReload(void)
     /* shut down all threads -- they will be restarted if necessary */
     virNWFilterLearnThreadsTerminate(true);
 
+    /* the rules may have been flushed, e.g. by a firewalld reload */
+    virNWFilterTechDriversForgetRules();
+
     VIR_WITH_MUTEX_LOCK_GUARD(&driverMutex) {
         VIR_WITH_MUTEX_LOCK_GUARD(&driver->updateLock) {
             virNWFilterObjListLoadAllConfigs(driver->nwfilters, driver->configDir);
+            virNWFilterForgetTemplates();
         }
 
 
@@ -533,7 +538,7 @@ nwfilterDefineXMLFlags(virConnectPtr conn,
     VIR_LOCK_GUARD lock = virLockGuardLock(&driverMutex);
     virNWFilterDef *def;
     virNWFilterObj *obj = NULL;
-    virNWFilterDef *objdef;
+    virNWFilterDef *objdef = NULL;
     virNWFilterPtr nwfilter = NULL;
 
     virCheckFlags(VIR_NWFILTER_DEFINE_VALIDATE, NULL);
@@ -552,15 +557,20 @@ nwfilterDefineXMLFlags(virConnectPtr conn,
         goto cleanup;
 
     VIR_WITH_MUTEX_LOCK_GUARD(&driver->updateLock) {
-        if (!(obj = virNWFilterObjListAssignDef(driver->nwfilters, def)))
+        obj = virNWFilterObjListAssignDef(driver->nwfilters, def);
+        /* the definition replaced or tried during the update is gone */
+        virNWFilterForgetTemplates();
+        if (!obj)
             goto cleanup;
-    }
-    def = NULL;
-    objdef = virNWFilterObjGetDef(obj);
+        def = NULL;
+        objdef = virNWFilterObjGetDef(obj);
 
-    if (virNWFilterSaveConfig(driver->configDir, objdef) < 0) {
-        virNWFilterObjListRemove(driver->nwfilters, obj);
-        goto cleanup;
+        if (virNWFilterSaveConfig(driver->configDir, objdef) < 0) {
+            virNWFilterObjListRemove(driver->nwfilters, obj);
+            obj = NULL;
+            virNWFilterForgetTemplates();
+            goto cleanup;
+        }
     }
 
     nwfilter = virGetNWFilter(conn, objdef->name, objdef->uuid);
@@ -609,6 +619,7 @@ nwfilterUndefine(virNWFilterPtr nwfilter)
 
         virNWFilterObjListRemove(driver->nwfilters, obj);
         obj = NULL;
+        virNWFilterForgetTemplates();
     }
     ret = 0;
 
@@ -82,6 +82,7 @@ static int ebiptablesDriverInit(bool privileged);
 static void ebiptablesDriverShutdown(void);
 static int ebtablesCleanAll(const char *ifname);
 static int ebiptablesAllTeardown(const char *ifname);
+static void ebiptablesForgetRules(const char *ifname);
 
 struct ushort_map {
     unsigned short attr;
@@ -3044,6 +3045,8 @@ ebtablesCleanAll(const char *ifname)
 {
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
 
+    ebiptablesForgetRules(ifname);
+
     virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
 
     ebtablesUnlinkRootChainFW(fw, true, ifname);
@@ -3296,6 +3299,88 @@ ebtablesGetSubChainInsts(GHashTable *chains,
     return 0;
 }
 
+/*
+ * Digests of the rule sets instantiated per interface, so that
+ * re-instantiating an identical rule set, e.g. on a DHCP lease renewal
+ * or a filter update that doesn't affect an interface, is a no-op
+ * instead of rebuilding and swapping all of its chains.
+ */
+typedef struct _ebiptablesIfaceRules ebiptablesIfaceRules;
+struct _ebiptablesIfaceRules {
+    char *current;  /* digest of the rules in the active chains */
+    char *pending;  /* digest of the rules in the temporary chains */
+    bool unchanged; /* last applyNewRules matched @current */
+};
+
+static virMutex ebiptablesIfaceRulesLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *ebiptablesIfaceRulesTable;
+
+
+static void
+ebiptablesIfaceRulesFree(void *opaque)
+{
+    ebiptablesIfaceRules *ifaceRules = opaque;
+
+    g_free(ifaceRules->current);
+    g_free(ifaceRules->pending);
+    g_free(ifaceRules);
+}
+
+
+/* Must be called with ebiptablesIfaceRulesLock held */
+static ebiptablesIfaceRules *
+ebiptablesIfaceRulesGet(const char *ifname)
+{
+    ebiptablesIfaceRules *ifaceRules;
+
+    if (!ebiptablesIfaceRulesTable)
+        ebiptablesIfaceRulesTable = virHashNew(ebiptablesIfaceRulesFree);
+
+    if (!(ifaceRules = virHashLookup(ebiptablesIfaceRulesTable, ifname))) {
+        ifaceRules = g_new0(ebiptablesIfaceRules, 1);
+        g_hash_table_insert(ebiptablesIfaceRulesTable,
+                            g_strdup(ifname), ifaceRules);
+    }
+
+    return ifaceRules;
+}
+
+
+static char *
+ebiptablesFirewallDigest(virFirewall *fw)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+
+    if (virFirewallFormat(&buf, fw) < 0)
+        return NULL;
+
+    return g_compute_checksum_for_string(G_CHECKSUM_SHA256,
+                                         virBufferCurrentContent(&buf), -1);
+}
+
+
+/**
+ * ebiptablesForgetRules:
+ * @ifname: the name of the interface, or NULL for all interfaces
+ *
+ * Forget which rules were instantiated for @ifname, so that the next
+ * instantiation is done in full.
+ */
+static void
+ebiptablesForgetRules(const char *ifname)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&ebiptablesIfaceRulesLock);
+
+    if (!ebiptablesIfaceRulesTable)
+        return;
+
+    if (ifname)
+        g_hash_table_remove(ebiptablesIfaceRulesTable, ifname);
+    else
+        g_hash_table_remove_all(ebiptablesIfaceRulesTable);
+}
+
+
 static int
 ebiptablesApplyNewRules(const char *ifname,
                         virNWFilterRuleInst **rules,
@@ -3310,6 +3395,8 @@ ebiptablesApplyNewRules(const char *ifname,
     bool haveIp6tables = false;
     g_autofree ebtablesSubChainInst **subchains = NULL;
     size_t nsubchains = 0;
+    g_autofree char *digest = NULL;
+    bool unchanged = false;
     int ret = -1;
 
     if (nrules) {
@@ -3494,9 +3581,32 @@ ebiptablesApplyNewRules(const char *ifname,
     ebtablesRemoveTmpRootChainFW(fw, true, ifname);
     ebtablesRemoveTmpRootChainFW(fw, false, ifname);
 
+    if (!(digest = ebiptablesFirewallDigest(fw)))
+        goto cleanup;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&ebiptablesIfaceRulesLock) {
+        ebiptablesIfaceRules *ifaceRules = ebiptablesIfaceRulesGet(ifname);
+
+        g_clear_pointer(&ifaceRules->pending, g_free);
+        unchanged = STREQ_NULLABLE(ifaceRules->current, digest);
+        ifaceRules->unchanged = unchanged;
+    }
+
+    if (unchanged) {
+        VIR_DEBUG("Rules for interface %s are unchanged", ifname);
+        ret = 0;
+        goto cleanup;
+    }
+
     if (virFirewallApply(fw) < 0)
         goto cleanup;
 
+    VIR_WITH_MUTEX_LOCK_GUARD(&ebiptablesIfaceRulesLock) {
+        ebiptablesIfaceRules *ifaceRules = ebiptablesIfaceRulesGet(ifname);
+
+        ifaceRules->pending = g_steal_pointer(&digest);
+    }
+
     ret = 0;
 
  cleanup:
@@ -3529,6 +3639,18 @@ ebiptablesTearNewRules(const char *ifname)
 {
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
 
+    VIR_WITH_MUTEX_LOCK_GUARD(&ebiptablesIfaceRulesLock) {
+        ebiptablesIfaceRules *ifaceRules = ebiptablesIfaceRulesGet(ifname);
+        bool unchanged = ifaceRules->unchanged;
+
+        g_clear_pointer(&ifaceRules->pending, g_free);
+        ifaceRules->unchanged = false;
+
+        /* no temporary chains were created */
+        if (unchanged)
+            return 0;
+    }
+
     virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
 
     ebiptablesTearNewRulesFW(fw, ifname);
@@ -3541,6 +3663,20 @@ ebiptablesTearOldRules(const char *ifname)
 {
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
 
+    VIR_WITH_MUTEX_LOCK_GUARD(&ebiptablesIfaceRulesLock) {
+        ebiptablesIfaceRules *ifaceRules = ebiptablesIfaceRulesGet(ifname);
+        bool unchanged = ifaceRules->unchanged;
+
+        ifaceRules->unchanged = false;
+
+        /* the active chains already hold the new rules */
+        if (unchanged)
+            return 0;
+
+        g_free(ifaceRules->current);
+        ifaceRules->current = g_steal_pointer(&ifaceRules->pending);
+    }
+
     virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
 
     iptablesUnlinkRootChainsFW(fw, VIR_FIREWALL_LAYER_IPV4, ifname);
@@ -3576,6 +3712,8 @@ ebiptablesAllTeardown(const char *ifname)
 {
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
 
+    ebiptablesForgetRules(ifname);
+
     virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
 
     ebiptablesTearNewRulesFW(fw, ifname);
@@ -3611,6 +3749,7 @@ virNWFilterTechDriver ebiptables_driver = {
     .tearNewRules        = ebiptablesTearNewRules,
     .tearOldRules        = ebiptablesTearOldRules,
     .allTeardown         = ebiptablesAllTeardown,
+    .forgetRules         = ebiptablesForgetRules,
 
     .canApplyBasicRules  = ebiptablesCanApplyBasicRules,
     .applyBasicRules     = ebtablesApplyBasicRules,
@@ -3634,5 +3773,6 @@ ebiptablesDriverInit(bool privileged)
 static void
 ebiptablesDriverShutdown(void)
 {
+    ebiptablesForgetRules(NULL);
     ebiptables_driver.flags = 0;
 }
@@ -75,6 +75,24 @@ void virNWFilterTechDriversShutdown(void)
 }
 
 
+/**
+ * virNWFilterTechDriversForgetRules:
+ *
+ * Make the technology drivers forget which rules they instantiated,
+ * e.g. because the firewall may have been flushed behind our back.
+ */
+void virNWFilterTechDriversForgetRules(void)
+{
+    size_t i = 0;
+    while (filter_tech_drivers[i]) {
+        if ((filter_tech_drivers[i]->flags & TECHDRV_FLAG_INITIALIZED) &&
+            filter_tech_drivers[i]->forgetRules)
+            filter_tech_drivers[i]->forgetRules(NULL);
+        i++;
+    }
+}
+
+
 static virNWFilterTechDriver *
 virNWFilterTechDriverForName(const char *name)
 {
@@ -187,115 +205,145 @@ virNWFilterCreateVarsFrom(GHashTable *vars1,
 }
 
 
-typedef struct _virNWFilterInst virNWFilterInst;
-struct _virNWFilterInst {
-    virNWFilterObj **filters;
-    size_t nfilters;
-    virNWFilterRuleInst **rules;
+typedef struct _virNWFilterTemplateRule virNWFilterTemplateRule;
+struct _virNWFilterTemplateRule {
+    virNWFilterDef *def;
+    virNWFilterRuleDef *rule;
+    size_t scope;
+};
+
+/* A filter tree flattened into its rules, compiled once and shared by all
+ * interfaces using the filter. Variables are slots filled in for every
+ * interface by substituting the parameters of its binding. */
+typedef struct _virNWFilterTemplate virNWFilterTemplate;
+struct _virNWFilterTemplate {
+    /* parameters of the includes leading to the rules of a scope with the
+     * outer ones taking precedence; NULL for the top level filter */
+    GHashTable **scopes;
+    size_t nscopes;
+    virNWFilterTemplateRule *rules;
     size_t nrules;
+    bool usesNewFilter;
 };
 
 
 static void
-virNWFilterInstReset(virNWFilterInst *inst)
+virNWFilterTemplateFree(virNWFilterTemplate *tmpl)
 {
     size_t i;
 
-    for (i = 0; i < inst->nfilters; i++)
-        virNWFilterObjUnlock(inst->filters[i]);
-    g_clear_pointer(&inst->filters, g_free);
-    inst->nfilters = 0;
+    if (!tmpl)
+        return;
 
-    for (i = 0; i < inst->nrules; i++)
-        virNWFilterRuleInstFree(inst->rules[i]);
-    g_clear_pointer(&inst->rules, g_free);
-    inst->nrules = 0;
+    for (i = 0; i < tmpl->nscopes; i++)
+        g_clear_pointer(&tmpl->scopes[i], g_hash_table_unref);
+    g_free(tmpl->scopes);
+    g_free(tmpl->rules);
+    g_free(tmpl);
 }
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNWFilterTemplate, virNWFilterTemplateFree);
 
 
-static int
-virNWFilterDefToInst(virNWFilterDriverState *driver,
-                     virNWFilterDef *def,
-                     GHashTable *vars,
-                     enum instCase useNewFilter,
-                     bool *foundNewFilter,
-                     virNWFilterInst *inst);
+/* Compiled templates keyed by filter name, one table for each instCase.
+ * The templates point to the filter definitions, which are only replaced
+ * while holding the filter update lock, so they are accessed with that
+ * lock held and forgotten whenever a definition changes. */
+static GHashTable *virNWFilterTemplates[INSTANTIATE_FOLLOW_NEWFILTER + 1];
 
-static int
-virNWFilterRuleDefToRuleInst(virNWFilterDef *def,
-                             virNWFilterRuleDef *rule,
-                             GHashTable *vars,
-                             virNWFilterInst *inst)
+
+/**
+ * virNWFilterForgetTemplates:
+ *
+ * Drop the compiled filter templates because the filter definitions they
+ * were compiled from changed.
+ *
+ * Call this function while holding the NWFilter filter update lock
+ */
+void virNWFilterForgetTemplates(void)
 {
-    g_autoptr(GHashTable) tmpvars = virHashNew(virNWFilterVarValueHashFree);
-    virNWFilterRuleInst *ruleinst;
+    size_t i;
 
-    if (virNWFilterHashTablePutAll(vars, tmpvars) < 0)
-        return -1;
+    for (i = 0; i < G_N_ELEMENTS(virNWFilterTemplates); i++)
+        g_clear_pointer(&virNWFilterTemplates[i], g_hash_table_unref);
+}
 
-    ruleinst = g_new0(virNWFilterRuleInst, 1);
 
-    ruleinst->chainSuffix = def->chainsuffix;
-    ruleinst->chainPriority = def->chainPriority;
-    ruleinst->def = rule;
-    ruleinst->priority = rule->priority;
-    ruleinst->vars = g_steal_pointer(&tmpvars);
+/**
+ * virNWFilterTemplateCompile:
+ * @driver: the driver state pointer
+ * @def: The filter to compile
+ * @scope: index of the scope of the rules of @def in @tmpl
+ * @useNewFilter: instruct whether to use a newDef pointer rather than a
+ *  def ptr which is useful during a filter update
+ * @tmpl: template to be filled with the rules
+ *
+ * Recursively expand a nested filter into a flat list of rules, in a
+ * depth-first traversal of the tree.
+ *
+ * Returns 0 on success, -1 on error
+ */
+static int
+virNWFilterTemplateCompile(virNWFilterDriverState *driver,
+                           virNWFilterDef *def,
+                           size_t scope,
+                           enum instCase useNewFilter,
+                           virNWFilterTemplate *tmpl)
+{
+    size_t i;
 
-    VIR_APPEND_ELEMENT(inst->rules, inst->nrules, ruleinst);
+    for (i = 0; i < def->nentries; i++) {
+        virNWFilterRuleDef *rule = def->filterEntries[i]->rule;
+        virNWFilterIncludeDef *inc = def->filterEntries[i]->include;
 
-    return 0;
-}
+        if (rule) {
+            virNWFilterTemplateRule tmplrule = {
+                .def = def,
+                .rule = rule,
+                .scope = scope,
+            };
 
+            VIR_APPEND_ELEMENT(tmpl->rules, tmpl->nrules, tmplrule);
+        } else if (inc) {
+            g_autoptr(GHashTable) params = virHashNew(virNWFilterVarValueHashFree);
+            virNWFilterObj *obj;
+            virNWFilterDef *childdef;
+            virNWFilterDef *newChilddef;
 
-static int
-virNWFilterIncludeDefToRuleInst(virNWFilterDriverState *driver,
-                                virNWFilterIncludeDef *inc,
-                                GHashTable *vars,
-                                enum instCase useNewFilter,
-                                bool *foundNewFilter,
-                                virNWFilterInst *inst)
-{
-    virNWFilterObj *obj;
-    g_autoptr(GHashTable) tmpvars = NULL;
-    virNWFilterDef *childdef;
-    virNWFilterDef *newChilddef;
+            VIR_DEBUG("Compiling filter %s", inc->filterref);
 
-    VIR_DEBUG("Instantiating filter %s", inc->filterref);
+            /* variables of the outer filters overwrite the parameters */
+            if (virNWFilterHashTablePutAll(inc->params, params) < 0 ||
+                (tmpl->scopes[scope] &&
+                 virNWFilterHashTablePutAll(tmpl->scopes[scope], params) < 0))
+                return -1;
 
-    /* create a temporary hashmap for depth-first tree traversal */
-    if (!(tmpvars = virNWFilterCreateVarsFrom(inc->params, vars)))
-        return -1;
+            if (!(obj = virNWFilterObjListFindInstantiateFilter(driver->nwfilters,
+                                                                inc->filterref)))
+                return -1;
 
-    /* 'obj' is always appended to 'inst->filters' thus we don't unlock it */
-    if (!(obj = virNWFilterObjListFindInstantiateFilter(driver->nwfilters,
-                                                        inc->filterref)))
-        return -1;
+            childdef = virNWFilterObjGetDef(obj);
 
-    childdef = virNWFilterObjGetDef(obj);
+            switch (useNewFilter) {
+            case INSTANTIATE_FOLLOW_NEWFILTER:
+                newChilddef = virNWFilterObjGetNewDef(obj);
+                if (newChilddef) {
+                    childdef = newChilddef;
+                    tmpl->usesNewFilter = true;
+                }
+                break;
+            case INSTANTIATE_ALWAYS:
+                break;
+            }
 
-    switch (useNewFilter) {
-    case INSTANTIATE_FOLLOW_NEWFILTER:
-        newChilddef = virNWFilterObjGetNewDef(obj);
-        if (newChilddef) {
-            childdef = newChilddef;
-            *foundNewFilter = true;
-        }
-        break;
-    case INSTANTIATE_ALWAYS:
-        break;
-    }
+            virNWFilterObjUnlock(obj);
 
-    VIR_APPEND_ELEMENT(inst->filters, inst->nfilters, obj);
+            VIR_APPEND_ELEMENT(tmpl->scopes, tmpl->nscopes, params);
 
-    if (virNWFilterDefToInst(driver,
-                             childdef,
-                             tmpvars,
-                             useNewFilter,
-                             foundNewFilter,
-                             inst) < 0) {
-        virNWFilterInstReset(inst);
-        return -1;
+            if (virNWFilterTemplateCompile(driver, childdef, tmpl->nscopes - 1,
+                                           useNewFilter, tmpl) < 0)
+                return -1;
+        }
     }
 
     return 0;
@@ -303,137 +351,172 @@ virNWFilterIncludeDefToRuleInst(virNWFilterDriverState *driver,
 
 
 /**
- * virNWFilterDefToInst:
+ * virNWFilterTemplateGet:
  * @driver: the driver state pointer
- * @def: The filter to instantiate
- * @vars: A map holding variable names and values used for instantiating
- *  the filter and its subfilters.
+ * @filter: The filter to get the template of
  * @useNewFilter: instruct whether to use a newDef pointer rather than a
  *  def ptr which is useful during a filter update
- * @foundNewFilter: pointer to int indivating whether a newDef pointer was
- *  ever used; variable expected to be initialized to 0 by caller
- * @rulesout: array to be filled with rule instance
- * @nrulesout: counter to be filled with number of rule instances
  *
- * Recursively expand a nested filter into a flat list of rule instances,
- * in a depth-first traversal of the tree.
+ * Returns the template of @filter, compiling it if needed, or NULL on
+ * error. The template is owned by the cache.
+ */
+static virNWFilterTemplate *
+virNWFilterTemplateGet(virNWFilterDriverState *driver,
+                       virNWFilterDef *filter,
+                       enum instCase useNewFilter)
+{
+    GHashTable **templates = &virNWFilterTemplates[useNewFilter];
+    g_autoptr(virNWFilterTemplate) tmpl = NULL;
+    GHashTable *top = NULL;
+    virNWFilterTemplate *ret;
+
+    if (*templates &&
+        (ret = g_hash_table_lookup(*templates, filter->name)))
+        return ret;
+
+    tmpl = g_new0(virNWFilterTemplate, 1);
+    VIR_APPEND_ELEMENT(tmpl->scopes, tmpl->nscopes, top);
+
+    if (virNWFilterTemplateCompile(driver, filter, 0, useNewFilter, tmpl) < 0)
+        return NULL;
+
+    if (!*templates)
+        *templates = virHashNew((GDestroyNotify) virNWFilterTemplateFree);
+
+    ret = tmpl;
+    g_hash_table_insert(*templates, g_strdup(filter->name),
+                        g_steal_pointer(&tmpl));
+
+    return ret;
+}
+
+
+typedef struct _virNWFilterInst virNWFilterInst;
+struct _virNWFilterInst {
+    /* variables of each scope of the template */
+    GHashTable **vars;
+    size_t nvars;
+    virNWFilterRuleInst **rules;
+    size_t nrules;
+};
+
+
+static void
+virNWFilterInstReset(virNWFilterInst *inst)
+{
+    size_t i;
+
+    for (i = 0; i < inst->nvars; i++)
+        g_clear_pointer(&inst->vars[i], g_hash_table_unref);
+    g_clear_pointer(&inst->vars, g_free);
+    inst->nvars = 0;
+
+    for (i = 0; i < inst->nrules; i++)
+        virNWFilterRuleInstFree(inst->rules[i]);
+    g_clear_pointer(&inst->rules, g_free);
+    inst->nrules = 0;
+}
+
+
+/**
+ * virNWFilterTemplateBindVars:
+ * @tmpl: the template to instantiate
+ * @vars: A map holding variable names and values of the interface
+ * @inst: instance to be filled with the variables of each scope
+ *
+ * Substitute the values of the interface for the variables of the
+ * template. The values in @vars overwrite the parameters of includes.
  *
  * Returns 0 on success, -1 on error
  */
 static int
-virNWFilterDefToInst(virNWFilterDriverState *driver,
-                     virNWFilterDef *def,
-                     GHashTable *vars,
-                     enum instCase useNewFilter,
-                     bool *foundNewFilter,
-                     virNWFilterInst *inst)
+virNWFilterTemplateBindVars(virNWFilterTemplate *tmpl,
+                            GHashTable *vars,
+                            virNWFilterInst *inst)
 {
     size_t i;
-    int ret = -1;
 
-    for (i = 0; i < def->nentries; i++) {
-        if (def->filterEntries[i]->rule) {
-            if (virNWFilterRuleDefToRuleInst(def,
-                                             def->filterEntries[i]->rule,
-                                             vars,
-                                             inst) < 0)
-                goto cleanup;
-        } else if (def->filterEntries[i]->include) {
-            if (virNWFilterIncludeDefToRuleInst(driver,
-                                                def->filterEntries[i]->include,
-                                                vars,
-                                                useNewFilter, foundNewFilter,
-                                                inst) < 0)
-                goto cleanup;
+    inst->vars = g_new0(GHashTable *, tmpl->nscopes);
+    inst->nvars = tmpl->nscopes;
+
+    for (i = 0; i < tmpl->nscopes; i++) {
+        if (!tmpl->scopes[i]) {
+            inst->vars[i] = g_hash_table_ref(vars);
+            continue;
         }
+
+        if (!(inst->vars[i] = virNWFilterCreateVarsFrom(tmpl->scopes[i], vars)))
+            return -1;
     }
 
-    ret = 0;
- cleanup:
-    if (ret < 0)
-        virNWFilterInstReset(inst);
-    return ret;
+    return 0;
 }
 
 
 static int
-virNWFilterDetermineMissingVarsRec(virNWFilterDef *filter,
-                                   GHashTable *vars,
-                                   GHashTable *missing_vars,
-                                   int useNewFilter,
-                                   virNWFilterDriverState *driver)
+virNWFilterTemplateDetermineMissingVars(virNWFilterTemplate *tmpl,
+                                        virNWFilterInst *inst,
+                                        GHashTable *missing_vars)
 {
-    virNWFilterObj *obj;
-    int rc = 0;
     size_t i, j;
-    virNWFilterDef *next_filter;
-    virNWFilterDef *newNext_filter;
+    int rc;
     virNWFilterVarValue *val;
 
-    for (i = 0; i < filter->nentries; i++) {
-        virNWFilterRuleDef *   rule = filter->filterEntries[i]->rule;
-        virNWFilterIncludeDef *inc  = filter->filterEntries[i]->include;
-        if (rule) {
-            /* check all variables of this rule */
-            for (j = 0; j < rule->nVarAccess; j++) {
-                if (!virNWFilterVarAccessIsAvailable(rule->varAccess[j],
-                                                     vars)) {
-                    g_autofree char *varAccess = NULL;
-                    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
-
-                    virNWFilterVarAccessPrint(rule->varAccess[j], &buf);
-
-                    if (!(val = virNWFilterVarValueCreateSimpleCopyValue("1")))
-                        return -1;
-
-                    varAccess = virBufferContentAndReset(&buf);
-                    rc = virHashUpdateEntry(missing_vars, varAccess, val);
-                    if (rc < 0) {
-                        virNWFilterVarValueFree(val);
-                        return -1;
-                    }
-                }
-            }
-        } else if (inc) {
-            g_autoptr(GHashTable) tmpvars = NULL;
+    for (i = 0; i < tmpl->nrules; i++) {
+        virNWFilterRuleDef *rule = tmpl->rules[i].rule;
+        GHashTable *vars = inst->vars[tmpl->rules[i].scope];
 
-            VIR_DEBUG("Following filter %s", inc->filterref);
-            if (!(obj = virNWFilterObjListFindInstantiateFilter(driver->nwfilters,
-                                                                inc->filterref)))
-                return -1;
+        /* check all variables of this rule */
+        for (j = 0; j < rule->nVarAccess; j++) {
+            if (!virNWFilterVarAccessIsAvailable(rule->varAccess[j],
+                                                 vars)) {
+                g_autofree char *varAccess = NULL;
+                g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
 
-            /* create a temporary hashmap for depth-first tree traversal */
-            if (!(tmpvars = virNWFilterCreateVarsFrom(inc->params, vars))) {
-                virNWFilterObjUnlock(obj);
-                return -1;
-            }
+                virNWFilterVarAccessPrint(rule->varAccess[j], &buf);
 
-            next_filter = virNWFilterObjGetDef(obj);
+                if (!(val = virNWFilterVarValueCreateSimpleCopyValue("1")))
+                    return -1;
 
-            switch (useNewFilter) {
-            case INSTANTIATE_FOLLOW_NEWFILTER:
-                newNext_filter = virNWFilterObjGetNewDef(obj);
-                if (newNext_filter)
-                    next_filter = newNext_filter;
-                break;
-            case INSTANTIATE_ALWAYS:
-                break;
+                varAccess = virBufferContentAndReset(&buf);
+                rc = virHashUpdateEntry(missing_vars, varAccess, val);
+                if (rc < 0) {
+                    virNWFilterVarValueFree(val);
+                    return -1;
+                }
             }
-
-            rc = virNWFilterDetermineMissingVarsRec(next_filter,
-                                                    tmpvars,
-                                                    missing_vars,
-                                                    useNewFilter,
-                                                    driver);
-            virNWFilterObjUnlock(obj);
-            if (rc < 0)
-                return -1;
         }
     }
     return 0;
 }
 
 
+static void
+virNWFilterTemplateToInst(virNWFilterTemplate *tmpl,
+                          virNWFilterInst *inst)
+{
+    size_t i;
+
+    inst->rules = g_new0(virNWFilterRuleInst *, tmpl->nrules);
+    inst->nrules = tmpl->nrules;
+
+    for (i = 0; i < tmpl->nrules; i++) {
+        virNWFilterRuleInst *ruleinst = g_new0(virNWFilterRuleInst, 1);
+        virNWFilterTemplateRule *tmplrule = &tmpl->rules[i];
+
+        ruleinst->chainSuffix = tmplrule->def->chainsuffix;
+        ruleinst->chainPriority = tmplrule->def->chainPriority;
+        ruleinst->def = tmplrule->rule;
+        ruleinst->priority = tmplrule->rule->priority;
+        /* the variables are not modified while the instance exists, so all
+         * rules of a scope can share them rather than each getting a copy */
+        ruleinst->vars = g_hash_table_ref(inst->vars[tmplrule->scope]);
+
+        inst->rules[i] = ruleinst;
+    }
+}
+
+
 /**
  * virNWFilterDoInstantiate:
  * @techdriver: The driver to use for instantiation
@@ -463,6 +546,7 @@ virNWFilterDoInstantiate(virNWFilterTechDriver *techdriver,
                          bool forceWithPendingReq)
 {
     int rc;
+    virNWFilterTemplate *tmpl;
     virNWFilterInst inst = { 0 };
     bool instantiate = true;
     g_autofree char *buf = NULL;
@@ -471,11 +555,13 @@ virNWFilterDoInstantiate(virNWFilterTechDriver *techdriver,
     bool reportIP = false;
     g_autoptr(GHashTable) missing_vars = virHashNew(virNWFilterVarValueHashFree);
 
-    rc = virNWFilterDetermineMissingVarsRec(filter,
-                                            binding->filterparams,
-                                            missing_vars,
-                                            useNewFilter,
-                                            driver);
+    if (!(tmpl = virNWFilterTemplateGet(driver, filter, useNewFilter)) ||
+        virNWFilterTemplateBindVars(tmpl, binding->filterparams, &inst) < 0) {
+        rc = -1;
+        goto error;
+    }
+
+    rc = virNWFilterTemplateDetermineMissingVars(tmpl, &inst, missing_vars);
     if (rc < 0)
         goto error;
 
@@ -526,14 +612,9 @@ virNWFilterDoInstantiate(virNWFilterTechDriver *techdriver,
         goto error;
     }
 
-    rc = virNWFilterDefToInst(driver,
-                              filter,
-                              binding->filterparams,
-                              useNewFilter, foundNewFilter,
-                              &inst);
-
-    if (rc < 0)
-        goto error;
+    virNWFilterTemplateToInst(tmpl, &inst);
+    if (tmpl->usesNewFilter)
+        *foundNewFilter = true;
 
     switch (useNewFilter) {
     case INSTANTIATE_FOLLOW_NEWFILTER:
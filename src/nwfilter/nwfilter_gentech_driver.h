@@ -27,6 +27,8 @@
 
 int virNWFilterTechDriversInit(bool privileged);
 void virNWFilterTechDriversShutdown(void);
+void virNWFilterTechDriversForgetRules(void);
+void virNWFilterForgetTemplates(void);
 
 enum instCase {
     INSTANTIATE_ALWAYS,
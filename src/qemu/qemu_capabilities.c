@@ -45,6 +45,7 @@
 #include "qemu_firmware.h"
 #include "virutil.h"
 #include "virtpm.h"
+#include "virthreadpool.h"
 
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -832,6 +833,20 @@ struct _virQEMUCaps {
     virQEMUCapsAccel kvm;
     virQEMUCapsAccel hvf;
     virQEMUCapsAccel tcg;
+
+    /* Results of APIs computed from the capabilities, see
+     * virQEMUCapsGetCachedResult. Not copied or stored in the cache file. */
+    virMutex resultsLock;
+    GHashTable *results;
+};
+
+/* Maximum number of API results stored in a single virQEMUCaps */
+#define VIR_QEMU_CAPS_MAX_CACHED_RESULTS 256
+
+typedef struct _virQEMUCapsCachedResult virQEMUCapsCachedResult;
+struct _virQEMUCapsCachedResult {
+    char *result;
+    long long expires; /* monotonic time in microseconds, 0 for never */
 };
 
 static virClass *virQEMUCapsClass;
@@ -1026,14 +1041,11 @@ virQEMUCapsGetDefaultEmulator(virArch hostarch,
 static void
 virQEMUCapsInitGuest(virCaps *caps,
                      virFileCache *cache,
-                     virArch hostarch,
+                     const char *binary,
                      virArch guestarch)
 {
-    g_autofree char *binary = NULL;
     g_autoptr(virQEMUCaps) qemuCaps = NULL;
 
-    binary = virQEMUCapsGetDefaultEmulator(hostarch, guestarch);
-
     /* Ignore binary if extracting version info fails */
     if (binary) {
         if (!(qemuCaps = virQEMUCapsCacheLookup(cache, binary))) {
@@ -1194,12 +1206,104 @@ virQEMUCapsProbeHostCPU(virArch hostArch,
 }
 
 
+/* Maximum number of emulators probed in parallel by virQEMUCapsInit */
+#define VIR_QEMU_CAPS_PROBE_MAX_WORKERS 8
+
+static void
+virQEMUCapsPrefetchWorker(void *jobdata,
+                          void *opaque)
+{
+    const char *binary = jobdata;
+    virFileCache *cache = opaque;
+    g_autoptr(virQEMUCaps) qemuCaps = NULL;
+
+    /* Errors are reported again by the caller's own lookup */
+    if (!(qemuCaps = virQEMUCapsCacheLookup(cache, binary)))
+        virResetLastError();
+}
+
+
+/**
+ * virQEMUCapsPrefetch:
+ * @cache: QEMU capabilities cache
+ * @binaries: emulator binaries indexed by guest architecture
+ *
+ * Starts looking up capabilities of all @binaries in background threads so
+ * that emulators which need to be probed (no cache file exists yet or QEMU
+ * was updated) are probed in parallel rather than one by one. The caller is
+ * supposed to look up all @binaries itself afterwards, which either returns
+ * the already probed capabilities or waits for the probe to finish.
+ *
+ * Returns the thread pool doing the lookups, the caller is responsible for
+ * freeing it once the capabilities were looked up. NULL is returned if there
+ * is nothing to probe or the pool cannot be created.
+ */
+static virThreadPool *
+virQEMUCapsPrefetch(virFileCache *cache,
+                    char **binaries)
+{
+    virThreadPool *pool = NULL;
+    size_t nbinaries = 0;
+    size_t nworkers;
+    int ncpus;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        if (binaries[i])
+            nbinaries++;
+    }
+
+    /* Nothing to gain from a separate thread for a single binary */
+    if (nbinaries < 2)
+        return NULL;
+
+    if ((ncpus = virHostCPUGetCount()) <= 0)
+        ncpus = 1;
+
+    nworkers = MIN(nbinaries, MIN(ncpus, VIR_QEMU_CAPS_PROBE_MAX_WORKERS));
+
+    VIR_DEBUG("Looking up capabilities of %zu emulators in %zu threads",
+              nbinaries, nworkers);
+
+    if (!(pool = virThreadPoolNewFull(nworkers, nworkers, 0,
+                                      virQEMUCapsPrefetchWorker,
+                                      "qemu-caps-probe",
+                                      NULL, cache))) {
+        virResetLastError();
+        return NULL;
+    }
+
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        if (!binaries[i])
+            continue;
+
+        /* the same binary may be used for several architectures */
+        for (j = 0; j < i; j++) {
+            if (STREQ_NULLABLE(binaries[i], binaries[j]))
+                break;
+        }
+        if (j < i)
+            continue;
+
+        if (virThreadPoolSendJob(pool, 0, binaries[i]) < 0) {
+            virResetLastError();
+            break;
+        }
+    }
+
+    return pool;
+}
+
+
 virCaps *
 virQEMUCapsInit(virFileCache *cache)
 {
     g_autoptr(virCaps) caps = NULL;
     size_t i;
     virArch hostarch = virArchFromHost();
+    char *binaries[VIR_ARCH_LAST] = { NULL };
+    virThreadPool *pool;
 
     if ((caps = virCapabilitiesNew(hostarch,
                                    true, true)) == NULL)
@@ -1228,7 +1332,19 @@ virQEMUCapsInit(virFileCache *cache)
      * if a qemu-system-$ARCH binary can't be found
      */
     for (i = 0; i < VIR_ARCH_LAST; i++)
-        virQEMUCapsInitGuest(caps, cache, hostarch, i);
+        binaries[i] = virQEMUCapsGetDefaultEmulator(hostarch, i);
+
+    pool = virQEMUCapsPrefetch(cache, binaries);
+
+    for (i = 0; i < VIR_ARCH_LAST; i++)
+        virQEMUCapsInitGuest(caps, cache, binaries[i], i);
+
+    /* All lookups are done by now, jobs which are still queued would only
+     * find the capabilities in the cache. */
+    virThreadPoolFree(pool);
+
+    for (i = 0; i < VIR_ARCH_LAST; i++)
+        g_free(binaries[i]);
 
     return g_steal_pointer(&caps);
 }
@@ -1882,6 +1998,13 @@ virQEMUCapsNew(void)
     qemuCaps->invalidation = true;
     qemuCaps->flags = virBitmapNew(QEMU_CAPS_LAST);
 
+    if (virMutexInit(&qemuCaps->resultsLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to initialize mutex"));
+        virObjectUnref(qemuCaps);
+        return NULL;
+    }
+
     return qemuCaps;
 }
 
@@ -1891,6 +2014,9 @@ virQEMUCapsNewBinary(const char *binary)
 {
     virQEMUCaps *qemuCaps = virQEMUCapsNew();
 
+    if (!qemuCaps)
+        return NULL;
+
     qemuCaps->binary = g_strdup(binary);
 
     return qemuCaps;
@@ -2025,6 +2151,9 @@ virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps)
     g_autoptr(virQEMUCaps) ret = virQEMUCapsNewBinary(qemuCaps->binary);
     size_t i;
 
+    if (!ret)
+        return NULL;
+
     ret->invalidation = qemuCaps->invalidation;
     ret->kvmSupportsNesting = qemuCaps->kvmSupportsNesting;
     ret->kvmSupportsSecureGuest = qemuCaps->kvmSupportsSecureGuest;
@@ -2107,6 +2236,9 @@ void virQEMUCapsDispose(void *obj)
     virQEMUCapsAccelClear(&qemuCaps->kvm);
     virQEMUCapsAccelClear(&qemuCaps->hvf);
     virQEMUCapsAccelClear(&qemuCaps->tcg);
+
+    g_clear_pointer(&qemuCaps->results, g_hash_table_unref);
+    virMutexDestroy(&qemuCaps->resultsLock);
 }
 
 void
@@ -2721,8 +2853,25 @@ static int
 virQEMUCapsProbeQMPDeviceProperties(virQEMUCaps *qemuCaps,
                                     qemuMonitor *mon)
 {
+    g_autofree const char **types = g_new0(const char *,
+                                           G_N_ELEMENTS(virQEMUCapsDeviceProps) + 1);
+    size_t ntypes = 0;
     size_t i;
 
+    for (i = 0; i < G_N_ELEMENTS(virQEMUCapsDeviceProps); i++) {
+        virQEMUCapsDeviceTypeProps *device = virQEMUCapsDeviceProps + i;
+
+        if (device->capsCondition >= 0 &&
+            !virQEMUCapsGet(qemuCaps, device->capsCondition))
+            continue;
+
+        types[ntypes++] = device->type;
+    }
+
+    /* ask for all the types at once rather than one after another */
+    if (qemuMonitorPrefetchDeviceProps(mon, types) < 0)
+        return -1;
+
     for (i = 0; i < G_N_ELEMENTS(virQEMUCapsDeviceProps); i++) {
         virQEMUCapsDeviceTypeProps *device = virQEMUCapsDeviceProps + i;
         g_autoptr(GHashTable) qemuprops = NULL;
@@ -2757,8 +2906,24 @@ static int
 virQEMUCapsProbeQMPObjectProperties(virQEMUCaps *qemuCaps,
                                     qemuMonitor *mon)
 {
+    g_autofree const char **types = g_new0(const char *,
+                                           G_N_ELEMENTS(virQEMUCapsObjectProps) + 1);
+    size_t ntypes = 0;
     size_t i;
 
+    for (i = 0; i < G_N_ELEMENTS(virQEMUCapsObjectProps); i++) {
+        virQEMUCapsObjectTypeProps *props = virQEMUCapsObjectProps + i;
+
+        if (props->capsCondition >= 0 &&
+            !virQEMUCapsGet(qemuCaps, props->capsCondition))
+            continue;
+
+        types[ntypes++] = props->type;
+    }
+
+    if (qemuMonitorPrefetchObjectProps(mon, types) < 0)
+        return -1;
+
     for (i = 0; i < G_N_ELEMENTS(virQEMUCapsObjectProps); i++) {
         virQEMUCapsObjectTypeProps *props = virQEMUCapsObjectProps + i;
         g_auto(GStrv) values = NULL;
@@ -3383,6 +3548,86 @@ virQEMUCapsUpdateCPUDeprecatedFeatures(virQEMUCaps *qemuCaps,
 }
 
 
+static void
+virQEMUCapsCachedResultFree(void *opaque)
+{
+    virQEMUCapsCachedResult *cached = opaque;
+
+    g_free(cached->result);
+    g_free(cached);
+}
+
+
+/**
+ * virQEMUCapsGetCachedResult:
+ * @qemuCaps: QEMU capabilities
+ * @key: identifier of the result
+ *
+ * Results of APIs which are computed only from @qemuCaps and the arguments
+ * passed to the API (e.g., domain capabilities or hypervisor CPU baseline) can
+ * be stored in @qemuCaps using virQEMUCapsSetCachedResult. They are thrown
+ * away once the capabilities are found to be invalid, see
+ * virQEMUCapsCacheIsValid.
+ *
+ * Returns a copy of the result stored for @key or NULL if there's no such
+ * result or it already expired.
+ */
+char *
+virQEMUCapsGetCachedResult(virQEMUCaps *qemuCaps,
+                           const char *key)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&qemuCaps->resultsLock);
+    virQEMUCapsCachedResult *cached;
+
+    if (!qemuCaps->results ||
+        !(cached = virHashLookup(qemuCaps->results, key)))
+        return NULL;
+
+    if (cached->expires && cached->expires < g_get_monotonic_time()) {
+        virHashRemoveEntry(qemuCaps->results, key);
+        return NULL;
+    }
+
+    return g_strdup(cached->result);
+}
+
+
+/**
+ * virQEMUCapsSetCachedResult:
+ * @qemuCaps: QEMU capabilities
+ * @key: identifier of the result
+ * @result: the result to store
+ * @ttl: number of seconds after which the result expires or 0
+ *
+ * Stores a copy of @result in @qemuCaps, see virQEMUCapsGetCachedResult. Use
+ * non-zero @ttl for results which depend on host state which is not covered
+ * by capabilities invalidation (e.g., firmware descriptors).
+ */
+void
+virQEMUCapsSetCachedResult(virQEMUCaps *qemuCaps,
+                           const char *key,
+                           const char *result,
+                           unsigned int ttl)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&qemuCaps->resultsLock);
+    virQEMUCapsCachedResult *cached;
+
+    if (!qemuCaps->results)
+        qemuCaps->results = virHashNew(virQEMUCapsCachedResultFree);
+
+    /* the set of keys is bounded only by the inputs of the APIs */
+    if (virHashSize(qemuCaps->results) >= VIR_QEMU_CAPS_MAX_CACHED_RESULTS)
+        virHashRemoveAll(qemuCaps->results);
+
+    cached = g_new0(virQEMUCapsCachedResult, 1);
+    cached->result = g_strdup(result);
+    if (ttl > 0)
+        cached->expires = g_get_monotonic_time() + ttl * G_USEC_PER_SEC;
+
+    ignore_value(virHashUpdateEntry(qemuCaps->results, key, cached));
+}
+
+
 struct tpmTypeToCaps {
     int type;
     virQEMUCapsFlags caps;
@@ -5567,6 +5812,32 @@ virQEMUCapsIsValid(void *data,
 }
 
 
+/**
+ * virQEMUCapsCacheIsValid:
+ * @data: QEMU capabilities
+ * @privData: private data of the capabilities cache
+ *
+ * Checks whether the capabilities are still valid like virQEMUCapsIsValid
+ * does. Results cached in outdated capabilities are dropped right away as
+ * the capabilities may still be used by callers which looked them up before.
+ */
+bool
+virQEMUCapsCacheIsValid(void *data,
+                        void *privData)
+{
+    virQEMUCaps *qemuCaps = data;
+
+    if (virQEMUCapsIsValid(data, privData))
+        return true;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&qemuCaps->resultsLock) {
+        g_clear_pointer(&qemuCaps->results, g_hash_table_unref);
+    }
+
+    return false;
+}
+
+
 /**
  * virQEMUCapsInitQMPArch:
  * @qemuCaps: QEMU capabilities
@@ -5892,6 +6163,9 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
     g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(binary);
     struct stat sb;
 
+    if (!qemuCaps)
+        return NULL;
+
     /* We would also want to check faccessat if we cared about ACLs,
      * but we don't.  */
     if (stat(binary, &sb) < 0) {
@@ -5977,6 +6251,9 @@ virQEMUCapsLoadFile(const char *filename,
     virQEMUCapsCachePriv *priv = privData;
     int ret;
 
+    if (!qemuCaps)
+        return NULL;
+
     ret = virQEMUCapsLoadCache(priv->hostArch, qemuCaps, filename, false);
     if (ret < 0)
         return NULL;
@@ -5990,7 +6267,7 @@ virQEMUCapsLoadFile(const char *filename,
 
 
 virFileCacheHandlers qemuCapsCacheHandlers = {
-    .isValid = virQEMUCapsIsValid,
+    .isValid = virQEMUCapsCacheIsValid,
     .newData = virQEMUCapsNewData,
     .loadFile = virQEMUCapsLoadFile,
     .saveFile = virQEMUCapsSaveFile,
@@ -7073,6 +7350,14 @@ virQEMUCapsSetMicrocodeVersion(virQEMUCaps *qemuCaps,
 }
 
 
+void
+virQEMUCapsSetInvalidation(virQEMUCaps *qemuCaps,
+                           bool enabled)
+{
+    qemuCaps->invalidation = enabled;
+}
+
+
 static void
 virQEMUCapsStripMachineAliasesForVirtType(virQEMUCaps *qemuCaps,
                                           virDomainVirtType virtType)
@@ -789,6 +789,13 @@ void virQEMUCapsUpdateCPUDeprecatedFeatures(virQEMUCaps *qemuCaps,
                                             virDomainVirtType virtType,
                                             virCPUDef *cpu);
 
+char *virQEMUCapsGetCachedResult(virQEMUCaps *qemuCaps,
+                                 const char *key);
+void virQEMUCapsSetCachedResult(virQEMUCaps *qemuCaps,
+                                const char *key,
+                                const char *result,
+                                unsigned int ttl);
+
 virDomainVirtType virQEMUCapsGetVirtType(virQEMUCaps *qemuCaps);
 
 bool virQEMUCapsIsArchSupported(virQEMUCaps *qemuCaps,
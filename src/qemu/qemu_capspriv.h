@@ -97,6 +97,14 @@ void
 virQEMUCapsSetMicrocodeVersion(virQEMUCaps *qemuCaps,
                                unsigned int microcodeVersion);
 
+void
+virQEMUCapsSetInvalidation(virQEMUCaps *qemuCaps,
+                           bool enabled);
+
+bool
+virQEMUCapsCacheIsValid(void *data,
+                        void *privData);
+
 void
 virQEMUCapsStripMachineAliases(virQEMUCaps *qemuCaps);
 
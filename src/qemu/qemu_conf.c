@@ -81,6 +81,11 @@ VIR_ENUM_IMPL(virQEMUSchedCore,
               "emulator",
               "full");
 
+VIR_ENUM_IMPL(virQEMUNumaPlacement,
+              QEMU_NUMA_PLACEMENT_LAST,
+              "numad",
+              "builtin");
+
 
 static virClass *virQEMUDriverConfigClass;
 static void virQEMUDriverConfigDispose(void *obj);
@@ -287,6 +292,13 @@ virQEMUDriverConfig *virQEMUDriverConfigNew(bool privileged,
     cfg->glusterDebugLevel = 4;
     cfg->stdioLogD = true;
 
+#if WITH_NUMAD
+    cfg->numaPlacement = QEMU_NUMA_PLACEMENT_NUMAD;
+#else
+    cfg->numaPlacement = QEMU_NUMA_PLACEMENT_BUILTIN;
+#endif
+    cfg->numaRebalanceMaxMoves = 1;
+
     cfg->namespaces = virBitmapNew(QEMU_DOMAIN_NS_LAST);
 
     if (privileged &&
@@ -778,6 +790,7 @@ virQEMUDriverConfigLoadProcessEntry(virQEMUDriverConfig *cfg,
     g_autofree char *stdioHandler = NULL;
     g_autofree char *corestr = NULL;
     g_autofree char *schedCore = NULL;
+    g_autofree char *numaPlacement = NULL;
     size_t i;
 
     if (virConfGetValueStringList(conf, "hugetlbfs_mount", true,
@@ -887,6 +900,33 @@ virQEMUDriverConfigLoadProcessEntry(virQEMUDriverConfig *cfg,
         cfg->schedCore = val;
     }
 
+    if (virConfGetValueString(conf, "numa_placement", &numaPlacement) < 0)
+        return -1;
+    if (numaPlacement) {
+        int val = virQEMUNumaPlacementTypeFromString(numaPlacement);
+
+        if (val < 0) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("Unknown numa_placement value %1$s"),
+                           numaPlacement);
+            return -1;
+        }
+
+        cfg->numaPlacement = val;
+    }
+
+    if (virConfGetValueUInt(conf, "numa_rebalance_period",
+                            &cfg->numaRebalancePeriod) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "numa_rebalance_max_moves",
+                            &cfg->numaRebalanceMaxMoves) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "resctrl_dynamic_period",
+                            &cfg->resctrlDynamicPeriod) < 0)
+        return -1;
+
     return 0;
 }
 
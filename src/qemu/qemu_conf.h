@@ -58,8 +58,21 @@ typedef enum {
 
 VIR_ENUM_DECL(virQEMUSchedCore);
 
+typedef enum {
+    QEMU_NUMA_PLACEMENT_NUMAD = 0,
+    QEMU_NUMA_PLACEMENT_BUILTIN,
+
+    QEMU_NUMA_PLACEMENT_LAST
+} virQEMUNumaPlacement;
+
+VIR_ENUM_DECL(virQEMUNumaPlacement);
+
 typedef struct _virQEMUDriver virQEMUDriver;
 
+typedef struct _qemuNumaRebalancer qemuNumaRebalancer;
+
+typedef struct _qemuResctrlScheduler qemuResctrlScheduler;
+
 typedef struct _virQEMUDriverConfig virQEMUDriverConfig;
 
 /* Main driver config. The data in these object
@@ -249,6 +262,11 @@ struct _virQEMUDriverConfig {
 
     virQEMUSchedCore schedCore;
 
+    virQEMUNumaPlacement numaPlacement;
+    unsigned int numaRebalancePeriod;
+    unsigned int numaRebalanceMaxMoves;
+    unsigned int resctrlDynamicPeriod;
+
     char **sharedFilesystems;
 };
 
@@ -335,6 +353,16 @@ struct _virQEMUDriver {
 
     /* Immutable pointer, self-locking APIs */
     virFileCache *nbdkitCapsCache;
+
+    /* Require lock, lazy initialized. Pinned vCPUs of running domains,
+     * see qemuNumaPlacementRegister */
+    GHashTable *numaPlacements;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuNumaRebalancer *numaRebalancer;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuResctrlScheduler *resctrlScheduler;
 };
 
 virQEMUDriverConfig *virQEMUDriverConfigNew(bool privileged,
@@ -3425,7 +3425,8 @@ qemuDomainObjPrivateXMLParse(xmlXPathContextPtr ctxt,
         return -1;
 
     if (n > 0) {
-        qemuCaps = virQEMUCapsNew();
+        if (!(qemuCaps = virQEMUCapsNew()))
+            return -1;
 
         for (i = 0; i < n; i++) {
             g_autofree char *str = virXMLPropString(nodes[i], "name");
@@ -10097,6 +10098,9 @@ qemuProcessEventFree(struct qemuProcessEvent *event)
     case QEMU_PROCESS_EVENT_MEMORY_DEVICE_SIZE_CHANGE:
         qemuMonitorMemoryDeviceSizeChangeFree(event->data);
         break;
+    case QEMU_PROCESS_EVENT_NUMA_REBALANCE:
+        virBitmapFree(event->data);
+        break;
     case QEMU_PROCESS_EVENT_PR_DISCONNECT:
     case QEMU_PROCESS_EVENT_UNATTENDED_MIGRATION:
     case QEMU_PROCESS_EVENT_RESET:
@@ -482,6 +482,7 @@ typedef enum {
     QEMU_PROCESS_EVENT_RESET,
     QEMU_PROCESS_EVENT_NBDKIT_EXITED,
     QEMU_PROCESS_EVENT_SHUTDOWN_COMPLETED,
+    QEMU_PROCESS_EVENT_NUMA_REBALANCE,
 
     QEMU_PROCESS_EVENT_LAST
 } qemuProcessEventType;
@@ -420,6 +420,15 @@ qemuDomainMigrationJobDataToParams(virDomainJobData *jobData,
                                 stats->vfio_data_transferred) < 0)
         goto error;
 
+    if (priv->downtimeLimit &&
+        (virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                 VIR_DOMAIN_JOB_DOWNTIME_LIMIT,
+                                 priv->downtimeLimit) < 0 ||
+         virTypedParamsAddULLong(&par, &npar, &maxpar,
+                                 VIR_DOMAIN_JOB_DOWNTIME_LIMIT_RAISES,
+                                 priv->downtimeLimitRaises) < 0))
+        goto error;
+
  done:
     *type = virDomainJobStatusToType(jobData->status);
     *params = par;
@@ -56,6 +56,10 @@ struct _qemuDomainJobDataPrivate {
         qemuDomainBackupStats backup;
     } stats;
     qemuDomainMirrorStats mirrorStats;
+    /* Downtime limit (ms) tuned automatically during migration, 0 if
+     * the limit is not tuned */
+    unsigned long long downtimeLimit;
+    unsigned long long downtimeLimitRaises;
 };
 
 void qemuDomainJobSetStatsType(virDomainJobData *jobData,
@@ -44,6 +44,8 @@
 #include "qemu_process.h"
 #include "qemu_migration.h"
 #include "qemu_migration_params.h"
+#include "qemu_numa_placement.h"
+#include "qemu_resctrl.h"
 #include "qemu_blockjob.h"
 #include "qemu_security.h"
 #include "qemu_checkpoint.h"
@@ -57,6 +59,7 @@
 #include "virlog.h"
 #include "datatypes.h"
 #include "virbuffer.h"
+#include "vircrypto.h"
 #include "virhostcpu.h"
 #include "virhostmem.h"
 #include "virnetdevtap.h"
@@ -129,6 +132,10 @@ VIR_LOG_INIT("qemu.qemu_driver");
 
 #define QEMU_NB_BANDWIDTH_PARAM 7
 
+/* Formatted domain capabilities depend on host state (firmware descriptors,
+ * VFIO, swtpm, ...) which does not invalidate QEMU capabilities. */
+#define QEMU_DOMAIN_CAPS_CACHE_TTL 30
+
 VIR_ENUM_DECL(qemuDumpFormat);
 VIR_ENUM_IMPL(qemuDumpFormat,
               VIR_DOMAIN_CORE_DUMP_FORMAT_LAST,
@@ -902,6 +909,12 @@ qemuStateInitialize(bool privileged,
 
     qemuProcessReconnectAll(qemu_driver);
 
+    if (qemuNumaRebalancerStart(qemu_driver) < 0)
+        goto error;
+
+    if (qemuResctrlSchedulerStart(qemu_driver) < 0)
+        goto error;
+
     autostartCfg = (virDomainDriverAutoStartConfig) {
         .stateDir = cfg->stateDir,
         .callback = qemuAutostartDomain,
@@ -983,6 +996,8 @@ qemuStateStop(void)
 static int
 qemuStateShutdownPrepare(void)
 {
+    qemuNumaRebalancerStop(qemu_driver);
+    qemuResctrlSchedulerStop(qemu_driver);
     virThreadPoolStop(qemu_driver->workerPool);
     return 0;
 }
@@ -1020,8 +1035,11 @@ qemuStateCleanup(void)
     if (!qemu_driver)
         return -1;
 
+    qemuNumaRebalancerStop(qemu_driver);
+    qemuResctrlSchedulerStop(qemu_driver);
     virThreadPoolFree(qemu_driver->workerPool);
     virObjectUnref(qemu_driver->migrationErrors);
+    g_clear_pointer(&qemu_driver->numaPlacements, g_hash_table_unref);
     virLockManagerPluginUnref(qemu_driver->lockManager);
     virSysinfoDefFree(qemu_driver->hostsysinfo);
     virPortAllocatorRangeFree(qemu_driver->migrationPorts);
@@ -1137,6 +1155,7 @@ qemuConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD:
     case VIR_DRV_FEATURE_TYPED_PARAM_STRING:
     case VIR_DRV_FEATURE_NETWORK_UPDATE_HAS_CORRECT_ORDER:
     case VIR_DRV_FEATURE_FD_PASSING:
@@ -4059,6 +4078,57 @@ processShutdownCompletedEvent(virDomainObj *vm)
 }
 
 
+static void
+processNumaRebalanceEvent(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          virBitmap *nodeset)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    virObjectEvent *event = NULL;
+    virTypedParameterPtr eventParams = NULL;
+    int eventNparams = 0;
+    int eventMaxparams = 0;
+    g_autofree char *nodesetStr = NULL;
+    g_autofree char *cpusetStr = NULL;
+
+    if (virDomainObjBeginJob(vm, VIR_JOB_MODIFY) < 0)
+        return;
+
+    if (!qemuNumaPlacementCanMove(vm)) {
+        VIR_DEBUG("Domain '%s' can no longer be moved to other NUMA nodes",
+                  vm->def->name);
+        if (virDomainObjIsActive(vm))
+            qemuNumaPlacementRegister(driver, vm);
+        goto endjob;
+    }
+
+    if (qemuNumaPlacementMove(driver, vm, nodeset) < 0) {
+        VIR_WARN("Unable to move domain '%s' to other NUMA nodes: %s",
+                 vm->def->name, virGetLastErrorMessage());
+        qemuNumaPlacementRegister(driver, vm);
+        goto endjob;
+    }
+
+    qemuDomainSaveStatus(vm);
+
+    nodesetStr = virBitmapFormat(priv->autoNodeset);
+    cpusetStr = virBitmapFormat(priv->autoCpuset);
+
+    if (virTypedParamsAddString(&eventParams, &eventNparams, &eventMaxparams,
+                                VIR_DOMAIN_TUNABLE_NUMA_NODESET, nodesetStr) < 0 ||
+        virTypedParamsAddString(&eventParams, &eventNparams, &eventMaxparams,
+                                VIR_DOMAIN_TUNABLE_NUMA_CPUSET, cpusetStr) < 0)
+        goto endjob;
+
+    event = virDomainEventTunableNewFromObj(vm, &eventParams, eventNparams);
+
+ endjob:
+    virDomainObjEndJob(vm);
+    virObjectEventStateQueue(driver->domainEventState, event);
+    virTypedParamsFree(eventParams, eventNparams);
+}
+
+
 static void qemuProcessEventHandler(void *data, void *opaque)
 {
     struct qemuProcessEvent *processEvent = data;
@@ -4125,6 +4195,9 @@ static void qemuProcessEventHandler(void *data, void *opaque)
     case QEMU_PROCESS_EVENT_SHUTDOWN_COMPLETED:
         processShutdownCompletedEvent(vm);
         break;
+    case QEMU_PROCESS_EVENT_NUMA_REBALANCE:
+        processNumaRebalanceEvent(driver, vm, processEvent->data);
+        break;
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
@@ -4344,6 +4417,7 @@ qemuDomainPinVcpuLive(virDomainObj *vm,
     vcpuinfo->cpumask = g_steal_pointer(&tmpmap);
 
     qemuDomainSaveStatus(vm);
+    qemuNumaPlacementRegister(driver, vm);
 
     if (g_snprintf(paramField, VIR_TYPED_PARAM_FIELD_LENGTH,
                    VIR_DOMAIN_TUNABLE_CPU_VCPUPIN, vcpu) < 0) {
@@ -11673,6 +11747,54 @@ qemuConnectCompareCPU(virConnectPtr conn,
 }
 
 
+/**
+ * qemuConnectResultCacheKey:
+ * @api: name of the API
+ * @arch: architecture
+ * @virttype: virtualization type
+ * @machine: machine type or NULL
+ * @flags: flags passed to the API
+ * @xmls: XML documents passed to the API
+ * @nxmls: number of items in @xmls
+ *
+ * Builds a key for virQEMUCapsGetCachedResult identifying a call of @api with
+ * the given arguments. Emulator binary is not part of the key as the results
+ * are stored in virQEMUCaps of the emulator.
+ */
+static char *
+qemuConnectResultCacheKey(const char *api,
+                          virArch arch,
+                          virDomainVirtType virttype,
+                          const char *machine,
+                          unsigned int flags,
+                          const char **xmls,
+                          unsigned int nxmls)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *str = NULL;
+    g_autofree char *hash = NULL;
+    size_t i;
+
+    virBufferAsprintf(&buf, "%s\n%s\n%s\n0x%x\n",
+                      virArchToString(arch),
+                      virDomainVirtTypeToString(virttype),
+                      NULLSTR_EMPTY(machine), flags);
+
+    /* prefix each document with its length to make the key unambiguous */
+    for (i = 0; i < nxmls; i++) {
+        const char *xml = NULLSTR_EMPTY(xmls[i]);
+
+        virBufferAsprintf(&buf, "%zu\n%s", strlen(xml), xml);
+    }
+
+    str = virBufferContentAndReset(&buf);
+    if (virCryptoHashString(VIR_CRYPTO_HASH_SHA256, str, &hash) < 0)
+        return NULL;
+
+    return g_strdup_printf("%s:%s", api, hash);
+}
+
+
 static virCPUCompareResult
 qemuConnectCPUModelComparison(virQEMUCaps *qemuCaps,
                               const char *libDir,
@@ -11728,6 +11850,9 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
     g_autoptr(virCPUDef) cpu = NULL;
     virArch arch;
     virDomainVirtType virttype;
+    g_autofree char *key = NULL;
+    g_autofree char *cached = NULL;
+    int ret;
 
     virCheckFlags(VIR_CONNECT_COMPARE_CPU_FAIL_INCOMPATIBLE |
                   VIR_CONNECT_COMPARE_CPU_VALIDATE_XML,
@@ -11759,18 +11884,24 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
         return VIR_CPU_COMPARE_ERROR;
     }
 
+    if (!(key = qemuConnectResultCacheKey("compare", arch, virttype, NULL,
+                                          flags, &xmlCPU, 1)))
+        return VIR_CPU_COMPARE_ERROR;
+
+    if ((cached = virQEMUCapsGetCachedResult(qemuCaps, key)) &&
+        virStrToLong_i(cached, NULL, 10, &ret) == 0)
+        return ret;
+
     if (virCPUDefParseXMLString(xmlCPU, VIR_CPU_TYPE_AUTO, &cpu,
                                 validateXML) < 0)
         return VIR_CPU_COMPARE_ERROR;
 
     if (ARCH_IS_X86(arch)) {
-        return qemuDomainCheckCPU(arch, virttype, qemuCaps, cpu,
-                                  VIR_QEMU_CAPS_HOST_CPU_REPORTED,
-                                  failIncompatible);
-    }
-
-    if (ARCH_IS_S390(arch) &&
-        virQEMUCapsGet(qemuCaps, QEMU_CAPS_QUERY_CPU_MODEL_COMPARISON)) {
+        ret = qemuDomainCheckCPU(arch, virttype, qemuCaps, cpu,
+                                 VIR_QEMU_CAPS_HOST_CPU_REPORTED,
+                                 failIncompatible);
+    } else if (ARCH_IS_S390(arch) &&
+               virQEMUCapsGet(qemuCaps, QEMU_CAPS_QUERY_CPU_MODEL_COMPARISON)) {
         if (!cpu->model) {
             if (cpu->mode == VIR_CPU_MODE_HOST_PASSTHROUGH) {
                 cpu->model = g_strdup("host");
@@ -11782,15 +11913,23 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
                 return VIR_CPU_COMPARE_ERROR;
             }
         }
-        return qemuConnectCPUModelComparison(qemuCaps, cfg->libDir,
-                                             cfg->user, cfg->group,
-                                             hvCPU, cpu, failIncompatible);
+        ret = qemuConnectCPUModelComparison(qemuCaps, cfg->libDir,
+                                            cfg->user, cfg->group,
+                                            hvCPU, cpu, failIncompatible);
+    } else {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("comparing with the hypervisor CPU is not supported for arch %1$s"),
+                       virArchToString(arch));
+        return VIR_CPU_COMPARE_ERROR;
     }
 
-    virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
-                   _("comparing with the hypervisor CPU is not supported for arch %1$s"),
-                   virArchToString(arch));
-    return VIR_CPU_COMPARE_ERROR;
+    if (ret != VIR_CPU_COMPARE_ERROR) {
+        g_autofree char *str = g_strdup_printf("%d", ret);
+
+        virQEMUCapsSetCachedResult(qemuCaps, key, str, 0);
+    }
+
+    return ret;
 }
 
 
@@ -11968,6 +12107,7 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
     g_auto(GStrv) features = NULL;
     unsigned int physAddrSize = 0;
     size_t i;
+    g_autofree char *key = NULL;
 
     virCheckFlags(VIR_CONNECT_BASELINE_CPU_EXPAND_FEATURES |
                   VIR_CONNECT_BASELINE_CPU_MIGRATABLE, NULL);
@@ -11977,9 +12117,6 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
 
     migratable = !!(flags & VIR_CONNECT_BASELINE_CPU_MIGRATABLE);
 
-    if (!(cpus = virCPUDefListParse(xmlCPUs, ncpus, VIR_CPU_TYPE_AUTO)))
-        goto cleanup;
-
     qemuCaps = virQEMUCapsCacheLookupDefault(driver->qemuCapsCache,
                                              emulator,
                                              archStr,
@@ -11989,6 +12126,16 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
     if (!qemuCaps)
         goto cleanup;
 
+    if (!(key = qemuConnectResultCacheKey("baseline", arch, virttype, NULL,
+                                          flags, xmlCPUs, ncpus)))
+        goto cleanup;
+
+    if ((cpustr = virQEMUCapsGetCachedResult(qemuCaps, key)))
+        goto cleanup;
+
+    if (!(cpus = virCPUDefListParse(xmlCPUs, ncpus, VIR_CPU_TYPE_AUTO)))
+        goto cleanup;
+
     if (!(cpuModels = virQEMUCapsGetCPUModels(qemuCaps, virttype, NULL, NULL)) ||
         cpuModels->nmodels == 0) {
         virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
@@ -12052,7 +12199,8 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
         cpu->addr->bits = -1;
     }
 
-    cpustr = virCPUDefFormat(cpu, NULL);
+    if ((cpustr = virCPUDefFormat(cpu, NULL)))
+        virQEMUCapsSetCachedResult(qemuCaps, key, cpustr, 0);
 
  cleanup:
     virCPUDefListFree(cpus);
@@ -16697,6 +16845,8 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
     virArch arch;
     virDomainVirtType virttype;
     g_autoptr(virDomainCaps) domCaps = NULL;
+    g_autofree char *key = NULL;
+    char *ret = NULL;
 
     virCheckFlags(VIR_CONNECT_GET_DOMAIN_CAPABILITIES_DISABLE_DEPRECATED_FEATURES,
                   NULL);
@@ -16713,6 +16863,13 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
     if (!qemuCaps)
         return NULL;
 
+    if (!(key = qemuConnectResultCacheKey("domcaps", arch, virttype, machine,
+                                          flags, NULL, 0)))
+        return NULL;
+
+    if ((ret = virQEMUCapsGetCachedResult(qemuCaps, key)))
+        return ret;
+
     if (!(domCaps = virQEMUDriverGetDomainCapabilities(driver,
                                                        qemuCaps, machine,
                                                        arch, virttype)))
@@ -16723,7 +16880,10 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
                                                domCaps->cpu.hostModel);
     }
 
-    return virDomainCapsFormat(domCaps);
+    if ((ret = virDomainCapsFormat(domCaps)))
+        virQEMUCapsSetCachedResult(qemuCaps, key, ret, QEMU_DOMAIN_CAPS_CACHE_TTL);
+
+    return ret;
 }
 
 
@@ -18035,16 +18195,49 @@ qemuDomainGetStats(virConnectPtr conn,
 {
     g_autofree virDomainStatsRecordPtr tmp = NULL;
     g_autoptr(virTypedParamList) params = NULL;
+    qemuDomainObjPrivate *priv = dom->privateData;
+    unsigned int prefetch = 0;
     size_t i;
 
     params = virTypedParamListNew();
 
+    if (HAVE_JOB(flags) && virDomainObjIsActive(dom)) {
+        if (stats & VIR_DOMAIN_STATS_BLOCK)
+            prefetch |= QEMU_MONITOR_PREFETCH_BLOCK_STATS;
+        if (stats & VIR_DOMAIN_STATS_IOTHREAD)
+            prefetch |= QEMU_MONITOR_PREFETCH_IOTHREADS;
+        if (stats & VIR_DOMAIN_STATS_DIRTYRATE)
+            prefetch |= QEMU_MONITOR_PREFETCH_DIRTY_RATE;
+    }
+
+    /* Send the queries of all workers in one go rather than waiting for QEMU
+     * to answer each of them in turn. The workers get the replies from the
+     * monitor. */
+    if (prefetch) {
+        int rc;
+
+        qemuDomainObjEnterMonitor(dom);
+        rc = qemuMonitorPrefetch(priv->mon, prefetch);
+        qemuDomainObjExitMonitor(dom);
+
+        /* the workers will query QEMU themselves */
+        if (rc < 0)
+            virResetLastError();
+    }
+
     for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
         if (stats & qemuDomainGetStatsWorkers[i].stats) {
             qemuDomainGetStatsWorkers[i].func(conn->privateData, dom, params, flags);
         }
     }
 
+    /* don't let the next caller see stale stats */
+    if (prefetch && virDomainObjIsActive(dom)) {
+        qemuDomainObjEnterMonitor(dom);
+        qemuMonitorPrefetchClear(priv->mon);
+        qemuDomainObjExitMonitor(dom);
+    }
+
     tmp = g_new0(virDomainStatsRecord, 1);
 
     if (!(tmp->dom = virGetDomain(conn, dom->def->name,
@@ -1279,6 +1279,146 @@ qemuMigrationSrcNBDStorageCopyOne(virDomainObj *vm,
 }
 
 
+typedef struct _qemuMigrationNBDCopyDisk qemuMigrationNBDCopyDisk;
+struct _qemuMigrationNBDCopyDisk {
+    virDomainDiskDef *disk;
+    unsigned long long capacity;
+    unsigned long long speed; /* bytes per second, 0 means unlimited */
+};
+
+
+static int
+qemuMigrationNBDCopyDiskCompare(const void *a,
+                                const void *b,
+                                void *opaque G_GNUC_UNUSED)
+{
+    const qemuMigrationNBDCopyDisk *da = a;
+    const qemuMigrationNBDCopyDisk *db = b;
+
+    /* largest first */
+    if (da->capacity > db->capacity)
+        return -1;
+    if (da->capacity < db->capacity)
+        return 1;
+    return 0;
+}
+
+
+/**
+ * qemuMigrationSrcNBDStorageCopySplitSpeed:
+ * @disks: disks to be copied
+ * @ndisks: number of items in @disks
+ * @speed: bandwidth of the whole storage migration in bytes per second
+ *
+ * Splits @speed among the mirror jobs in proportion to the capacity of the
+ * disks so that the jobs together stay within @speed and all of them need
+ * about the same time to copy their disk rather than the small disks
+ * finishing early while the largest one is still limited to the same share.
+ * The bandwidth is split evenly if the capacity of any disk is unknown.
+ */
+static void
+qemuMigrationSrcNBDStorageCopySplitSpeed(qemuMigrationNBDCopyDisk *disks,
+                                         size_t ndisks,
+                                         unsigned long long speed)
+{
+    unsigned long long total = 0;
+    size_t i;
+
+    for (i = 0; i < ndisks; i++) {
+        if (disks[i].capacity == 0) {
+            total = 0;
+            break;
+        }
+
+        total += disks[i].capacity;
+    }
+
+    for (i = 0; i < ndisks; i++) {
+        if (speed == 0)
+            disks[i].speed = 0;
+        else if (total == 0)
+            disks[i].speed = speed / ndisks;
+        else
+            disks[i].speed = speed * ((double) disks[i].capacity / total);
+
+        /* 0 would mean unlimited */
+        if (speed > 0 && disks[i].speed == 0)
+            disks[i].speed = 1;
+    }
+}
+
+
+/**
+ * qemuMigrationSrcNBDStorageCopyDisks:
+ * @vm: domain
+ * @migrate_disks: disks selected for migration
+ * @speed: bandwidth of the whole storage migration in bytes per second
+ * @copyDisks: filled with disks to be copied
+ * @ncopyDisks: filled with the number of items in @copyDisks
+ *
+ * Collect the disks which should be copied to the destination ordered by
+ * their capacity, largest first, along with the bandwidth of each mirror
+ * job, see qemuMigrationSrcNBDStorageCopySplitSpeed.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationSrcNBDStorageCopyDisks(virDomainObj *vm,
+                                    const char **migrate_disks,
+                                    unsigned long long speed,
+                                    qemuMigrationNBDCopyDisk **copyDisks,
+                                    size_t *ncopyDisks)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(GHashTable) stats = virHashNew(g_free);
+    g_autofree qemuMigrationNBDCopyDisk *disks = NULL;
+    size_t ndisks = 0;
+    size_t i;
+    int rc;
+
+    disks = g_new0(qemuMigrationNBDCopyDisk, vm->def->ndisks);
+
+    for (i = 0; i < vm->def->ndisks; i++) {
+        virDomainDiskDef *disk = vm->def->disks[i];
+
+        /* check whether disk should be migrated */
+        if (!qemuMigrationAnyCopyDisk(disk, migrate_disks))
+            continue;
+
+        disks[ndisks++].disk = disk;
+    }
+
+    if (ndisks > 1) {
+        if (qemuDomainObjEnterMonitorAsync(vm, VIR_ASYNC_JOB_MIGRATION_OUT) < 0)
+            return -1;
+
+        rc = qemuMonitorBlockStatsUpdateCapacityBlockdev(priv->mon, stats);
+
+        qemuDomainObjExitMonitor(vm);
+
+        if (rc < 0)
+            return -1;
+
+        for (i = 0; i < ndisks; i++) {
+            const char *nodename = qemuBlockStorageSourceGetEffectiveNodename(disks[i].disk->src);
+            qemuBlockStats *entry;
+
+            if ((entry = virHashLookup(stats, nodename)))
+                disks[i].capacity = entry->capacity;
+        }
+
+        g_qsort_with_data(disks, ndisks, sizeof(*disks),
+                          qemuMigrationNBDCopyDiskCompare, NULL);
+    }
+
+    qemuMigrationSrcNBDStorageCopySplitSpeed(disks, ndisks, speed);
+
+    *copyDisks = g_steal_pointer(&disks);
+    *ncopyDisks = ndisks;
+    return 0;
+}
+
+
 /**
  * qemuMigrationSrcNBDStorageCopy:
  * @driver: qemu driver
@@ -1318,6 +1458,8 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriver *driver,
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     g_autoptr(virURI) uri = NULL;
     const char *socket = NULL;
+    g_autofree qemuMigrationNBDCopyDisk *copyDisks = NULL;
+    size_t ncopyDisks = 0;
 
     VIR_DEBUG("Starting drive mirrors for domain %s", vm->def->name);
 
@@ -1372,20 +1514,20 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriver *driver,
         }
     }
 
-    for (i = 0; i < vm->def->ndisks; i++) {
-        virDomainDiskDef *disk = vm->def->disks[i];
-        bool detect_zeroes = false;
+    if (qemuMigrationSrcNBDStorageCopyDisks(vm, migrate_disks, mirror_speed,
+                                            &copyDisks, &ncopyDisks) < 0)
+        return -1;
 
-        /* check whether disk should be migrated */
-        if (!qemuMigrationAnyCopyDisk(disk, migrate_disks))
-            continue;
+    for (i = 0; i < ncopyDisks; i++) {
+        virDomainDiskDef *disk = copyDisks[i].disk;
+        bool detect_zeroes = false;
 
         if (migrate_disks_detect_zeroes)
             detect_zeroes = g_strv_contains(migrate_disks_detect_zeroes, disk->dst);
 
         if (qemuMigrationSrcNBDStorageCopyOne(vm, disk, host, port,
                                               socket,
-                                              mirror_speed, mirror_shallow,
+                                              copyDisks[i].speed, mirror_shallow,
                                               tlsAlias, tlsHostname, detect_zeroes,
                                               flags) < 0)
             return -1;
@@ -2190,24 +2332,153 @@ qemuMigrationAnyCompleted(virDomainObj *vm,
 }
 
 
+typedef struct _qemuMigrationDowntimeTuner qemuMigrationDowntimeTuner;
+struct _qemuMigrationDowntimeTuner {
+    unsigned long long max;         /* upper bound for @limit (ms) */
+    unsigned long long limit;       /* current downtime limit (ms) */
+    unsigned long long iteration;   /* last RAM iteration seen */
+    unsigned long long remaining;   /* RAM remaining at @iteration */
+};
+
+
+static int
+qemuMigrationSrcDowntimeTunerInit(virDomainObj *vm,
+                                  virDomainAsyncJob asyncJob,
+                                  qemuMigrationParams *migParams,
+                                  qemuMigrationDowntimeTuner *tuner)
+{
+    qemuDomainJobDataPrivate *privJob = vm->job->current->privateData;
+    g_autoptr(qemuMigrationParams) current = NULL;
+
+    if (!migParams ||
+        !(tuner->max = qemuMigrationParamsGetDowntimeMax(migParams)))
+        return 0;
+
+    if (qemuMigrationParamsFetch(vm, asyncJob, &current) < 0)
+        return -1;
+
+    if (qemuMigrationParamsGetULL(current, QEMU_MIGRATION_PARAM_DOWNTIME_LIMIT,
+                                  &tuner->limit) < 0)
+        return -1;
+
+    VIR_DEBUG("Downtime limit %llums may be raised up to %llums",
+              tuner->limit, tuner->max);
+
+    privJob->downtimeLimit = tuner->limit;
+    privJob->downtimeLimitRaises = 0;
+    return 0;
+}
+
+
+/**
+ * qemuMigrationSrcDowntimeTunerUpdate:
+ * @vm: domain object
+ * @asyncJob: migration job
+ * @tuner: tuner state
+ *
+ * Double the downtime limit (up to the maximum requested by the user)
+ * whenever a new iteration of RAM migration starts with no less memory
+ * remaining than the previous one, i.e., the guest dirties memory faster
+ * than it can be transferred and the migration would never converge with
+ * the current downtime limit.
+ *
+ * The CPU throttling of auto-converge could be tuned at runtime as well,
+ * but QEMU already increases it by itself after every such iteration when
+ * VIR_MIGRATE_AUTO_CONVERGE is used. Multifd channels and compression
+ * settings cannot be changed once migration started.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationSrcDowntimeTunerUpdate(virDomainObj *vm,
+                                    virDomainAsyncJob asyncJob,
+                                    qemuMigrationDowntimeTuner *tuner)
+{
+    virDomainJobData *jobData = vm->job->current;
+    qemuDomainJobDataPrivate *privJob = jobData->privateData;
+    qemuMonitorMigrationStats *stats = &privJob->stats.mig;
+    g_autoptr(qemuMigrationParams) migParams = NULL;
+    unsigned long long iteration = tuner->iteration;
+    unsigned long long remaining = tuner->remaining;
+    unsigned long long limit;
+
+    if (tuner->limit >= tuner->max)
+        return 0;
+
+    if (qemuMigrationAnyFetchStats(vm, asyncJob, jobData, NULL) < 0)
+        return -1;
+
+    if (stats->status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE ||
+        stats->ram_iteration == tuner->iteration)
+        return 0;
+
+    tuner->iteration = stats->ram_iteration;
+    tuner->remaining = stats->ram_remaining;
+
+    /* the first iteration transfers all memory */
+    if (iteration == 0 || stats->ram_remaining < remaining)
+        return 0;
+
+    limit = MIN(tuner->max, MAX(tuner->limit * 2, 100));
+
+    VIR_INFO("Migration of domain %s does not converge (%llu bytes remaining after iteration %llu), raising downtime limit from %llums to %llums",
+             vm->def->name, stats->ram_remaining, stats->ram_iteration,
+             tuner->limit, limit);
+
+    if (!(migParams = qemuMigrationParamsNew()) ||
+        qemuMigrationParamsSetULL(migParams,
+                                  QEMU_MIGRATION_PARAM_DOWNTIME_LIMIT,
+                                  limit) < 0 ||
+        qemuMigrationParamsUpdate(vm, asyncJob, migParams) < 0)
+        return -1;
+
+    tuner->limit = limit;
+    privJob->downtimeLimit = limit;
+    privJob->downtimeLimitRaises++;
+    return 0;
+}
+
+
 /* Returns 0 on success, -2 when migration needs to be cancelled, or -1 when
  * QEMU reports failed migration.
+ *
+ * If @migParams request it, the downtime limit is raised while waiting
+ * for a migration which does not converge.
  */
 static int
 qemuMigrationSrcWaitForCompletion(virDomainObj *vm,
                                   virDomainAsyncJob asyncJob,
                                   virConnectPtr dconn,
+                                  qemuMigrationParams *migParams,
                                   unsigned int flags)
 {
     virDomainJobData *jobData = vm->job->current;
+    qemuMigrationDowntimeTuner tuner = { 0 };
     int rv;
 
     jobData->status = VIR_DOMAIN_JOB_STATUS_MIGRATING;
 
+    if (qemuMigrationSrcDowntimeTunerInit(vm, asyncJob, migParams, &tuner) < 0) {
+        VIR_WARN("Cannot tune downtime limit of domain %s migration: %s",
+                 vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+        tuner.max = 0;
+    }
+
     while ((rv = qemuMigrationAnyCompleted(vm, asyncJob, dconn, flags)) != 1) {
         if (rv < 0)
             return rv;
 
+        /* failing to tune the downtime limit is not a reason to give up
+         * on the migration itself */
+        if (tuner.max > 0 &&
+            qemuMigrationSrcDowntimeTunerUpdate(vm, asyncJob, &tuner) < 0) {
+            VIR_WARN("Stopped tuning downtime limit of domain %s migration: %s",
+                     vm->def->name, virGetLastErrorMessage());
+            virResetLastError();
+            tuner.max = 0;
+        }
+
         if (qemuDomainObjWait(vm) < 0) {
             if (qemuDomainObjIsActive(vm))
                 jobData->status = VIR_DOMAIN_JOB_STATUS_FAILED;
@@ -5118,7 +5389,7 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
         waitFlags |= QEMU_MIGRATION_COMPLETED_POSTCOPY;
 
     rc = qemuMigrationSrcWaitForCompletion(vm, VIR_ASYNC_JOB_MIGRATION_OUT,
-                                           dconn, waitFlags);
+                                           dconn, migParams, waitFlags);
     if (rc == -2)
         goto error;
 
@@ -5159,7 +5430,7 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
 
         rc = qemuMigrationSrcWaitForCompletion(vm,
                                                VIR_ASYNC_JOB_MIGRATION_OUT,
-                                               dconn, waitFlags);
+                                               dconn, NULL, waitFlags);
         if (rc == -2)
             goto error;
 
@@ -5293,7 +5564,7 @@ qemuMigrationSrcResume(virDomainObj *vm,
     if (priv->migrationRecoverSetup) {
         VIR_DEBUG("Waiting for post-copy recovery to start");
         if (qemuMigrationSrcWaitForCompletion(vm, VIR_ASYNC_JOB_MIGRATION_OUT, dconn,
-                                              QEMU_MIRGATION_COMPLETED_RECOVERY) < 0)
+                                              NULL, QEMU_MIRGATION_COMPLETED_RECOVERY) < 0)
             return -1;
     } else {
         VIR_WARN("QEMU is too old, we may report a failure in post-copy phase even though the migration may be running just fine");
@@ -7276,7 +7547,7 @@ qemuMigrationSrcToFile(virQEMUDriver *driver, virDomainObj *vm,
     if (rc < 0)
         goto cleanup;
 
-    rc = qemuMigrationSrcWaitForCompletion(vm, asyncJob, NULL, 0);
+    rc = qemuMigrationSrcWaitForCompletion(vm, asyncJob, NULL, NULL, 0);
 
     if (rc < 0) {
         if (rc == -2) {
@@ -93,6 +93,7 @@
     VIR_MIGRATE_PARAM_TLS_DESTINATION, VIR_TYPED_PARAM_STRING, \
     VIR_MIGRATE_PARAM_DISKS_URI,     VIR_TYPED_PARAM_STRING, \
     VIR_MIGRATE_PARAM_BANDWIDTH_AVAIL_SWITCHOVER, VIR_TYPED_PARAM_ULLONG, \
+    VIR_MIGRATE_PARAM_DOWNTIME_MAX,  VIR_TYPED_PARAM_ULLONG, \
     NULL
 
 
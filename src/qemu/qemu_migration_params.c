@@ -71,6 +71,8 @@ struct _qemuMigrationParams {
     virBitmap *remoteOptional;
     qemuMigrationParamValue params[QEMU_MIGRATION_PARAM_LAST];
     virJSONValue *blockDirtyBitmapMapping;
+    /* upper bound for raising downtime-limit during migration (ms) */
+    unsigned long long downtimeMax;
 };
 
 typedef enum {
@@ -789,6 +791,12 @@ qemuMigrationParamsFromFlags(virTypedParameterPtr params,
         return NULL;
     }
 
+    if (party & QEMU_MIGRATION_SOURCE &&
+        virTypedParamsGetULLong(params, nparams,
+                                VIR_MIGRATE_PARAM_DOWNTIME_MAX,
+                                &migParams->downtimeMax) < 0)
+        return NULL;
+
     if (qemuMigrationParamsSetCompression(params, nparams, flags, migParams) < 0)
         return NULL;
 
@@ -1072,6 +1080,36 @@ qemuMigrationParamsApplyValues(virDomainObj *vm,
 }
 
 
+/**
+ * qemuMigrationParamsUpdate:
+ * @vm: domain object
+ * @asyncJob: migration job
+ * @migParams: migration parameters to send to QEMU
+ *
+ * Send parameter values stored in @migParams to QEMU while migration is
+ * running. Unlike qemuMigrationParamsApply, migration capabilities are
+ * left untouched.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+qemuMigrationParamsUpdate(virDomainObj *vm,
+                          int asyncJob,
+                          qemuMigrationParams *migParams)
+{
+    int ret;
+
+    if (qemuDomainObjEnterMonitorAsync(vm, asyncJob) < 0)
+        return -1;
+
+    ret = qemuMigrationParamsApplyValues(vm, migParams, false);
+
+    qemuDomainObjExitMonitor(vm);
+
+    return ret;
+}
+
+
 /**
  * qemuMigrationParamsApply
  * @driver: qemu driver
@@ -1756,6 +1794,21 @@ qemuMigrationCapsGet(virDomainObj *vm,
 }
 
 
+/**
+ * qemuMigrationParamsGetDowntimeMax:
+ * @migParams: migration parameters
+ *
+ * Returns the maximum (in milliseconds) to which the downtime limit may be
+ * raised when migration does not converge, or 0 if the downtime limit should
+ * not be changed at all.
+ */
+unsigned long long
+qemuMigrationParamsGetDowntimeMax(qemuMigrationParams *migParams)
+{
+    return migParams->downtimeMax;
+}
+
+
 /**
  * qemuMigrationParamsGetTLSHostname:
  * @migParams: Migration params object
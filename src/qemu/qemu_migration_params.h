@@ -114,6 +114,11 @@ qemuMigrationParamsApply(virDomainObj *vm,
                          qemuMigrationParams *migParams,
                          unsigned int apiFlags);
 
+int
+qemuMigrationParamsUpdate(virDomainObj *vm,
+                          int asyncJob,
+                          qemuMigrationParams *migParams);
+
 int
 qemuMigrationParamsEnableTLS(virQEMUDriver *driver,
                              virDomainObj *vm,
@@ -188,5 +193,8 @@ bool
 qemuMigrationCapsGet(virDomainObj *vm,
                      qemuMigrationCapability cap);
 
+unsigned long long
+qemuMigrationParamsGetDowntimeMax(qemuMigrationParams *migParams);
+
 const char *
 qemuMigrationParamsGetTLSHostname(qemuMigrationParams *migParams);
@@ -221,6 +221,8 @@ qemuMonitorDispose(void *obj)
     g_free(mon->buffer);
     g_free(mon->balloonpath);
     g_free(mon->domainName);
+    g_clear_pointer(&mon->replyCache, g_hash_table_unref);
+    g_clear_pointer(&mon->prefetched, g_hash_table_unref);
 }
 
 
@@ -1991,6 +1993,41 @@ qemuMonitorBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
 }
 
 
+/**
+ * qemuMonitorPrefetch:
+ * @mon: monitor object
+ * @flags: bitwise-OR of qemuMonitorPrefetchFlags
+ *
+ * Sends all queries selected by @flags to QEMU at once, so that the
+ * subsequent calls of the matching getters (e.g.
+ * qemuMonitorGetAllBlockStatsInfo for QEMU_MONITOR_PREFETCH_BLOCK_STATS) are
+ * answered without another round trip each. Every prefetched reply is used
+ * only once; use qemuMonitorPrefetchClear to drop unused ones.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorPrefetch(qemuMonitor *mon,
+                    unsigned int flags)
+{
+    VIR_DEBUG("flags=0x%x", flags);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONPrefetch(mon, flags);
+}
+
+
+void
+qemuMonitorPrefetchClear(qemuMonitor *mon)
+{
+    if (!mon)
+        return;
+
+    qemuMonitorJSONPrefetchClear(mon);
+}
+
+
 /**
  * qemuMonitorBlockGetNamedNodeData:
  * @mon: monitor object
@@ -3415,6 +3452,46 @@ qemuMonitorGetObjectTypes(qemuMonitor *mon,
 }
 
 
+/**
+ * qemuMonitorPrefetchDeviceProps:
+ * @mon: monitor object
+ * @devices: NULL terminated list of device types
+ *
+ * Queries properties of all @devices at once for the subsequent
+ * qemuMonitorGetDeviceProps calls, see qemuMonitorPrefetch.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorPrefetchDeviceProps(qemuMonitor *mon,
+                               const char **devices)
+{
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONPrefetchDeviceProps(mon, devices);
+}
+
+
+/**
+ * qemuMonitorPrefetchObjectProps:
+ * @mon: monitor object
+ * @objects: NULL terminated list of object types
+ *
+ * Queries properties of all @objects at once for the subsequent
+ * qemuMonitorGetObjectProps calls, see qemuMonitorPrefetch.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorPrefetchObjectProps(qemuMonitor *mon,
+                               const char **objects)
+{
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONPrefetchObjectProps(mon, objects);
+}
+
+
 GHashTable *
 qemuMonitorGetDeviceProps(qemuMonitor *mon,
                           const char *device)
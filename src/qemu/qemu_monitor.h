@@ -694,6 +694,17 @@ int qemuMonitorGetAllBlockStatsInfo(qemuMonitor *mon,
                                     GHashTable **ret_stats)
     ATTRIBUTE_NONNULL(2);
 
+typedef enum {
+    /* query-blockstats and query-named-block-nodes */
+    QEMU_MONITOR_PREFETCH_BLOCK_STATS = 1 << 0,
+    QEMU_MONITOR_PREFETCH_IOTHREADS = 1 << 1,
+    QEMU_MONITOR_PREFETCH_DIRTY_RATE = 1 << 2,
+} qemuMonitorPrefetchFlags;
+
+int qemuMonitorPrefetch(qemuMonitor *mon,
+                        unsigned int flags);
+void qemuMonitorPrefetchClear(qemuMonitor *mon);
+
 int qemuMonitorBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
                                                 GHashTable *stats)
     ATTRIBUTE_NONNULL(2);
@@ -1220,6 +1231,12 @@ GHashTable *qemuMonitorGetDeviceProps(qemuMonitor *mon,
 int qemuMonitorGetObjectProps(qemuMonitor *mon,
                               const char *object,
                               char ***props);
+int qemuMonitorPrefetchDeviceProps(qemuMonitor *mon,
+                                   const char **devices)
+    ATTRIBUTE_NONNULL(2);
+int qemuMonitorPrefetchObjectProps(qemuMonitor *mon,
+                                   const char **objects)
+    ATTRIBUTE_NONNULL(2);
 char *qemuMonitorGetTargetArch(qemuMonitor *mon);
 
 int qemuMonitorNBDServerStart(qemuMonitor *mon,
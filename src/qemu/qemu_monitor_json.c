@@ -141,6 +141,170 @@ qemuMonitorEventCompare(const void *key, const void *elt)
     return strcmp(type, handler->type);
 }
 
+/* Queries without arguments whose replies may only change when libvirt
+ * sends a command which modifies the VM or QEMU emits an event. */
+static const char *qemuMonitorJSONCacheableQueries[] = {
+    "query-cpus-fast",
+    "query-hotpluggable-cpus",
+    "query-iothreads",
+    "query-memory-devices",
+};
+
+
+static bool
+qemuMonitorJSONCommandIsCacheable(virJSONValue *cmd)
+{
+    const char *name = virJSONValueObjectGetString(cmd, "execute");
+    size_t i;
+
+    if (!name || virJSONValueObjectHasKey(cmd, "arguments"))
+        return false;
+
+    for (i = 0; i < G_N_ELEMENTS(qemuMonitorJSONCacheableQueries); i++) {
+        if (STREQ(name, qemuMonitorJSONCacheableQueries[i]))
+            return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * qemuMonitorJSONReplyCacheInvalidate:
+ * @mon: monitor object
+ * @cmd: command about to be sent or NULL
+ *
+ * Drops all cached and prefetched replies unless @cmd is a read-only query.
+ * Called with NULL when QEMU emits an event as any event may indicate a
+ * change of the data returned by the cached queries.
+ */
+static void
+qemuMonitorJSONReplyCacheInvalidate(qemuMonitor *mon,
+                                    virJSONValue *cmd)
+{
+    if (cmd) {
+        const char *name = virJSONValueObjectGetString(cmd, "execute");
+
+        if (name &&
+            (STRPREFIX(name, "query-") ||
+             STREQ(name, "qom-get") ||
+             STREQ(name, "qom-list") ||
+             STREQ(name, "qom-list-properties") ||
+             STREQ(name, "device-list-properties")))
+            return;
+    }
+
+    mon->replyCacheGeneration++;
+
+    if (mon->prefetched)
+        g_hash_table_remove_all(mon->prefetched);
+
+    if (!mon->replyCache || g_hash_table_size(mon->replyCache) == 0)
+        return;
+
+    VIR_DEBUG("mon=%p dropping cached replies", mon);
+    virHashRemoveAll(mon->replyCache);
+}
+
+
+/**
+ * qemuMonitorJSONReplyCacheLookup:
+ * @mon: monitor object
+ * @cmd: command
+ *
+ * Returns a copy of a cached reply to @cmd or NULL if @cmd is not cacheable
+ * (see qemuMonitorJSONCacheableQueries) or no reply is cached.
+ */
+static virJSONValue *
+qemuMonitorJSONReplyCacheLookup(qemuMonitor *mon,
+                                virJSONValue *cmd)
+{
+    virJSONValue *reply;
+
+    if (!mon->replyCache || !qemuMonitorJSONCommandIsCacheable(cmd))
+        return NULL;
+
+    if (!(reply = virHashLookup(mon->replyCache,
+                                virJSONValueObjectGetString(cmd, "execute"))))
+        return NULL;
+
+    return virJSONValueCopy(reply);
+}
+
+
+/**
+ * qemuMonitorJSONReplyCacheStore:
+ * @mon: monitor object
+ * @cmd: command
+ * @reply: reply to @cmd
+ * @generation: value of replyCacheGeneration when @cmd was sent
+ *
+ * Caches @reply unless the cached replies were invalidated since @cmd was
+ * sent, e.g. by an event processed while the caller was waiting for @reply.
+ * The reply may predate the change announced by the event.
+ */
+static void
+qemuMonitorJSONReplyCacheStore(qemuMonitor *mon,
+                               virJSONValue *cmd,
+                               virJSONValue *reply,
+                               unsigned long long generation)
+{
+    if (!qemuMonitorJSONCommandIsCacheable(cmd) ||
+        !virJSONValueObjectHasKey(reply, "return"))
+        return;
+
+    if (generation != mon->replyCacheGeneration) {
+        VIR_DEBUG("mon=%p not caching reply to '%s' invalidated meanwhile",
+                  mon, virJSONValueObjectGetString(cmd, "execute"));
+        return;
+    }
+
+    if (!mon->replyCache)
+        mon->replyCache = virHashNew(virJSONValueHashFree);
+
+    ignore_value(virHashUpdateEntry(mon->replyCache,
+                                    virJSONValueObjectGetString(cmd, "execute"),
+                                    virJSONValueCopy(reply)));
+}
+
+
+/**
+ * qemuMonitorJSONPrefetchedTake:
+ * @mon: monitor object
+ * @cmd: command
+ *
+ * Returns the oldest reply to @cmd sent ahead of time by
+ * qemuMonitorJSONPrefetchCommands and removes it so that each prefetched reply
+ * is used only once, or NULL if there's no such reply.
+ */
+static virJSONValue *
+qemuMonitorJSONPrefetchedTake(qemuMonitor *mon,
+                              virJSONValue *cmd)
+{
+    g_autofree char *key = NULL;
+    virJSONValue *queue;
+    virJSONValue *reply;
+
+    if (!mon->prefetched || g_hash_table_size(mon->prefetched) == 0)
+        return NULL;
+
+    if (!(key = virJSONValueToString(cmd, false))) {
+        virResetLastError();
+        return NULL;
+    }
+
+    if (!(queue = virHashLookup(mon->prefetched, key)))
+        return NULL;
+
+    reply = virJSONValueArraySteal(queue, 0);
+
+    if (virJSONValueArraySize(queue) == 0)
+        virHashRemoveEntry(mon->prefetched, key);
+
+    return reply;
+}
+
+
 static int
 qemuMonitorJSONIOProcessEvent(qemuMonitor *mon,
                               virJSONValue *obj)
@@ -155,6 +319,8 @@ qemuMonitorJSONIOProcessEvent(qemuMonitor *mon,
 
     VIR_DEBUG("mon=%p obj=%p", mon, obj);
 
+    qemuMonitorJSONReplyCacheInvalidate(mon, NULL);
+
     type = virJSONValueObjectGetString(obj, "event");
     if (!type) {
         VIR_WARN("missing event type in message");
@@ -183,6 +349,49 @@ qemuMonitorJSONIOProcessEvent(qemuMonitor *mon,
     return 0;
 }
 
+/**
+ * qemuMonitorJSONIOProcessBatchReply:
+ * @msg: message containing several commands
+ * @obj: reply object, stolen on success
+ * @line: the reply as received from QEMU
+ *
+ * Assigns a reply to one of the commands of a batch, see
+ * qemuMonitorJSONCommandBatch. Replies are matched by the command ID. A reply
+ * without an ID (e.g. to a command QEMU was unable to parse) belongs to the
+ * first command which has not been answered yet as QEMU answers commands in
+ * the order it received them.
+ */
+static int
+qemuMonitorJSONIOProcessBatchReply(qemuMonitorMessage *msg,
+                                   virJSONValue **obj,
+                                   const char *line)
+{
+    const char *id = virJSONValueObjectGetString(*obj, "id");
+    size_t i;
+
+    for (i = 0; i < msg->nrx; i++) {
+        if (msg->rxObjects[i])
+            continue;
+
+        if (!id || STREQ(id, msg->rxIDs[i]))
+            break;
+    }
+
+    if (i == msg->nrx) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected JSON reply '%1$s'"), line);
+        return -1;
+    }
+
+    msg->rxObjects[i] = g_steal_pointer(obj);
+
+    if (++msg->rxReceived == msg->nrx)
+        msg->finished = true;
+
+    return 0;
+}
+
+
 int
 qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
                              const char *line,
@@ -211,7 +420,9 @@ qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
                virJSONValueObjectHasKey(obj, "return")) {
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
-        if (msg) {
+        if (msg && msg->nrx > 0) {
+            return qemuMonitorJSONIOProcessBatchReply(msg, &obj, line);
+        } else if (msg) {
             msg->rxObject = g_steal_pointer(&obj);
             msg->finished = 1;
             return 0;
@@ -263,9 +474,27 @@ qemuMonitorJSONCommandWithFd(qemuMonitor *mon,
     int ret = -1;
     qemuMonitorMessage msg = { 0 };
     g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    unsigned long long generation;
 
     *reply = NULL;
 
+    if (scm_fd == -1 &&
+        (*reply = qemuMonitorJSONReplyCacheLookup(mon, cmd))) {
+        VIR_DEBUG("mon=%p using cached reply to '%s'",
+                  mon, virJSONValueObjectGetString(cmd, "execute"));
+        return 0;
+    }
+
+    if (scm_fd == -1 &&
+        (*reply = qemuMonitorJSONPrefetchedTake(mon, cmd))) {
+        VIR_DEBUG("mon=%p using prefetched reply to '%s'",
+                  mon, virJSONValueObjectGetString(cmd, "execute"));
+        return 0;
+    }
+
+    qemuMonitorJSONReplyCacheInvalidate(mon, cmd);
+    generation = mon->replyCacheGeneration;
+
     if (virJSONValueObjectHasKey(cmd, "execute")) {
         g_autofree char *id = qemuMonitorNextCommandID(mon);
 
@@ -293,6 +522,7 @@ qemuMonitorJSONCommandWithFd(qemuMonitor *mon,
             ret = -1;
         } else {
             *reply = msg.rxObject;
+            qemuMonitorJSONReplyCacheStore(mon, cmd, *reply, generation);
         }
     }
 
@@ -308,6 +538,176 @@ qemuMonitorJSONCommand(qemuMonitor *mon,
     return qemuMonitorJSONCommandWithFd(mon, cmd, -1, reply);
 }
 
+
+/**
+ * qemuMonitorJSONCommandBatch:
+ * @mon: monitor object
+ * @cmds: commands to execute
+ * @ncmds: number of items in @cmds
+ * @replies: filled with replies to @cmds, must have @ncmds items
+ *
+ * Sends all @cmds to QEMU at once and waits for all their replies, which saves
+ * a round trip per command compared to calling qemuMonitorJSONCommand for each
+ * of them. QEMU executes the commands in order, but it does not stop on the
+ * first failing one. Thus only commands which do not depend on each other
+ * can be batched. The caller is responsible for checking each reply.
+ *
+ * Commands answered from the reply cache or by a prefetched reply are not
+ * sent at all.
+ *
+ * Returns 0 on success, -1 on error (in which case @replies are NULL).
+ */
+static int
+qemuMonitorJSONCommandBatch(qemuMonitor *mon,
+                            virJSONValue **cmds,
+                            size_t ncmds,
+                            virJSONValue **replies)
+{
+    qemuMonitorMessage msg = { 0 };
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(GStrv) ids = g_new0(char *, ncmds + 1);
+    g_autofree size_t *pending = g_new0(size_t, ncmds);
+    g_autofree virJSONValue **rx = g_new0(virJSONValue *, ncmds);
+    unsigned long long generation;
+    size_t npending = 0;
+    size_t i;
+
+    for (i = 0; i < ncmds; i++) {
+        replies[i] = NULL;
+        qemuMonitorJSONReplyCacheInvalidate(mon, cmds[i]);
+    }
+
+    generation = mon->replyCacheGeneration;
+
+    for (i = 0; i < ncmds; i++) {
+        if ((replies[i] = qemuMonitorJSONReplyCacheLookup(mon, cmds[i])) ||
+            (replies[i] = qemuMonitorJSONPrefetchedTake(mon, cmds[i])))
+            continue;
+
+        pending[npending++] = i;
+    }
+
+    if (npending == 0)
+        return 0;
+
+    for (i = 0; i < npending; i++) {
+        virJSONValue *cmd = cmds[pending[i]];
+
+        ids[i] = qemuMonitorNextCommandID(mon);
+
+        if (virJSONValueObjectAppendString(cmd, "id", ids[i]) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to append command 'id' string"));
+            goto error;
+        }
+
+        if (virJSONValueToBuffer(cmd, &cmdbuf, false) < 0)
+            goto error;
+        virBufferAddLit(&cmdbuf, "\r\n");
+    }
+
+    msg.txLength = virBufferUse(&cmdbuf);
+    msg.txBuffer = virBufferCurrentContent(&cmdbuf);
+    msg.txFD = -1;
+    msg.nrx = npending;
+    msg.rxIDs = ids;
+    msg.rxObjects = (void **) rx;
+
+    if (qemuMonitorSend(mon, &msg) < 0)
+        goto error;
+
+    for (i = 0; i < npending; i++) {
+        if (!rx[i]) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing monitor reply object"));
+            goto error;
+        }
+    }
+
+    for (i = 0; i < npending; i++) {
+        replies[pending[i]] = g_steal_pointer(&rx[i]);
+        qemuMonitorJSONReplyCacheStore(mon, cmds[pending[i]],
+                                       replies[pending[i]], generation);
+    }
+
+    return 0;
+
+ error:
+    for (i = 0; i < npending; i++)
+        g_clear_pointer(&rx[i], virJSONValueFree);
+    for (i = 0; i < ncmds; i++)
+        g_clear_pointer(&replies[i], virJSONValueFree);
+    return -1;
+}
+
+
+/**
+ * qemuMonitorJSONPrefetchCommands:
+ * @mon: monitor object
+ * @cmds: read-only queries
+ * @ncmds: number of items in @cmds
+ *
+ * Sends all @cmds in one batch and keeps their replies, so that the getters
+ * issuing the very same commands later on are answered without waiting for
+ * QEMU. The replies to a command listed several times are used in order.
+ * Replies to cacheable queries end up in the reply cache instead. The
+ * replies are dropped on any event or command which is not a query, see
+ * qemuMonitorJSONReplyCacheInvalidate.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMonitorJSONPrefetchCommands(qemuMonitor *mon,
+                                virJSONValue **cmds,
+                                size_t ncmds)
+{
+    g_autofree virJSONValue **replies = g_new0(virJSONValue *, ncmds);
+    g_auto(GStrv) keys = g_new0(char *, ncmds + 1);
+    unsigned long long generation = mon->replyCacheGeneration;
+    int ret = -1;
+    size_t i;
+
+    /* the key must not contain the command ID */
+    for (i = 0; i < ncmds; i++) {
+        if (!(keys[i] = virJSONValueToString(cmds[i], false)))
+            return -1;
+    }
+
+    if (qemuMonitorJSONCommandBatch(mon, cmds, ncmds, replies) < 0)
+        return -1;
+
+    if (!mon->prefetched)
+        mon->prefetched = virHashNew(virJSONValueHashFree);
+
+    for (i = 0; i < ncmds; i++) {
+        virJSONValue *queue;
+
+        if (generation != mon->replyCacheGeneration ||
+            qemuMonitorJSONCommandIsCacheable(cmds[i]))
+            continue;
+
+        if (!(queue = virHashLookup(mon->prefetched, keys[i]))) {
+            queue = virJSONValueNewArray();
+
+            if (virHashAddEntry(mon->prefetched, keys[i], queue) < 0) {
+                virJSONValueFree(queue);
+                goto cleanup;
+            }
+        }
+
+        if (virJSONValueArrayAppend(queue, &replies[i]) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ncmds; i++)
+        virJSONValueFree(replies[i]);
+    return ret;
+}
+
+
 /* Ignoring OOM in this method, since we're already reporting
  * a more important error
  *
@@ -545,6 +945,139 @@ qemuMonitorJSONMakeCommand(const char *cmdname,
 }
 
 
+static virJSONValue *
+qemuMonitorJSONMakeBlockstatsCommand(bool queryNodes)
+{
+    return qemuMonitorJSONMakeCommand("query-blockstats",
+                                      "B:query-nodes", queryNodes,
+                                      NULL);
+}
+
+
+static virJSONValue *
+qemuMonitorJSONMakeNamedBlockNodesCommand(void)
+{
+    return qemuMonitorJSONMakeCommand("query-named-block-nodes",
+                                      "b:flat", true,
+                                      NULL);
+}
+
+
+static virJSONValue *
+qemuMonitorJSONMakeDevicePropsCommand(const char *device)
+{
+    return qemuMonitorJSONMakeCommand("device-list-properties",
+                                      "s:typename", device,
+                                      NULL);
+}
+
+
+static virJSONValue *
+qemuMonitorJSONMakeObjectPropsCommand(const char *object)
+{
+    return qemuMonitorJSONMakeCommand("qom-list-properties",
+                                      "s:typename", object,
+                                      NULL);
+}
+
+
+int
+qemuMonitorJSONPrefetch(qemuMonitor *mon,
+                        unsigned int flags)
+{
+    virJSONValue *cmds[5] = { NULL };
+    size_t ncmds = 0;
+    int ret = -1;
+    size_t i;
+
+    if (flags & QEMU_MONITOR_PREFETCH_BLOCK_STATS) {
+        if (!(cmds[ncmds++] = qemuMonitorJSONMakeBlockstatsCommand(false)) ||
+            !(cmds[ncmds++] = qemuMonitorJSONMakeBlockstatsCommand(true)) ||
+            !(cmds[ncmds++] = qemuMonitorJSONMakeNamedBlockNodesCommand()))
+            goto cleanup;
+    }
+
+    if (flags & QEMU_MONITOR_PREFETCH_IOTHREADS &&
+        !(cmds[ncmds++] = qemuMonitorJSONMakeCommand("query-iothreads", NULL)))
+        goto cleanup;
+
+    if (flags & QEMU_MONITOR_PREFETCH_DIRTY_RATE &&
+        !(cmds[ncmds++] = qemuMonitorJSONMakeCommand("query-dirty-rate", NULL)))
+        goto cleanup;
+
+    if (ncmds == 0)
+        return 0;
+
+    ret = qemuMonitorJSONPrefetchCommands(mon, cmds, ncmds);
+
+ cleanup:
+    for (i = 0; i < ncmds; i++)
+        virJSONValueFree(cmds[i]);
+    return ret;
+}
+
+
+/**
+ * qemuMonitorJSONPrefetchTypeProps:
+ * @mon: monitor object
+ * @types: NULL terminated list of type names
+ * @makeCommand: builds the command querying properties of one type
+ *
+ * Prefetches the properties of all @types in a single batch.
+ */
+static int
+qemuMonitorJSONPrefetchTypeProps(qemuMonitor *mon,
+                                 const char **types,
+                                 virJSONValue *(*makeCommand)(const char *type))
+{
+    size_t ntypes = g_strv_length((char **) types);
+    g_autofree virJSONValue **cmds = g_new0(virJSONValue *, ntypes + 1);
+    int ret = -1;
+    size_t i;
+
+    if (ntypes == 0)
+        return 0;
+
+    for (i = 0; i < ntypes; i++) {
+        if (!(cmds[i] = makeCommand(types[i])))
+            goto cleanup;
+    }
+
+    ret = qemuMonitorJSONPrefetchCommands(mon, cmds, ntypes);
+
+ cleanup:
+    for (i = 0; i < ntypes; i++)
+        virJSONValueFree(cmds[i]);
+    return ret;
+}
+
+
+int
+qemuMonitorJSONPrefetchDeviceProps(qemuMonitor *mon,
+                                   const char **devices)
+{
+    return qemuMonitorJSONPrefetchTypeProps(mon, devices,
+                                            qemuMonitorJSONMakeDevicePropsCommand);
+}
+
+
+int
+qemuMonitorJSONPrefetchObjectProps(qemuMonitor *mon,
+                                   const char **objects)
+{
+    return qemuMonitorJSONPrefetchTypeProps(mon, objects,
+                                            qemuMonitorJSONMakeObjectPropsCommand);
+}
+
+
+void
+qemuMonitorJSONPrefetchClear(qemuMonitor *mon)
+{
+    if (mon->prefetched)
+        g_hash_table_remove_all(mon->prefetched);
+}
+
+
 static void qemuMonitorJSONHandleShutdown(qemuMonitor *mon, virJSONValue *data)
 {
     bool guest = false;
@@ -1762,6 +2295,11 @@ qemuMonitorJSONQueryCPUs(qemuMonitor *mon,
     if (!(data = virJSONValueObjectGetArray(reply, "return")))
         return -2;
 
+    /* s390 CPU state changes without QEMU emitting any event */
+    if (virJSONValueArraySize(data) > 0 &&
+        virJSONValueObjectHasKey(virJSONValueArrayGet(data, 0), "cpu-state"))
+        ignore_value(virHashRemoveEntry(mon->replyCache, "query-cpus-fast"));
+
     return qemuMonitorJSONExtractCPUInfo(data, entries, nentries);
 }
 
@@ -2120,9 +2658,7 @@ qemuMonitorJSONQueryNamedBlockNodes(qemuMonitor *mon)
     g_autoptr(virJSONValue) cmd = NULL;
     g_autoptr(virJSONValue) reply = NULL;
 
-    if (!(cmd = qemuMonitorJSONMakeCommand("query-named-block-nodes",
-                                           "b:flat", true,
-                                           NULL)))
+    if (!(cmd = qemuMonitorJSONMakeNamedBlockNodesCommand()))
         return NULL;
 
     if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
@@ -2434,9 +2970,7 @@ qemuMonitorJSONQueryBlockstats(qemuMonitor *mon,
     g_autoptr(virJSONValue) cmd = NULL;
     g_autoptr(virJSONValue) reply = NULL;
 
-    if (!(cmd = qemuMonitorJSONMakeCommand("query-blockstats",
-                                           "B:query-nodes", queryNodes,
-                                           NULL)))
+    if (!(cmd = qemuMonitorJSONMakeBlockstatsCommand(queryNodes)))
         return NULL;
 
     if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
@@ -2456,10 +2990,29 @@ qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
     int nstats = 0;
     int rc;
     size_t i;
-    g_autoptr(virJSONValue) blockstatsDevices = NULL;
-    g_autoptr(virJSONValue) blockstatsNodes = NULL;
+    g_autoptr(virJSONValue) cmdDevices = NULL;
+    g_autoptr(virJSONValue) cmdNodes = NULL;
+    g_autoptr(virJSONValue) replyDevices = NULL;
+    g_autoptr(virJSONValue) replyNodes = NULL;
+    virJSONValue *cmds[2];
+    virJSONValue *replies[2];
+    virJSONValue *blockstatsDevices;
+    virJSONValue *blockstatsNodes;
+
+    if (!(cmdDevices = qemuMonitorJSONMakeBlockstatsCommand(false)) ||
+        !(cmdNodes = qemuMonitorJSONMakeBlockstatsCommand(true)))
+        return -1;
 
-    if (!(blockstatsDevices = qemuMonitorJSONQueryBlockstats(mon, false)))
+    /* both queries are independent, save a round trip */
+    cmds[0] = cmdDevices;
+    cmds[1] = cmdNodes;
+    if (qemuMonitorJSONCommandBatch(mon, cmds, 2, replies) < 0)
+        return -1;
+    replyDevices = replies[0];
+    replyNodes = replies[1];
+
+    if (!(blockstatsDevices = qemuMonitorJSONGetReply(cmdDevices, replyDevices,
+                                                      VIR_JSON_TYPE_ARRAY)))
         return -1;
 
     for (i = 0; i < virJSONValueArraySize(blockstatsDevices); i++) {
@@ -2486,7 +3039,8 @@ qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
             nstats = rc;
     }
 
-    if (!(blockstatsNodes = qemuMonitorJSONQueryBlockstats(mon, true)))
+    if (!(blockstatsNodes = qemuMonitorJSONGetReply(cmdNodes, replyNodes,
+                                                    VIR_JSON_TYPE_ARRAY)))
         return -1;
 
     for (i = 0; i < virJSONValueArraySize(blockstatsNodes); i++) {
@@ -5873,9 +6427,7 @@ qemuMonitorJSONGetDeviceProps(qemuMonitor *mon,
     g_autoptr(virJSONValue) reply = NULL;
     virJSONValue *data;
 
-    if (!(cmd = qemuMonitorJSONMakeCommand("device-list-properties",
-                                           "s:typename", device,
-                                           NULL)))
+    if (!(cmd = qemuMonitorJSONMakeDevicePropsCommand(device)))
         return NULL;
 
     if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
@@ -5907,9 +6459,7 @@ qemuMonitorJSONGetObjectProps(qemuMonitor *mon,
 
     *props = NULL;
 
-    if (!(cmd = qemuMonitorJSONMakeCommand("qom-list-properties",
-                                           "s:typename", object,
-                                           NULL)))
+    if (!(cmd = qemuMonitorJSONMakeObjectPropsCommand(object)))
         return -1;
 
     if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
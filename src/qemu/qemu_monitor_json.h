@@ -98,6 +98,11 @@ int
 qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
                                     GHashTable *hash);
 int
+qemuMonitorJSONPrefetch(qemuMonitor *mon,
+                        unsigned int flags);
+void
+qemuMonitorJSONPrefetchClear(qemuMonitor *mon);
+int
 qemuMonitorJSONBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
                                                 GHashTable *stats);
 
@@ -531,6 +536,14 @@ qemuMonitorJSONGetObjectProps(qemuMonitor *mon,
                               const char *object,
                               char ***props)
     ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+int
+qemuMonitorJSONPrefetchDeviceProps(qemuMonitor *mon,
+                                   const char **devices)
+    ATTRIBUTE_NONNULL(2);
+int
+qemuMonitorJSONPrefetchObjectProps(qemuMonitor *mon,
+                                   const char **objects)
+    ATTRIBUTE_NONNULL(2);
 
 char *
 qemuMonitorJSONGetTargetArch(qemuMonitor *mon);
@@ -37,6 +37,13 @@ struct _qemuMonitorMessage {
     /* Used by the JSON monitor to hold reply / error */
     void *rxObject;
 
+    /* Used instead of rxObject when @txBuffer contains @nrx commands which
+     * are sent at once, see qemuMonitorJSONCommandBatch */
+    size_t nrx;
+    char **rxIDs;
+    void **rxObjects;
+    size_t rxReceived;
+
     /* True if rxObject is ready, or a fatal error occurred on the monitor channel */
     bool finished;
 };
@@ -62,6 +69,16 @@ struct _qemuMonitor {
      * non-NULL */
     qemuMonitorMessage *msg;
 
+    /* Replies to read-only queries keyed by command name, see
+     * qemuMonitorJSONReplyCacheLookup */
+    GHashTable *replyCache;
+    /* Incremented whenever cached replies are invalidated so that a reply
+     * which raced with the invalidation is not cached */
+    unsigned long long replyCacheGeneration;
+    /* Arrays of replies to queries sent ahead of time keyed by the command,
+     * see qemuMonitorJSONPrefetchCommands */
+    GHashTable *prefetched;
+
     /* Buffer incoming data ready for Text/QMP monitor
      * code to process & find message boundaries */
     size_t bufferOffset;
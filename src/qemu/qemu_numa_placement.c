@@ -0,0 +1,1011 @@
+/*
+ * qemu_numa_placement.c: built-in automatic NUMA placement
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "qemu_numa_placement.h"
+#include "qemu_domain.h"
+#include "qemu_process.h"
+#include "domain_cgroup.h"
+#include "viralloc.h"
+#include "vircgroup.h"
+#include "virhash.h"
+#include "virlog.h"
+#include "virnuma.h"
+#include "virperiodicworker.h"
+#include "virprocess.h"
+#include "virthread.h"
+#include "virtime.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+VIR_LOG_INIT("qemu.qemu_numa_placement");
+
+/* distances used when the host does not report any */
+#define QEMU_NUMA_PLACEMENT_LOCAL_DISTANCE 10
+#define QEMU_NUMA_PLACEMENT_REMOTE_DISTANCE 20
+
+
+/* minimal decrease of vCPUs per host CPU which justifies moving a domain */
+#define QEMU_NUMA_REBALANCE_MIN_GAIN 0.5
+
+/* number of rebalancing periods a domain is left alone after it was moved */
+#define QEMU_NUMA_REBALANCE_COOLDOWN 10
+
+
+typedef struct _qemuNumaPlacementDomain qemuNumaPlacementDomain;
+struct _qemuNumaPlacementDomain {
+    /* number of vCPUs pinned to each host CPU */
+    double *cpuLoad;
+    size_t ncpuLoad;
+
+    /* time of the last move by the rebalancer in ms */
+    unsigned long long lastMove;
+};
+
+
+struct _qemuNumaRebalancer {
+    virQEMUDriver *driver;
+    virPeriodicWorker *worker;
+
+    unsigned int period; /* in seconds */
+    unsigned int maxMoves;
+};
+
+
+static void
+qemuNumaPlacementDomainFree(void *opaque)
+{
+    qemuNumaPlacementDomain *dom = opaque;
+
+    if (!dom)
+        return;
+
+    g_free(dom->cpuLoad);
+    g_free(dom);
+}
+
+
+void
+qemuNumaPlacementHostFree(qemuNumaPlacementHost *host)
+{
+    if (!host)
+        return;
+
+    virCapabilitiesHostNUMAUnref(host->numa);
+    g_free(host->memFree);
+    g_free(host->cpuLoad);
+    g_free(host);
+}
+
+
+static unsigned int
+qemuNumaPlacementDistance(virCapsHostNUMACell *a,
+                          virCapsHostNUMACell *b)
+{
+    size_t i;
+
+    if (a == b)
+        return QEMU_NUMA_PLACEMENT_LOCAL_DISTANCE;
+
+    for (i = 0; i < a->ndistances; i++) {
+        if (a->distances[i].cellid == b->num)
+            return a->distances[i].value;
+    }
+
+    return QEMU_NUMA_PLACEMENT_REMOTE_DISTANCE;
+}
+
+
+typedef struct _qemuNumaPlacementCell qemuNumaPlacementCell;
+struct _qemuNumaPlacementCell {
+    virCapsHostNUMACell *cell;
+    unsigned long long memFree;
+    unsigned int ncpus;
+    double load;
+};
+
+
+typedef struct _qemuNumaPlacementSet qemuNumaPlacementSet;
+struct _qemuNumaPlacementSet {
+    bool *used;
+    unsigned long long memFree;
+    unsigned int ncpus;
+    double load;
+    unsigned int cost;
+};
+
+
+static void
+qemuNumaPlacementSetAdd(qemuNumaPlacementSet *set,
+                        qemuNumaPlacementCell *cells,
+                        size_t first,
+                        size_t idx)
+{
+    set->used[idx] = true;
+    set->memFree += cells[idx].memFree;
+    set->ncpus += cells[idx].ncpus;
+    set->load += cells[idx].load;
+    set->cost += qemuNumaPlacementDistance(cells[first].cell, cells[idx].cell);
+}
+
+
+/* Expected number of vCPUs per host CPU of @set after adding the domain */
+static double
+qemuNumaPlacementSetPressure(const qemuNumaPlacementSet *set,
+                             unsigned int vcpus)
+{
+    if (set->ncpus == 0)
+        return G_MAXDOUBLE;
+
+    return (set->load + vcpus) / set->ncpus;
+}
+
+
+/* Returns true if @a is a better placement than @b */
+static bool
+qemuNumaPlacementSetIsBetter(const qemuNumaPlacementSet *a,
+                             const qemuNumaPlacementSet *b,
+                             unsigned int vcpus)
+{
+    double pa = qemuNumaPlacementSetPressure(a, vcpus);
+    double pb = qemuNumaPlacementSetPressure(b, vcpus);
+
+    if (a->cost != b->cost)
+        return a->cost < b->cost;
+
+    if (pa != pb)
+        return pa < pb;
+
+    return a->memFree > b->memFree;
+}
+
+
+static qemuNumaPlacementCell *
+qemuNumaPlacementGetCells(const qemuNumaPlacementHost *host,
+                          unsigned long long *totalMem,
+                          unsigned int *totalCPUs)
+{
+    size_t ncells = host->numa->cells->len;
+    g_autofree qemuNumaPlacementCell *cells = g_new0(qemuNumaPlacementCell, ncells);
+    size_t i;
+    size_t j;
+
+    *totalMem = 0;
+    *totalCPUs = 0;
+
+    for (i = 0; i < ncells; i++) {
+        virCapsHostNUMACell *cell = g_ptr_array_index(host->numa->cells, i);
+
+        cells[i].cell = cell;
+        cells[i].memFree = host->memFree[i];
+        cells[i].ncpus = cell->ncpus;
+
+        for (j = 0; j < cell->ncpus; j++) {
+            unsigned int id = cell->cpus[j].id;
+
+            if (id < host->ncpuLoad)
+                cells[i].load += host->cpuLoad[id];
+        }
+
+        *totalMem += cells[i].memFree;
+        *totalCPUs += cells[i].ncpus;
+    }
+
+    return g_steal_pointer(&cells);
+}
+
+
+/**
+ * qemuNumaPlacementCompute:
+ * @host: host topology and resources
+ * @vcpus: number of vCPUs of the domain
+ * @memory: memory of the domain in KiB
+ *
+ * Selects host NUMA nodes for a domain so that remote memory access is
+ * minimized. A single node which has enough free memory and CPUs for the
+ * domain is preferred; the least loaded one is used if there are more of
+ * them. Otherwise, starting from each node, the nearest nodes (according to
+ * NUMA distances) are added until the domain fits and the set with the lowest
+ * total distance wins. If the domain does not fit anywhere, all nodes are
+ * returned.
+ *
+ * Returns the selected nodeset or NULL on error.
+ */
+virBitmap *
+qemuNumaPlacementCompute(const qemuNumaPlacementHost *host,
+                         unsigned int vcpus,
+                         unsigned long long memory)
+{
+    size_t ncells = host->numa->cells->len;
+    g_autofree qemuNumaPlacementCell *cells = NULL;
+    g_autofree bool *best = NULL;
+    qemuNumaPlacementSet bestSet = { 0 };
+    unsigned long long totalMem;
+    unsigned int totalCPUs;
+    g_autoptr(virBitmap) nodeset = NULL;
+    size_t i;
+    size_t j;
+
+    if (ncells == 0) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("host NUMA topology is not available"));
+        return NULL;
+    }
+
+    cells = qemuNumaPlacementGetCells(host, &totalMem, &totalCPUs);
+    best = g_new0(bool, ncells);
+
+    /* A domain with more vCPUs than the host has CPUs will never fit, but we
+     * still want to keep its memory close. */
+    vcpus = MIN(vcpus, totalCPUs);
+
+    if (memory <= totalMem) {
+        for (i = 0; i < ncells; i++) {
+            g_autofree bool *used = g_new0(bool, ncells);
+            qemuNumaPlacementSet set = { .used = used };
+
+            qemuNumaPlacementSetAdd(&set, cells, i, i);
+
+            while (set.memFree < memory || set.ncpus < vcpus) {
+                size_t next = ncells;
+
+                for (j = 0; j < ncells; j++) {
+                    unsigned int dj;
+                    unsigned int dnext;
+
+                    if (set.used[j])
+                        continue;
+
+                    if (next == ncells) {
+                        next = j;
+                        continue;
+                    }
+
+                    dj = qemuNumaPlacementDistance(cells[i].cell, cells[j].cell);
+                    dnext = qemuNumaPlacementDistance(cells[i].cell, cells[next].cell);
+
+                    if (dj < dnext ||
+                        (dj == dnext && cells[j].memFree > cells[next].memFree))
+                        next = j;
+                }
+
+                if (next == ncells)
+                    break;
+
+                qemuNumaPlacementSetAdd(&set, cells, i, next);
+            }
+
+            if (set.memFree < memory || set.ncpus < vcpus)
+                continue;
+
+            if (!bestSet.used ||
+                qemuNumaPlacementSetIsBetter(&set, &bestSet, vcpus)) {
+                memcpy(best, set.used, sizeof(bool) * ncells);
+                bestSet = set;
+                bestSet.used = best;
+            }
+        }
+    }
+
+    nodeset = virBitmapNew(0);
+
+    for (i = 0; i < ncells; i++) {
+        /* Use all nodes if the domain does not fit anywhere */
+        if (!bestSet.used || best[i])
+            virBitmapSetBitExpand(nodeset, cells[i].cell->num);
+    }
+
+    if (!bestSet.used) {
+        VIR_WARN("Not enough resources for %u vCPUs and %llu KiB of memory "
+                 "on any set of host NUMA nodes", vcpus, memory);
+    }
+
+    return g_steal_pointer(&nodeset);
+}
+
+
+static void
+qemuNumaPlacementSetFromBitmap(qemuNumaPlacementSet *set,
+                               qemuNumaPlacementCell *cells,
+                               size_t ncells,
+                               virBitmap *nodeset)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < ncells; i++) {
+        if (!virBitmapIsBitSet(nodeset, cells[i].cell->num))
+            continue;
+
+        set->used[i] = true;
+        set->memFree += cells[i].memFree;
+        set->ncpus += cells[i].ncpus;
+        set->load += cells[i].load;
+    }
+
+    /* the same metric as the sets built by qemuNumaPlacementCompute use,
+     * taking the node which is closest to the others as the first one */
+    set->cost = G_MAXUINT;
+    for (i = 0; i < ncells; i++) {
+        unsigned int cost = 0;
+
+        if (!set->used[i])
+            continue;
+
+        for (j = 0; j < ncells; j++) {
+            if (set->used[j])
+                cost += qemuNumaPlacementDistance(cells[i].cell, cells[j].cell);
+        }
+
+        set->cost = MIN(set->cost, cost);
+    }
+}
+
+
+/**
+ * qemuNumaPlacementShouldMove:
+ * @host: host topology and resources (including memory of the domain itself)
+ * @current: nodes the domain currently runs on
+ * @advice: nodes suggested by qemuNumaPlacementCompute
+ * @vcpus: number of vCPUs of the domain
+ * @memory: memory of the domain in KiB
+ *
+ * Decides whether moving a running domain from @current to @advice is worth
+ * the cost of migrating its memory: either the domain no longer fits into
+ * @current, or @advice is closer, or it is noticeably less loaded by vCPUs
+ * of other domains.
+ *
+ * Returns true if the domain should be moved.
+ */
+bool
+qemuNumaPlacementShouldMove(const qemuNumaPlacementHost *host,
+                            virBitmap *current,
+                            virBitmap *advice,
+                            unsigned int vcpus,
+                            unsigned long long memory)
+{
+    size_t ncells = host->numa->cells->len;
+    g_autofree qemuNumaPlacementCell *cells = NULL;
+    g_autofree bool *curUsed = g_new0(bool, ncells);
+    g_autofree bool *advUsed = g_new0(bool, ncells);
+    qemuNumaPlacementSet cur = { .used = curUsed };
+    qemuNumaPlacementSet adv = { .used = advUsed };
+    unsigned long long totalMem;
+    unsigned int totalCPUs;
+
+    if (virBitmapEqual(current, advice))
+        return false;
+
+    cells = qemuNumaPlacementGetCells(host, &totalMem, &totalCPUs);
+    vcpus = MIN(vcpus, totalCPUs);
+
+    qemuNumaPlacementSetFromBitmap(&cur, cells, ncells, current);
+    qemuNumaPlacementSetFromBitmap(&adv, cells, ncells, advice);
+
+    if (adv.memFree < memory || adv.ncpus < vcpus)
+        return false;
+
+    if (cur.memFree < memory || cur.ncpus < vcpus)
+        return true;
+
+    if (adv.cost != cur.cost)
+        return adv.cost < cur.cost;
+
+    return qemuNumaPlacementSetPressure(&cur, vcpus) -
+           qemuNumaPlacementSetPressure(&adv, vcpus) >= QEMU_NUMA_REBALANCE_MIN_GAIN;
+}
+
+
+static unsigned long long
+qemuNumaPlacementGetHugepageSize(virQEMUDriverConfig *cfg,
+                                 const virDomainDef *def)
+{
+    virHugeTLBFS *fs;
+
+    if (def->mem.nhugepages == 0)
+        return 0;
+
+    if (def->mem.hugepages[0].size != 0)
+        return def->mem.hugepages[0].size;
+
+    if ((fs = virFileGetDefaultHugepage(cfg->hugetlbfs, cfg->nhugetlbfs)))
+        return fs->size;
+
+    return 0;
+}
+
+
+/*
+ * Gathers the host topology, free memory (or free hugepages if @vm uses
+ * them) in each NUMA node, and vCPU pinning of running domains other than
+ * @vm. Memory of @vm itself (@ownMem, in KiB indexed by node id) is counted
+ * as free.
+ */
+static qemuNumaPlacementHost *
+qemuNumaPlacementHostNew(virQEMUDriver *driver,
+                         virDomainObj *vm,
+                         const unsigned long long *ownMem,
+                         size_t nownMem)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autoptr(qemuNumaPlacementHost) host = g_new0(qemuNumaPlacementHost, 1);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    unsigned long long pagesize;
+    size_t i;
+
+    if (!(host->numa = virCapabilitiesHostNUMANewHost()))
+        return NULL;
+
+    pagesize = qemuNumaPlacementGetHugepageSize(cfg, vm->def);
+    host->memFree = g_new0(unsigned long long, host->numa->cells->len);
+
+    for (i = 0; i < host->numa->cells->len; i++) {
+        virCapsHostNUMACell *cell = g_ptr_array_index(host->numa->cells, i);
+        unsigned long long memFree = 0;
+
+        if (pagesize > 0) {
+            /* A node without a pool of @pagesize pages can't back the
+             * memory of @vm, consider it full rather than failing */
+            if (virNumaGetPageInfo(cell->num, pagesize, 0, NULL, &memFree) < 0) {
+                VIR_WARN("Unable to get free %lluKiB pages of NUMA node %d: %s",
+                         pagesize, cell->num, virGetLastErrorMessage());
+                virResetLastError();
+                memFree = 0;
+            }
+            host->memFree[i] = memFree * pagesize;
+        } else {
+            if (virNumaGetNodeMemory(cell->num, NULL, &memFree) < 0)
+                VIR_DEBUG("Unable to get free memory of NUMA node %d", cell->num);
+            host->memFree[i] = memFree / 1024;
+        }
+
+        if (cell->num < nownMem)
+            host->memFree[i] += ownMem[cell->num];
+    }
+
+    virUUIDFormat(vm->def->uuid, uuidstr);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&driver->lock) {
+        GHashTableIter iter;
+        const char *key;
+        qemuNumaPlacementDomain *dom;
+
+        if (driver->numaPlacements) {
+            g_hash_table_iter_init(&iter, driver->numaPlacements);
+            while (g_hash_table_iter_next(&iter, (gpointer *) &key, (gpointer *) &dom)) {
+                if (STREQ(key, uuidstr))
+                    continue;
+
+                if (dom->ncpuLoad > host->ncpuLoad)
+                    VIR_EXPAND_N(host->cpuLoad, host->ncpuLoad,
+                                 dom->ncpuLoad - host->ncpuLoad);
+
+                for (i = 0; i < dom->ncpuLoad; i++)
+                    host->cpuLoad[i] += dom->cpuLoad[i];
+            }
+        }
+    }
+
+    return g_steal_pointer(&host);
+}
+
+
+/**
+ * qemuNumaPlacementAdvise:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Computes the automatic NUMA placement of @vm from the current host
+ * topology, free memory (or free hugepages if @vm uses them) in each NUMA
+ * node, and vCPU pinning of other running domains (see
+ * qemuNumaPlacementRegister).
+ *
+ * Returns the nodeset for @vm or NULL on error.
+ */
+virBitmap *
+qemuNumaPlacementAdvise(virQEMUDriver *driver,
+                        virDomainObj *vm)
+{
+    g_autoptr(qemuNumaPlacementHost) host = NULL;
+
+    if (!(host = qemuNumaPlacementHostNew(driver, vm, NULL, 0)))
+        return NULL;
+
+    return qemuNumaPlacementCompute(host, virDomainDefGetVcpus(vm->def),
+                                    virDomainDefGetMemoryTotal(vm->def));
+}
+
+
+static void
+qemuNumaPlacementRegisterInternal(virQEMUDriver *driver,
+                                  virDomainObj *vm,
+                                  virBitmap *autoCpuset,
+                                  unsigned long long lastMove)
+{
+    virDomainDef *def = vm->def;
+    qemuNumaPlacementDomain *dom = g_new0(qemuNumaPlacementDomain, 1);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    size_t i;
+
+    for (i = 0; i < virDomainDefGetVcpusMax(def); i++) {
+        virDomainVcpuDef *vcpu = virDomainDefGetVcpu(def, i);
+        virBitmap *cpumask = vcpu->cpumask;
+        unsigned int ncpus;
+        ssize_t last;
+        ssize_t cpu = -1;
+
+        if (!vcpu->online)
+            continue;
+
+        if (!cpumask) {
+            if (def->placement_mode == VIR_DOMAIN_CPU_PLACEMENT_MODE_AUTO)
+                cpumask = autoCpuset;
+            else
+                cpumask = def->cpumask;
+        }
+
+        if (!cpumask ||
+            (ncpus = virBitmapCountBits(cpumask)) == 0 ||
+            (last = virBitmapLastSetBit(cpumask)) < 0)
+            continue;
+
+        if (last >= dom->ncpuLoad)
+            VIR_EXPAND_N(dom->cpuLoad, dom->ncpuLoad, last + 1 - dom->ncpuLoad);
+
+        while ((cpu = virBitmapNextSetBit(cpumask, cpu)) >= 0)
+            dom->cpuLoad[cpu] += 1.0 / ncpus;
+    }
+
+    virUUIDFormat(def->uuid, uuidstr);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&driver->lock) {
+        qemuNumaPlacementDomain *old;
+
+        if (!driver->numaPlacements)
+            driver->numaPlacements = virHashNew(qemuNumaPlacementDomainFree);
+
+        if (lastMove == 0 &&
+            (old = virHashLookup(driver->numaPlacements, uuidstr)))
+            lastMove = old->lastMove;
+
+        dom->lastMove = lastMove;
+
+        if (virHashUpdateEntry(driver->numaPlacements, uuidstr, dom) < 0)
+            qemuNumaPlacementDomainFree(dom);
+    }
+}
+
+
+/**
+ * qemuNumaPlacementRegister:
+ * @driver: qemu driver
+ * @vm: running domain object
+ *
+ * Records host CPUs used by pinned vCPUs of @vm so that
+ * qemuNumaPlacementAdvise can avoid overloaded NUMA nodes. Calling this
+ * function again replaces the previous record. vCPUs which are not pinned
+ * are not recorded as they can run on any host CPU.
+ */
+void
+qemuNumaPlacementRegister(virQEMUDriver *driver,
+                          virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    qemuNumaPlacementRegisterInternal(driver, vm, priv->autoCpuset, 0);
+}
+
+
+/**
+ * qemuNumaPlacementUnregister:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Drops the record created by qemuNumaPlacementRegister.
+ */
+void
+qemuNumaPlacementUnregister(virQEMUDriver *driver,
+                            virDomainObj *vm)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(vm->def->uuid, uuidstr);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&driver->lock) {
+        if (driver->numaPlacements)
+            virHashRemoveEntry(driver->numaPlacements, uuidstr);
+    }
+}
+
+
+static int
+qemuNumaPlacementMoveThread(virCgroup *parent,
+                            virCgroupThreadName nameval,
+                            int id,
+                            pid_t pid,
+                            virBitmap *cpumask,
+                            const char *mems)
+{
+    g_autoptr(virCgroup) cgroup = NULL;
+
+    if (virCgroupNewThread(parent, nameval, id, false, &cgroup) < 0)
+        return -1;
+
+    /* Change CPUs first so that new allocations already happen on the
+     * target nodes while the memory is being migrated. */
+    if (cpumask) {
+        if (virDomainCgroupSetupCpusetCpus(cgroup, cpumask) < 0)
+            return -1;
+
+        if (pid > 0 && virProcessSetAffinity(pid, cpumask, false) < 0)
+            return -1;
+    }
+
+    if (virCgroupSetCpusetMemoryMigrate(cgroup, true) < 0 ||
+        virCgroupSetCpusetMems(cgroup, mems) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuNumaPlacementCanMove:
+ * @vm: domain object
+ *
+ * Returns true if @vm is running with automatic NUMA placement which can be
+ * changed without restarting it, i.e. its memory is bound only by cgroups
+ * ('restrictive' mode or no <numatune> at all) and not by QEMU itself.
+ * Domains backed by hugepages are not considered as the kernel does not
+ * report their memory per node in the cgroup statistics.
+ */
+bool
+qemuNumaPlacementCanMove(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    virDomainNumatuneMemMode mode;
+
+    if (!virDomainObjIsActive(vm) || !priv->autoNodeset || !priv->autoCpuset)
+        return false;
+
+    if (!virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET))
+        return false;
+
+    if (vm->def->mem.nhugepages > 0)
+        return false;
+
+    if (virDomainNumatuneGetMode(vm->def->numa, -1, &mode) == 0 &&
+        mode != VIR_DOMAIN_NUMATUNE_MEM_RESTRICTIVE)
+        return false;
+
+    if (virDomainNumatuneHasPerNodeBinding(vm->def->numa))
+        return false;
+
+    return true;
+}
+
+
+/**
+ * qemuNumaPlacementMove:
+ * @driver: qemu driver
+ * @vm: running domain object
+ * @nodeset: new host NUMA nodes for @vm
+ *
+ * Moves emulator, vCPU and IOThread threads of @vm which are not pinned
+ * explicitly to the CPUs of @nodeset and migrates the memory of @vm to the
+ * nodes of @nodeset using cgroups. The memory of @vm is restricted to
+ * @nodeset afterwards even if it was not restricted by <numatune>. Updates
+ * the automatic placement of @vm on success. The caller must hold a modify
+ * job and check qemuNumaPlacementCanMove.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuNumaPlacementMove(virQEMUDriver *driver,
+                      virDomainObj *vm,
+                      virBitmap *nodeset)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    virDomainDef *def = vm->def;
+    g_autoptr(virCapsHostNUMA) caps = NULL;
+    g_autoptr(virBitmap) cpuset = NULL;
+    g_autoptr(virBitmap) memNodeset = NULL;
+    g_autoptr(virBitmap) hostMemoryNodeset = NULL;
+    g_autofree char *mems = NULL;
+    unsigned long long now = 0;
+    size_t i;
+
+    if (!(caps = virCapabilitiesHostNUMANewHost()) ||
+        !(cpuset = virCapabilitiesHostNUMAGetCpus(caps, nodeset)) ||
+        !(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
+        return -1;
+
+    memNodeset = virBitmapNewCopy(nodeset);
+    virBitmapIntersect(memNodeset, hostMemoryNodeset);
+
+    if (virBitmapIsAllClear(memNodeset) || virBitmapIsAllClear(cpuset)) {
+        g_autofree char *nodesetStr = virBitmapFormat(nodeset);
+
+        virReportError(VIR_ERR_OPERATION_FAILED,
+                       _("host NUMA nodes '%1$s' have no CPUs or memory"),
+                       nodesetStr);
+        return -1;
+    }
+
+    /* Restrict the memory even without <numatune>, the kernel would not
+     * move pages which were already allocated on the old nodes otherwise. */
+    mems = virBitmapFormat(memNodeset);
+
+    VIR_DEBUG("Moving domain '%s' to host NUMA nodes '%s'", def->name, mems);
+
+    if (qemuNumaPlacementMoveThread(priv->cgroup, VIR_CGROUP_THREAD_EMULATOR, 0,
+                                    vm->pid,
+                                    def->cputune.emulatorpin ? NULL : cpuset,
+                                    mems) < 0)
+        return -1;
+
+    for (i = 0; i < virDomainDefGetVcpusMax(def); i++) {
+        virDomainVcpuDef *vcpu = virDomainDefGetVcpu(def, i);
+
+        if (!vcpu->online)
+            continue;
+
+        if (qemuNumaPlacementMoveThread(priv->cgroup, VIR_CGROUP_THREAD_VCPU, i,
+                                        qemuDomainGetVcpuPid(vm, i),
+                                        vcpu->cpumask ? NULL : cpuset,
+                                        mems) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < def->niothreadids; i++) {
+        virDomainIOThreadIDDef *iothread = def->iothreadids[i];
+
+        if (qemuNumaPlacementMoveThread(priv->cgroup, VIR_CGROUP_THREAD_IOTHREAD,
+                                        iothread->iothread_id,
+                                        iothread->thread_id,
+                                        iothread->cpumask ? NULL : cpuset,
+                                        mems) < 0)
+            return -1;
+    }
+
+    virBitmapFree(priv->autoNodeset);
+    priv->autoNodeset = g_steal_pointer(&memNodeset);
+    virBitmapFree(priv->autoCpuset);
+    priv->autoCpuset = g_steal_pointer(&cpuset);
+
+    ignore_value(virTimeMillisNow(&now));
+    qemuNumaPlacementRegisterInternal(driver, vm, priv->autoCpuset, now);
+
+    return 0;
+}
+
+
+typedef struct _qemuNumaRebalanceData qemuNumaRebalanceData;
+struct _qemuNumaRebalanceData {
+    virQEMUDriver *driver;
+    unsigned long long now;
+    unsigned long long cooldown;
+    unsigned int moves;
+    unsigned int maxMoves;
+};
+
+
+static bool
+qemuNumaRebalanceCoolingDown(qemuNumaRebalanceData *data,
+                             virDomainObj *vm)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    qemuNumaPlacementDomain *dom;
+
+    virUUIDFormat(vm->def->uuid, uuidstr);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&data->driver->lock) {
+        if (data->driver->numaPlacements &&
+            (dom = virHashLookup(data->driver->numaPlacements, uuidstr)) &&
+            dom->lastMove + data->cooldown > data->now)
+            return true;
+    }
+
+    return false;
+}
+
+
+static int
+qemuNumaRebalanceDomain(virDomainObj *vm,
+                        qemuNumaRebalanceData *data)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(qemuNumaPlacementHost) host = NULL;
+    g_autofree unsigned long long *ownMem = NULL;
+    size_t nownMem = 0;
+    g_autoptr(virBitmap) current = NULL;
+    g_autoptr(virBitmap) advice = NULL;
+    g_autoptr(virBitmap) cpuset = NULL;
+    g_autofree char *currentStr = NULL;
+    g_autofree char *adviceStr = NULL;
+    unsigned int vcpus;
+    unsigned long long memory;
+    VIR_LOCK_GUARD lock = virObjectLockGuard(vm);
+    size_t i;
+
+    if (data->moves >= data->maxMoves ||
+        !qemuNumaPlacementCanMove(vm) ||
+        qemuNumaRebalanceCoolingDown(data, vm))
+        return 0;
+
+    if (virCgroupGetMemoryNumaStat(priv->cgroup, &ownMem, &nownMem) < 0) {
+        VIR_WARN("Unable to get NUMA memory statistics of domain '%s': %s",
+                 vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+        return 0;
+    }
+
+    if (!(host = qemuNumaPlacementHostNew(data->driver, vm, ownMem, nownMem)))
+        return -1;
+
+    /* nodes without memory are not part of autoNodeset */
+    current = virBitmapNewCopy(priv->autoNodeset);
+    for (i = 0; i < host->numa->cells->len; i++) {
+        virCapsHostNUMACell *cell = g_ptr_array_index(host->numa->cells, i);
+        size_t j;
+
+        for (j = 0; j < cell->ncpus; j++) {
+            if (virBitmapIsBitSet(priv->autoCpuset, cell->cpus[j].id)) {
+                virBitmapSetBitExpand(current, cell->num);
+                break;
+            }
+        }
+    }
+
+    vcpus = virDomainDefGetVcpus(vm->def);
+    memory = virDomainDefGetMemoryTotal(vm->def);
+
+    if (!(advice = qemuNumaPlacementCompute(host, vcpus, memory)))
+        return -1;
+
+    if (!qemuNumaPlacementShouldMove(host, current, advice, vcpus, memory))
+        return 0;
+
+    currentStr = virBitmapFormat(current);
+    adviceStr = virBitmapFormat(advice);
+    VIR_DEBUG("Rebalancing domain '%s' from host NUMA nodes '%s' to '%s'",
+              vm->def->name, currentStr, adviceStr);
+
+    /* Account the domain on its new nodes right away so that other domains
+     * considered in this round do not pick the same nodes. */
+    if (!(cpuset = virCapabilitiesHostNUMAGetCpus(host->numa, advice)))
+        return -1;
+
+    qemuNumaPlacementRegisterInternal(data->driver, vm, cpuset, data->now);
+
+    qemuProcessEventSubmit(vm, QEMU_PROCESS_EVENT_NUMA_REBALANCE, 0, 0,
+                           g_steal_pointer(&advice));
+    data->moves++;
+
+    return 0;
+}
+
+
+/*
+ * Reads cgroup statistics and host NUMA state of each domain, so the
+ * domains are collected first rather than visited with the domain list
+ * locked.
+ */
+static void
+qemuNumaRebalanceDomains(qemuNumaRebalanceData *data)
+{
+    virDomainObj **vms = NULL;
+    size_t nvms = 0;
+    size_t i;
+
+    virDomainObjListCollect(data->driver->domains, NULL, &vms, &nvms,
+                            NULL, VIR_CONNECT_LIST_DOMAINS_ACTIVE);
+
+    for (i = 0; i < nvms; i++) {
+        if (qemuNumaRebalanceDomain(vms[i], data) < 0) {
+            VIR_WARN("Unable to rebalance domain '%s': %s",
+                     vms[i]->def->name, virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    virObjectListFreeCount(vms, nvms);
+}
+
+
+static void
+qemuNumaRebalancerRun(unsigned long long now,
+                      void *opaque)
+{
+    qemuNumaRebalancer *rebalancer = opaque;
+    qemuNumaRebalanceData data = {
+        .driver = rebalancer->driver,
+        .now = now,
+        .cooldown = rebalancer->period * 1000ull * QEMU_NUMA_REBALANCE_COOLDOWN,
+        .maxMoves = rebalancer->maxMoves,
+    };
+
+    qemuNumaRebalanceDomains(&data);
+
+    if (data.moves > 0)
+        VIR_DEBUG("Moved %u domain(s) to other host NUMA nodes", data.moves);
+}
+
+
+/**
+ * qemuNumaRebalancerStart:
+ * @driver: qemu driver
+ *
+ * Starts a thread which periodically looks for running domains with
+ * automatic NUMA placement whose nodes became overloaded or which would be
+ * closer together elsewhere, and moves at most 'numa_rebalance_max_moves'
+ * of them per 'numa_rebalance_period'. Moved domains are left alone for
+ * several periods. Nothing is started if 'numa_rebalance_period' is 0.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuNumaRebalancerStart(virQEMUDriver *driver)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autofree qemuNumaRebalancer *rebalancer = NULL;
+
+    if (cfg->numaRebalancePeriod == 0 || driver->numaRebalancer)
+        return 0;
+
+    if (!virNumaIsAvailable()) {
+        VIR_WARN("NUMA rebalancing requested but host NUMA is not available");
+        return 0;
+    }
+
+    rebalancer = g_new0(qemuNumaRebalancer, 1);
+    rebalancer->driver = driver;
+    rebalancer->period = cfg->numaRebalancePeriod;
+    rebalancer->maxMoves = cfg->numaRebalanceMaxMoves;
+
+    if (!(rebalancer->worker = virPeriodicWorkerNew("qemu-numa-rebalance",
+                                                    rebalancer->period * 1000ull,
+                                                    qemuNumaRebalancerRun,
+                                                    rebalancer)))
+        return -1;
+
+    driver->numaRebalancer = g_steal_pointer(&rebalancer);
+
+    return 0;
+}
+
+
+/**
+ * qemuNumaRebalancerStop:
+ * @driver: qemu driver
+ *
+ * Stops the thread started by qemuNumaRebalancerStart, if any.
+ */
+void
+qemuNumaRebalancerStop(virQEMUDriver *driver)
+{
+    qemuNumaRebalancer *rebalancer = g_steal_pointer(&driver->numaRebalancer);
+
+    if (!rebalancer)
+        return;
+
+    virPeriodicWorkerFree(rebalancer->worker);
+    g_free(rebalancer);
+}
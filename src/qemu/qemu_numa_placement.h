@@ -0,0 +1,78 @@
+/*
+ * qemu_numa_placement.h: built-in automatic NUMA placement
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "qemu_conf.h"
+#include "capabilities.h"
+#include "virbitmap.h"
+
+typedef struct _qemuNumaPlacementHost qemuNumaPlacementHost;
+struct _qemuNumaPlacementHost {
+    virCapsHostNUMA *numa;
+
+    /* memory in KiB usable by the domain in each cell, indexed in the same
+     * way as @numa->cells (free hugepages if the domain uses them) */
+    unsigned long long *memFree;
+
+    /* number of vCPUs of other domains pinned to each host CPU */
+    double *cpuLoad;
+    size_t ncpuLoad;
+};
+
+void
+qemuNumaPlacementHostFree(qemuNumaPlacementHost *host);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuNumaPlacementHost, qemuNumaPlacementHostFree);
+
+virBitmap *
+qemuNumaPlacementCompute(const qemuNumaPlacementHost *host,
+                         unsigned int vcpus,
+                         unsigned long long memory);
+
+bool
+qemuNumaPlacementShouldMove(const qemuNumaPlacementHost *host,
+                            virBitmap *current,
+                            virBitmap *advice,
+                            unsigned int vcpus,
+                            unsigned long long memory);
+
+virBitmap *
+qemuNumaPlacementAdvise(virQEMUDriver *driver,
+                        virDomainObj *vm);
+
+void
+qemuNumaPlacementRegister(virQEMUDriver *driver,
+                          virDomainObj *vm);
+
+void
+qemuNumaPlacementUnregister(virQEMUDriver *driver,
+                            virDomainObj *vm);
+
+bool
+qemuNumaPlacementCanMove(virDomainObj *vm);
+
+int
+qemuNumaPlacementMove(virQEMUDriver *driver,
+                      virDomainObj *vm,
+                      virBitmap *nodeset);
+
+int
+qemuNumaRebalancerStart(virQEMUDriver *driver);
+
+void
+qemuNumaRebalancerStop(virQEMUDriver *driver);
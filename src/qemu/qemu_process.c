@@ -65,6 +65,7 @@
 #include "qemu_dbus.h"
 #include "qemu_snapshot.h"
 #include "qemu_passt.h"
+#include "qemu_numa_placement.h"
 
 #include "cpu/cpu.h"
 #include "cpu/cpu_x86.h"
@@ -276,7 +277,7 @@ qemuConnectAgent(virQEMUDriver *driver, virDomainObj *vm)
  *
  * Submits @eventType to be processed by the asynchronous event handling thread.
  */
-static void
+void
 qemuProcessEventSubmit(virDomainObj *vm,
                        qemuProcessEventType eventType,
                        int action,
@@ -1625,6 +1626,9 @@ qemuProcessHandleMigrationPass(qemuMonitor *mon G_GNUC_UNUSED,
     virObjectEventStateQueue(priv->driver->domainEventState,
                          virDomainEventMigrationIterationNewFromObj(vm, pass));
 
+    /* let the migration job react to the new iteration */
+    virDomainObjBroadcast(vm);
+
  cleanup:
     virObjectUnlock(vm);
 }
@@ -6467,29 +6471,36 @@ static int
 qemuProcessPrepareDomainNUMAPlacement(virDomainObj *vm)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
-    g_autofree char *nodeset = NULL;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
     g_autoptr(virBitmap) numadNodeset = NULL;
     g_autoptr(virBitmap) hostMemoryNodeset = NULL;
     g_autoptr(virCapsHostNUMA) caps = NULL;
 
-    /* Get the advisory nodeset from numad if 'placement' of
-     * either <vcpu> or <numatune> is 'auto'.
+    /* Get the advisory nodeset if 'placement' of either <vcpu> or
+     * <numatune> is 'auto'.
      */
     if (!virDomainDefNeedsPlacementAdvice(vm->def))
         return 0;
 
-    nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(vm->def),
-                                            virDomainDefGetMemoryTotal(vm->def));
+    if (cfg->numaPlacement == QEMU_NUMA_PLACEMENT_BUILTIN) {
+        if (!(numadNodeset = qemuNumaPlacementAdvise(priv->driver, vm)))
+            return -1;
+    } else {
+        g_autofree char *nodeset = NULL;
 
-    if (!nodeset)
-        return -1;
+        nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(vm->def),
+                                                virDomainDefGetMemoryTotal(vm->def));
 
-    if (!(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
-        return -1;
+        if (!nodeset)
+            return -1;
+
+        VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
 
-    VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
+        if (virBitmapParse(nodeset, &numadNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
+            return -1;
+    }
 
-    if (virBitmapParse(nodeset, &numadNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
+    if (!(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
         return -1;
 
     if (!(caps = virCapabilitiesHostNUMANewHost()))
@@ -6765,6 +6776,8 @@ qemuProcessPrepareDomain(virQEMUDriver *driver,
 
         if (qemuProcessPrepareDomainNUMAPlacement(vm) < 0)
             return -1;
+
+        qemuNumaPlacementRegister(driver, vm);
     }
 
     /* Whether we should use virtlogd as stdio handler for character
@@ -9076,6 +9089,8 @@ qemuProcessStop(virDomainObj *vm,
 
     qemuSecurityReleaseLabel(driver->securityManager, vm->def);
 
+    qemuNumaPlacementUnregister(driver, vm);
+
     /* clear all private data entries which are no longer needed */
     qemuDomainObjPrivateDataClear(priv);
 
@@ -9443,6 +9458,8 @@ qemuProcessReconnect(void *opaque)
     if (qemuHostdevUpdateActiveDomainDevices(driver, obj->def) < 0)
         goto error;
 
+    qemuNumaPlacementRegister(driver, obj);
+
     if (qemuDomainObjStartWorker(obj) < 0)
         goto error;
 
@@ -48,6 +48,12 @@ int qemuProcessDestroyMemoryBackingPath(virDomainObj *vm,
 
 void qemuProcessReconnectAll(virQEMUDriver *driver);
 
+void qemuProcessEventSubmit(virDomainObj *vm,
+                            qemuProcessEventType eventType,
+                            int action,
+                            int status,
+                            void *data);
+
 typedef struct _qemuProcessIncomingDef qemuProcessIncomingDef;
 struct _qemuProcessIncomingDef {
     char *address; /* address where QEMU is supposed to listen */
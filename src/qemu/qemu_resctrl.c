@@ -0,0 +1,402 @@
+/*
+ * qemu_resctrl.c: dynamic resctrl allocations of running domains
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "qemu_resctrl.h"
+#include "viralloc.h"
+#include "virhash.h"
+#include "virlog.h"
+#include "virperiodicworker.h"
+#include "virresctrl.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+VIR_LOG_INIT("qemu.qemu_resctrl");
+
+/* memory bandwidth relative to the average of all domains with a limit
+ * above which the limit is applied and below which it is lifted again */
+#define QEMU_RESCTRL_THROTTLE_ON 2.0
+#define QEMU_RESCTRL_THROTTLE_OFF 1.0
+
+
+typedef struct _qemuResctrlBandwidth qemuResctrlBandwidth;
+struct _qemuResctrlBandwidth {
+    unsigned long long bytes; /* sum of mbm_total_bytes of all nodes */
+    unsigned long long time; /* time of the sample in ms */
+    unsigned long long tick; /* scheduling round of the sample */
+    bool throttled;
+};
+
+
+struct _qemuResctrlScheduler {
+    virQEMUDriver *driver;
+    virPeriodicWorker *worker;
+
+    /* monitoring features available on the host */
+    bool occupancy;
+    bool bandwidth;
+
+    /* Accessed only from the worker thread. Last memory bandwidth
+     * sample of each allocation, indexed by domain UUID and allocation ID */
+    GHashTable *samples;
+    unsigned long long tick;
+};
+
+
+typedef struct _qemuResctrlSchedulerData qemuResctrlSchedulerData;
+struct _qemuResctrlSchedulerData {
+    qemuResctrlScheduler *scheduler;
+    unsigned long long now;
+    unsigned long long tick;
+
+    virResctrlAllocUsage *usage;
+    size_t nusage;
+
+    /* memory bandwidth sample of each item in @usage, NULL if the allocation
+     * does not limit memory bandwidth or its rate is not known yet */
+    qemuResctrlBandwidth **bandwidth;
+    size_t nbandwidth;
+    double *rates; /* in bytes per second */
+    size_t nrates;
+};
+
+
+static int
+qemuResctrlHasMemoryBandwidth(unsigned int id G_GNUC_UNUSED,
+                              unsigned int size G_GNUC_UNUSED,
+                              void *opaque)
+{
+    bool *has = opaque;
+
+    *has = true;
+    return 0;
+}
+
+
+static void
+qemuResctrlSchedulerGetUsage(qemuResctrlSchedulerData *data,
+                             virDomainObj *vm,
+                             virResctrlAlloc *alloc)
+{
+    qemuResctrlScheduler *scheduler = data->scheduler;
+    virResctrlAllocUsage usage = { .alloc = virObjectRef(alloc) };
+    qemuResctrlBandwidth *sample = NULL;
+    const char *resources[3] = { NULL };
+    virResctrlMonitorStats **stats = NULL;
+    size_t nstats = 0;
+    unsigned long long bytes = 0;
+    double rate = 0;
+    bool has_rate = false;
+    bool limited = false;
+    size_t nresources = 0;
+    size_t i;
+
+    ignore_value(virResctrlAllocForeachMemory(alloc,
+                                              qemuResctrlHasMemoryBandwidth,
+                                              &limited));
+
+    /* keep the configured limit unless we know better */
+    usage.throttle = limited;
+
+    if (scheduler->occupancy)
+        resources[nresources++] = "llc_occupancy";
+    if (scheduler->bandwidth && limited)
+        resources[nresources++] = "mbm_total_bytes";
+
+    if (nresources > 0 &&
+        virResctrlAllocGetStats(alloc, resources, &stats, &nstats) < 0) {
+        VIR_DEBUG("Unable to get resctrl statistics of domain '%s': %s",
+                  vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+        nstats = 0;
+    }
+
+    for (i = 0; i < nstats; i++) {
+        size_t j;
+
+        for (j = 0; j < stats[i]->nvals; j++) {
+            if (STREQ(stats[i]->features[j], "llc_occupancy")) {
+                if (usage.noccupancy <= stats[i]->id)
+                    VIR_EXPAND_N(usage.occupancy, usage.noccupancy,
+                                 stats[i]->id - usage.noccupancy + 1);
+                usage.occupancy[stats[i]->id] = stats[i]->vals[j];
+            } else {
+                bytes += stats[i]->vals[j];
+            }
+        }
+    }
+
+    if (nstats > 0 && scheduler->bandwidth && limited) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+        g_autofree char *key = NULL;
+
+        virUUIDFormat(vm->def->uuid, uuidstr);
+        key = g_strdup_printf("%s/%s", uuidstr,
+                              NULLSTR(virResctrlAllocGetID(alloc)));
+
+        if ((sample = virHashLookup(scheduler->samples, key))) {
+            if (sample->bytes <= bytes && sample->time < data->now) {
+                rate = (bytes - sample->bytes) * 1000.0 / (data->now - sample->time);
+                has_rate = true;
+            } else {
+                /* the counters were reset */
+                sample->throttled = false;
+            }
+        } else {
+            sample = g_new0(qemuResctrlBandwidth, 1);
+            g_hash_table_insert(scheduler->samples, g_steal_pointer(&key), sample);
+        }
+
+        sample->bytes = bytes;
+        sample->time = data->now;
+        sample->tick = data->tick;
+        usage.throttle = sample->throttled;
+    }
+
+    for (i = 0; i < nstats; i++)
+        virResctrlMonitorStatsFree(stats[i]);
+    g_free(stats);
+
+    if (!has_rate)
+        sample = NULL;
+
+    VIR_APPEND_ELEMENT(data->usage, data->nusage, usage);
+    VIR_APPEND_ELEMENT(data->bandwidth, data->nbandwidth, sample);
+    VIR_APPEND_ELEMENT(data->rates, data->nrates, rate);
+}
+
+
+static int
+qemuResctrlSchedulerCollect(virDomainObj *vm,
+                            void *opaque)
+{
+    qemuResctrlSchedulerData *data = opaque;
+    VIR_LOCK_GUARD lock = virObjectLockGuard(vm);
+    size_t i;
+
+    if (!virDomainObjIsActive(vm))
+        return 0;
+
+    for (i = 0; i < vm->def->nresctrls; i++) {
+        virResctrlAlloc *alloc = vm->def->resctrls[i]->alloc;
+
+        if (!alloc || virResctrlAllocIsEmpty(alloc))
+            continue;
+
+        qemuResctrlSchedulerGetUsage(data, vm, alloc);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Limit memory bandwidth of domains which consume much more than the
+ * others, and lift the limit once they calm down.
+ */
+static void
+qemuResctrlSchedulerThrottle(qemuResctrlSchedulerData *data)
+{
+    double total = 0;
+    double average;
+    size_t nrates = 0;
+    size_t i;
+
+    for (i = 0; i < data->nusage; i++) {
+        if (!data->bandwidth[i])
+            continue;
+
+        total += data->rates[i];
+        nrates++;
+    }
+
+    if (nrates < 2)
+        return;
+
+    average = total / nrates;
+
+    for (i = 0; i < data->nusage; i++) {
+        qemuResctrlBandwidth *sample = data->bandwidth[i];
+
+        if (!sample)
+            continue;
+
+        if (sample->throttled)
+            sample->throttled = data->rates[i] > average * QEMU_RESCTRL_THROTTLE_OFF;
+        else
+            sample->throttled = data->rates[i] > average * QEMU_RESCTRL_THROTTLE_ON;
+
+        data->usage[i].throttle = sample->throttled;
+    }
+}
+
+
+static int
+qemuResctrlSchedulerIsStale(const void *payload,
+                            const char *name G_GNUC_UNUSED,
+                            const void *opaque)
+{
+    const qemuResctrlBandwidth *sample = payload;
+    const unsigned long long *tick = opaque;
+
+    return sample->tick != *tick;
+}
+
+
+static void
+qemuResctrlSchedulerRun(unsigned long long now,
+                        void *opaque)
+{
+    qemuResctrlScheduler *scheduler = opaque;
+    g_autoptr(virCaps) caps = NULL;
+    qemuResctrlSchedulerData data = {
+        .scheduler = scheduler,
+        .now = now,
+        .tick = ++scheduler->tick,
+    };
+    size_t i;
+
+    virDomainObjListForEach(scheduler->driver->domains, false,
+                            qemuResctrlSchedulerCollect, &data);
+
+    virHashRemoveSet(scheduler->samples, qemuResctrlSchedulerIsStale,
+                     &data.tick);
+
+    if (data.nusage == 0)
+        return;
+
+    qemuResctrlSchedulerThrottle(&data);
+
+    if (!(caps = virQEMUDriverGetCapabilities(scheduler->driver, false)) ||
+        virResctrlAllocRedistribute(caps->host.resctrl,
+                                    data.usage, data.nusage) < 0) {
+        VIR_WARN("Unable to redistribute resctrl allocations: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    for (i = 0; i < data.nusage; i++) {
+        virObjectUnref(data.usage[i].alloc);
+        g_free(data.usage[i].occupancy);
+    }
+    g_free(data.usage);
+    g_free(data.bandwidth);
+    g_free(data.rates);
+}
+
+
+static bool
+qemuResctrlHasMonitor(virResctrlInfo *resctrl,
+                      const char *prefix,
+                      const char *feature)
+{
+    virResctrlInfoMon *mon = NULL;
+    bool ret = false;
+
+    if (virResctrlInfoGetMonitorPrefix(resctrl, prefix, &mon) < 0) {
+        virResetLastError();
+        return false;
+    }
+
+    if (mon)
+        ret = g_strv_contains((const char **) mon->features, feature);
+
+    virResctrlInfoMonFree(mon);
+    return ret;
+}
+
+
+/**
+ * qemuResctrlSchedulerStart:
+ * @driver: qemu driver
+ *
+ * Starts a thread which every 'resctrl_dynamic_period' lends cache of
+ * idle domains to busy ones and limits memory bandwidth of domains which
+ * consume much more than the others, see virResctrlAllocRedistribute().
+ * Nothing is started if 'resctrl_dynamic_period' is 0.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuResctrlSchedulerStart(virQEMUDriver *driver)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autoptr(virCaps) caps = NULL;
+    g_autofree qemuResctrlScheduler *scheduler = NULL;
+
+    if (cfg->resctrlDynamicPeriod == 0 || driver->resctrlScheduler)
+        return 0;
+
+    if (!(caps = virQEMUDriverGetCapabilities(driver, false)))
+        return -1;
+
+    if (!caps->host.resctrl) {
+        VIR_WARN("Dynamic resctrl allocations requested but resource control is not available");
+        return 0;
+    }
+
+    scheduler = g_new0(qemuResctrlScheduler, 1);
+    scheduler->driver = driver;
+    scheduler->occupancy = qemuResctrlHasMonitor(caps->host.resctrl, "llc_",
+                                                 "llc_occupancy");
+    scheduler->bandwidth = qemuResctrlHasMonitor(caps->host.resctrl, "mbm_",
+                                                 "mbm_total_bytes");
+
+    if (!scheduler->occupancy && !scheduler->bandwidth) {
+        VIR_WARN("Dynamic resctrl allocations requested but neither cache occupancy nor memory bandwidth monitoring is available");
+        return 0;
+    }
+
+    scheduler->samples = virHashNew(g_free);
+
+    if (!(scheduler->worker = virPeriodicWorkerNew("qemu-resctrl",
+                                                   cfg->resctrlDynamicPeriod * 1000ull,
+                                                   qemuResctrlSchedulerRun,
+                                                   scheduler))) {
+        g_hash_table_unref(scheduler->samples);
+        return -1;
+    }
+
+    driver->resctrlScheduler = g_steal_pointer(&scheduler);
+
+    return 0;
+}
+
+
+/**
+ * qemuResctrlSchedulerStop:
+ * @driver: qemu driver
+ *
+ * Stops the thread started by qemuResctrlSchedulerStart, if any. The
+ * allocations are left as they were last redistributed.
+ */
+void
+qemuResctrlSchedulerStop(virQEMUDriver *driver)
+{
+    qemuResctrlScheduler *scheduler = g_steal_pointer(&driver->resctrlScheduler);
+
+    if (!scheduler)
+        return;
+
+    virPeriodicWorkerFree(scheduler->worker);
+
+    g_hash_table_unref(scheduler->samples);
+    g_free(scheduler);
+}
@@ -56,6 +56,8 @@ struct daemonClientPrivate {
     daemonClientEventCallback **secretEventCallbacks;
     size_t nsecretEventCallbacks;
     bool closeRegistered;
+    /* Client advertised VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD */
+    bool streamLargePayload;
 
 #if WITH_SASL
     virNetSASLSession *sasl;
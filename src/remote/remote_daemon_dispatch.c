@@ -5043,6 +5043,16 @@ static int remoteDispatchConnectSupportsFeature(virNetServer *server G_GNUC_UNUS
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
         supported = 1;
         break;
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD: {
+        daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+        VIR_LOCK_GUARD lock = virLockGuardLock(&priv->lock);
+
+        /* Only clients which know about the feature ask for it, so from
+         * now on they can be sent large stream packets */
+        priv->streamLargePayload = true;
+        supported = 1;
+        break;
+    }
     case VIR_DRV_FEATURE_MIGRATION_V1:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_MIGRATION_V2:
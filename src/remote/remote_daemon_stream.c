@@ -844,7 +844,10 @@ daemonStreamHandleRead(virNetServerClient *client,
     if (!stream->tx)
         return 0;
 
-    buffer = g_new0(char, bufferLen);
+    /* Clients which negotiated it can cope with larger packets,
+     * which saves a round trip through the event loop per chunk */
+    if (stream->priv->streamLargePayload)
+        bufferLen = VIR_NET_MESSAGE_STREAM_PAYLOAD_MAX;
 
     if (!(msg = virNetMessageNew(false)))
         goto cleanup;
@@ -903,6 +906,14 @@ daemonStreamHandleRead(virNetServerClient *client,
         bufferLen > stream->dataLen)
         bufferLen = stream->dataLen;
 
+    /* Receive the data directly into the message to be sent */
+    if (!(buffer = virNetServerProgramPrepareStreamData(stream->prog,
+                                                        msg,
+                                                        stream->procedure,
+                                                        stream->serial,
+                                                        bufferLen)))
+        goto cleanup;
+
     rv = virStreamRecv(stream->st, buffer, bufferLen);
     if (rv == -2) {
         /* Should never get this, since we're only called when we know
@@ -940,7 +951,6 @@ daemonStreamHandleRead(virNetServerClient *client,
  done:
     ret = 0;
  cleanup:
-    VIR_FREE(buffer);
     virNetMessageFree(msg);
     return ret;
 }
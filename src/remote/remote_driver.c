@@ -94,6 +94,7 @@ struct private_data {
     bool serverKeepAlive;       /* Does server support keepalive protocol? */
     bool serverEventFilter;     /* Does server support modern event filtering */
     bool serverCloseCallback;   /* Does server support driver close callback */
+    bool serverStreamLargePayload; /* Does server support large stream packets */
 
     virObjectEventState *eventState;
     virConnectCloseCallbackData *closeCallback;
@@ -1298,6 +1299,14 @@ doRemoteOpen(virConnectPtr conn,
                  "by the remote side.");
     }
 
+    /* Asking is what tells the server we can take large stream packets */
+    priv->serverStreamLargePayload = remoteConnectSupportsFeatureUnlocked(conn,
+                                         priv, VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD);
+    if (!priv->serverStreamLargePayload) {
+        VIR_INFO("Large stream packets aren't supported "
+                 "by the remote side.");
+    }
+
     return VIR_DRV_OPEN_SUCCESS;
 
  error:
@@ -1838,6 +1838,16 @@ elsif ($mode eq "client") {
             print "    }\n";
         }
 
+        if ($call->{ProcName} eq "ConnectSupportsFeature") {
+            # SPECIAL: large stream packets were negotiated when the
+            # connection was opened and are queried for every stream
+            print "\n";
+            print "    if (feature == VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD) {\n";
+            print "        rv = priv->serverStreamLargePayload;\n";
+            print "        goto cleanup;\n";
+            print "    }\n";
+        }
+
         foreach my $args_check (@args_check_list) {
             print "\n";
             print "    if ($args_check->{arg} > $args_check->{limit}) {\n";
@@ -440,6 +440,58 @@ int virNetMessageDecodePayload(virNetMessage *msg,
 }
 
 
+static int
+virNetMessageEnsurePayloadRaw(virNetMessage *msg,
+                              size_t len)
+{
+    /* If the message buffer is too small for the payload increase it accordingly. */
+    if ((msg->bufferLength - msg->bufferOffset) < len) {
+        if ((msg->bufferOffset + len) >
+            (VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)) {
+            virReportError(VIR_ERR_RPC,
+                           _("Stream data too long to send (%1$zu bytes needed, %2$zu bytes available)"),
+                           len,
+                           VIR_NET_MESSAGE_MAX +
+                           VIR_NET_MESSAGE_LEN_MAX -
+                           msg->bufferOffset);
+            return -1;
+        }
+
+        msg->bufferLength = msg->bufferOffset + len;
+
+        VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+
+        VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
+    }
+
+    return 0;
+}
+
+
+/**
+ * virNetMessageEncodePayloadRawBuffer:
+ * @msg: message with already encoded header
+ * @len: maximum length of the payload
+ *
+ * Makes room for @len bytes of raw payload in @msg and returns a pointer to
+ * it. The caller can then fill in the payload directly, e.g. by reading
+ * stream data into the returned buffer, and finish the message by calling
+ * virNetMessageEncodePayloadRaw with the returned pointer and the actual
+ * length of the payload. This saves copying the payload from a temporary
+ * buffer.
+ *
+ * Returns pointer to the payload area of @msg or NULL on error.
+ */
+char *virNetMessageEncodePayloadRawBuffer(virNetMessage *msg,
+                                          size_t len)
+{
+    if (virNetMessageEnsurePayloadRaw(msg, len) < 0)
+        return NULL;
+
+    return msg->buffer + msg->bufferOffset;
+}
+
+
 /**
  * virNetMessageEncodePayloadRaw:
  * @msg: message to encode payload into
@@ -447,7 +499,8 @@ int virNetMessageDecodePayload(virNetMessage *msg,
  * @len: length of @data
  *
  * Encodes message payload. If @data is NULL or @len is 0 an empty message is
- * encoded.
+ * encoded. @data may point to the buffer returned by
+ * virNetMessageEncodePayloadRawBuffer in which case it is not copied.
  */
 int virNetMessageEncodePayloadRaw(virNetMessage *msg,
                                   const char *data,
@@ -457,27 +510,11 @@ int virNetMessageEncodePayloadRaw(virNetMessage *msg,
     unsigned int msglen;
 
     if (data && len > 0) {
-        /* If the message buffer is too small for the payload increase it accordingly. */
-        if ((msg->bufferLength - msg->bufferOffset) < len) {
-            if ((msg->bufferOffset + len) >
-                (VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)) {
-                virReportError(VIR_ERR_RPC,
-                               _("Stream data too long to send (%1$zu bytes needed, %2$zu bytes available)"),
-                               len,
-                               VIR_NET_MESSAGE_MAX +
-                               VIR_NET_MESSAGE_LEN_MAX -
-                               msg->bufferOffset);
-                return -1;
-            }
-
-            msg->bufferLength = msg->bufferOffset + len;
-
-            VIR_REALLOC_N(msg->buffer, msg->bufferLength);
-
-            VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
-        }
+        if (virNetMessageEnsurePayloadRaw(msg, len) < 0)
+            return -1;
 
-        memcpy(msg->buffer + msg->bufferOffset, data, len);
+        if (data != msg->buffer + msg->bufferOffset)
+            memcpy(msg->buffer + msg->bufferOffset, data, len);
         msg->bufferOffset += len;
     }
 
@@ -81,6 +81,9 @@ int virNetMessageDecodePayload(virNetMessage *msg,
 int virNetMessageEncodeNumFDs(virNetMessage *msg);
 int virNetMessageDecodeNumFDs(virNetMessage *msg);
 
+char *virNetMessageEncodePayloadRawBuffer(virNetMessage *msg,
+                                          size_t len)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 int virNetMessageEncodePayloadRaw(virNetMessage *msg,
                                   const char *buf,
                                   size_t len)
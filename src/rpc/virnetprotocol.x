@@ -37,6 +37,13 @@ const VIR_NET_MESSAGE_INITIAL = 65536;
  */
 const VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX = 262120;
 
+/*
+ * Max payload size of a single stream data packet when both
+ * sides advertise VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PAYLOAD.
+ * Must stay well below VIR_NET_MESSAGE_PAYLOAD_MAX.
+ */
+const VIR_NET_MESSAGE_STREAM_PAYLOAD_MAX = 4194304;
+
 /* Maximum total message size (serialised). */
 const VIR_NET_MESSAGE_MAX = 33554432;
 
@@ -483,16 +483,13 @@ virNetServerProgramDispatchCall(virNetServerProgram *prog,
 }
 
 
-int virNetServerProgramSendStreamData(virNetServerProgram *prog,
-                                      virNetServerClient *client,
-                                      virNetMessage *msg,
-                                      int procedure,
-                                      unsigned int serial,
-                                      const char *data,
-                                      size_t len)
+static int
+virNetServerProgramEncodeStreamDataHeader(virNetServerProgram *prog,
+                                          virNetMessage *msg,
+                                          int procedure,
+                                          unsigned int serial,
+                                          bool haveData)
 {
-    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, data, len);
-
     /* Return header. We're reusing same message object, so
      * only need to tweak type/status fields */
     msg->header.prog = prog->program;
@@ -506,9 +503,56 @@ int virNetServerProgramSendStreamData(virNetServerProgram *prog,
      *   data != NULL + len == 0   => VIR_NET_CONTINUE   (Sending read EOF)
      *   data == NULL              => VIR_NET_OK         (Sending finish handshake confirmation)
      */
-    msg->header.status = data ? VIR_NET_CONTINUE : VIR_NET_OK;
+    msg->header.status = haveData ? VIR_NET_CONTINUE : VIR_NET_OK;
 
-    if (virNetMessageEncodeHeader(msg) < 0)
+    return virNetMessageEncodeHeader(msg);
+}
+
+
+/**
+ * virNetServerProgramPrepareStreamData:
+ * @prog: program
+ * @msg: message to be sent
+ * @procedure: stream procedure
+ * @serial: stream serial
+ * @len: maximum length of the data
+ *
+ * Encodes header of stream data message @msg and returns buffer for up to
+ * @len bytes of the data within @msg. Once the caller fills in the data it
+ * shall pass the returned buffer to virNetServerProgramSendStreamData which
+ * then sends @msg without copying the data again.
+ *
+ * Returns pointer to the data buffer or NULL on error.
+ */
+char *virNetServerProgramPrepareStreamData(virNetServerProgram *prog,
+                                           virNetMessage *msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len)
+{
+    if (virNetServerProgramEncodeStreamDataHeader(prog, msg, procedure,
+                                                  serial, true) < 0)
+        return NULL;
+
+    return virNetMessageEncodePayloadRawBuffer(msg, len);
+}
+
+
+int virNetServerProgramSendStreamData(virNetServerProgram *prog,
+                                      virNetServerClient *client,
+                                      virNetMessage *msg,
+                                      int procedure,
+                                      unsigned int serial,
+                                      const char *data,
+                                      size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, data, len);
+
+    /* The header is already encoded if @data was obtained from
+     * virNetServerProgramPrepareStreamData */
+    if ((!data || data != msg->buffer + msg->bufferOffset) &&
+        virNetServerProgramEncodeStreamDataHeader(prog, msg, procedure,
+                                                  serial, !!data) < 0)
         return -1;
 
     if (virNetMessageEncodePayloadRaw(msg, data, len) < 0)
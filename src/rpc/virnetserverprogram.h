@@ -85,6 +85,12 @@ int virNetServerProgramUnknownError(virNetServerClient *client,
                                     virNetMessage *msg,
                                     struct virNetMessageHeader *req);
 
+char *virNetServerProgramPrepareStreamData(virNetServerProgram *prog,
+                                           virNetMessage *msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len);
+
 int virNetServerProgramSendStreamData(virNetServerProgram *prog,
                                       virNetServerClient *client,
                                       virNetMessage *msg,
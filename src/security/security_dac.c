@@ -82,6 +82,7 @@ struct _virSecurityDACChownList {
     char **sharedFilesystems;
     virSecurityDACChownItem **items;
     size_t nItems;
+    GHashTable *lastItems; /* path -> last item appended for the path */
     bool lock;
     bool lockMetadataException;
 };
@@ -111,6 +112,27 @@ virSecurityDACChownListAppend(virSecurityDACChownList *list,
                               bool restore)
 {
     g_autoptr(virSecurityDACChownItem) item = NULL;
+    virSecurityDACChownItem *last = NULL;
+
+    if (path) {
+        if (!list->lastItems)
+            list->lastItems = virHashNew(NULL);
+
+        last = virHashLookup(list->lastItems, path);
+    }
+
+    /* Relabeling a path again to what it was just relabeled to is
+     * a no-op unless the original owner is remembered, which keeps
+     * a reference per call. */
+    if (last &&
+        !last->remember && !remember &&
+        last->restore == restore &&
+        last->src == src &&
+        last->uid == uid &&
+        last->gid == gid) {
+        VIR_DEBUG("Skipping duplicate relabel of '%s'", path);
+        return 0;
+    }
 
     item = g_new0(virSecurityDACChownItem, 1);
 
@@ -121,6 +143,10 @@ virSecurityDACChownListAppend(virSecurityDACChownList *list,
     item->remember = remember;
     item->restore = restore;
 
+    if (path &&
+        virHashUpdateEntry(list->lastItems, path, item) < 0)
+        return -1;
+
     VIR_APPEND_ELEMENT(list->items, list->nItems, item);
 
     return 0;
@@ -138,6 +164,7 @@ virSecurityDACChownListFree(void *opaque)
     for (i = 0; i < list->nItems; i++)
         virSecurityDACChownItemFree(list->items[i]);
     g_free(list->items);
+    g_clear_pointer(&list->lastItems, g_hash_table_unref);
     virObjectUnref(list->manager);
     g_strfreev(list->sharedFilesystems);
     g_free(list);
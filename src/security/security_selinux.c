@@ -80,6 +80,7 @@ struct _virSecuritySELinuxContextList {
     char **sharedFilesystems;
     virSecuritySELinuxContextItem **items;
     size_t nItems;
+    GHashTable *lastItems; /* path -> last item appended for the path */
     bool lock;
     bool lockMetadataException;
 };
@@ -115,6 +116,23 @@ virSecuritySELinuxContextListAppend(virSecuritySELinuxContextList *list,
                                     bool restore)
 {
     virSecuritySELinuxContextItem *item = NULL;
+    virSecuritySELinuxContextItem *last = NULL;
+
+    if (!list->lastItems)
+        list->lastItems = virHashNew(NULL);
+
+    last = virHashLookup(list->lastItems, path);
+
+    /* Relabeling a path again to what it was just relabeled to is
+     * a no-op unless the original label is remembered, which keeps
+     * a reference per call. */
+    if (last &&
+        !last->remember && !remember &&
+        last->restore == restore &&
+        STREQ_NULLABLE(last->tcon, tcon)) {
+        VIR_DEBUG("Skipping duplicate relabel of '%s'", path);
+        return 0;
+    }
 
     item = g_new0(virSecuritySELinuxContextItem, 1);
 
@@ -124,6 +142,11 @@ virSecuritySELinuxContextListAppend(virSecuritySELinuxContextList *list,
     item->remember = remember;
     item->restore = restore;
 
+    if (virHashUpdateEntry(list->lastItems, path, item) < 0) {
+        virSecuritySELinuxContextItemFree(item);
+        return -1;
+    }
+
     VIR_APPEND_ELEMENT(list->items, list->nItems, item);
 
     return 0;
@@ -142,6 +165,7 @@ virSecuritySELinuxContextListFree(void *opaque)
         virSecuritySELinuxContextItemFree(list->items[i]);
 
     g_free(list->items);
+    g_clear_pointer(&list->lastItems, g_hash_table_unref);
     virObjectUnref(list->manager);
     g_strfreev(list->sharedFilesystems);
     g_free(list);
@@ -77,6 +77,7 @@ storagePoolRefreshFailCleanup(virStorageBackend *backend,
         unlink(stateFile);
     if (backend->stopPool)
         backend->stopPool(obj);
+    virStorageBackendProbeCacheDrop(virStoragePoolObjGetDef(obj)->target.path);
     virErrorRestore(&orig_err);
 }
 
@@ -890,6 +891,7 @@ storagePoolUndefine(virStoragePoolPtr pool)
                                             0);
 
     VIR_INFO("Undefining storage pool '%s'", def->name);
+    virStorageBackendProbeCacheDrop(def->target.path);
     virStoragePoolObjRemove(driver->pools, obj);
     ret = 0;
 
@@ -1105,6 +1107,7 @@ storagePoolDestroy(virStoragePoolPtr pool)
         goto cleanup;
 
     virStoragePoolObjClearVols(obj);
+    virStorageBackendProbeCacheDrop(def->target.path);
 
     event = virStoragePoolEventLifecycleNew(def->name,
                                             def->uuid,
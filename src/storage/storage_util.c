@@ -92,6 +92,7 @@ virStorageBackendNamespaceInit(int poolType,
 
 #define READ_BLOCK_SIZE_DEFAULT  (1024 * 1024)
 #define WRITE_BLOCK_SIZE_DEFAULT (4 * 1024)
+#define WIPE_BLOCK_SIZE_DEFAULT  (1024 * 1024)
 
 /*
  * Perform the O(1) btrfs clone operation, if possible.
@@ -2551,19 +2552,54 @@ storageBackendVolZeroSparseFileLocal(const char *path,
 }
 
 
+/*
+ * Let the kernel zero out a range of a block device. Devices supporting
+ * WRITE ZEROES or WRITE SAME do so without the data being transferred.
+ * Unlike discard, BLKZEROOUT guarantees that the range reads back as zeroes.
+ *
+ * Returns 0 on success, -1 if the range has to be overwritten manually.
+ */
+#ifdef BLKZEROOUT
+static int
+storageBackendWipeBlockZeroOut(const char *path,
+                               int fd,
+                               off_t start,
+                               unsigned long long len)
+{
+    uint64_t range[2] = { start, len };
+
+    if (ioctl(fd, BLKZEROOUT, range) < 0) {
+        VIR_DEBUG("BLKZEROOUT of '%s' failed, falling back to writing zeroes: %s",
+                  path, g_strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+#else
+static int
+storageBackendWipeBlockZeroOut(const char *path G_GNUC_UNUSED,
+                               int fd G_GNUC_UNUSED,
+                               off_t start G_GNUC_UNUSED,
+                               unsigned long long len G_GNUC_UNUSED)
+{
+    return -1;
+}
+#endif
+
+
 static int
 storageBackendWipeLocal(const char *path,
                         int fd,
                         unsigned long long wipe_len,
                         size_t writebuf_length,
-                        bool zero_end)
+                        bool zero_end,
+                        bool is_block)
 {
     unsigned long long remaining = 0;
     off_t size;
     g_autofree char *writebuf = NULL;
 
-    writebuf = g_new0(char, writebuf_length);
-
     if (!zero_end) {
         if ((size = lseek(fd, 0, SEEK_SET)) < 0) {
             virReportSystemError(errno,
@@ -2583,6 +2619,21 @@ storageBackendWipeLocal(const char *path,
     VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
 
     remaining = wipe_len;
+
+    if (is_block &&
+        storageBackendWipeBlockZeroOut(path, fd, size, wipe_len) == 0)
+        remaining = 0;
+
+    /* Writing in larger chunks than the preferred I/O size of the volume
+     * considerably reduces the number of syscalls for large volumes. Some
+     * filesystems don't report any preferred I/O size. */
+    if (writebuf_length == 0 ||
+        (writebuf_length < WIPE_BLOCK_SIZE_DEFAULT &&
+         WIPE_BLOCK_SIZE_DEFAULT % writebuf_length == 0))
+        writebuf_length = WIPE_BLOCK_SIZE_DEFAULT;
+
+    writebuf = g_new0(char, writebuf_length);
+
     while (remaining > 0) {
         size_t write_size = MIN(writebuf_length, remaining);
         int written = safewrite(fd, writebuf, write_size);
@@ -2689,7 +2740,7 @@ storageBackendVolWipeLocalFile(const char *path,
         return storageBackendVolZeroSparseFileLocal(path, st.st_size, fd);
 
     return storageBackendWipeLocal(path, fd, allocation, st.st_blksize,
-                                   zero_end);
+                                   zero_end, S_ISBLK(st.st_mode));
 }
 
 
@@ -3365,13 +3416,241 @@ virStorageBackendDeviceIsEmpty(const char *devpath,
 }
 
 
+/*
+ * Cache of probed image metadata of local volumes. Refreshing a pool
+ * requires reading the header of every volume and probing the format of
+ * every backing file which gets expensive for pools with many volumes.
+ * Entries are keyed by the volume path and are valid as long as the
+ * identity, size and timestamps of the file and of its local backing file
+ * didn't change since it was probed.
+ *
+ * The outer table maps the target path of a pool to a table of
+ * virStorageBackendProbeCacheEntry objects of volumes found by the last
+ * successful refresh of that pool.
+ */
+typedef struct _virStorageBackendProbeCacheStat virStorageBackendProbeCacheStat;
+struct _virStorageBackendProbeCacheStat {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+};
+
+typedef struct _virStorageBackendProbeCacheEntry virStorageBackendProbeCacheEntry;
+struct _virStorageBackendProbeCacheEntry {
+    virStorageBackendProbeCacheStat stat;
+
+    /* stat data of the backing file if it is a local file */
+    bool hasBackingStat;
+    virStorageBackendProbeCacheStat backingStat;
+
+    unsigned long long clusterSize;
+    virStorageSource *meta;
+    virStorageSource *backingStore;
+};
+
+typedef struct _virStorageBackendProbeCache virStorageBackendProbeCache;
+struct _virStorageBackendProbeCache {
+    GHashTable *prev; /* entries found by the previous refresh */
+    GHashTable *next; /* entries found by the running refresh */
+};
+
+static virMutex probeCacheLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *probeCache;
+
+
+static void
+virStorageBackendProbeCacheEntryFree(void *opaque)
+{
+    virStorageBackendProbeCacheEntry *entry = opaque;
+
+    if (!entry)
+        return;
+
+    virObjectUnref(entry->meta);
+    virObjectUnref(entry->backingStore);
+    g_free(entry);
+}
+
+
+/**
+ * virStorageBackendProbeCacheSteal:
+ * @poolpath: target path of the pool
+ *
+ * Removes the table of cached entries of pool at @poolpath from the global
+ * cache and returns it to the caller. The returned table is owned by the
+ * caller and thus can be accessed without holding any lock.
+ */
+static GHashTable *
+virStorageBackendProbeCacheSteal(const char *poolpath)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&probeCacheLock);
+    GHashTable *ret = NULL;
+
+    if (!probeCache)
+        return NULL;
+
+    if (!g_hash_table_steal_extended(probeCache, poolpath, NULL,
+                                     (gpointer *) &ret))
+        return NULL;
+
+    return ret;
+}
+
+
+static void
+virStorageBackendProbeCacheStore(const char *poolpath,
+                                 GHashTable *entries)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&probeCacheLock);
+
+    if (!probeCache)
+        probeCache = virHashNew((GDestroyNotify) g_hash_table_unref);
+
+    g_hash_table_insert(probeCache, g_strdup(poolpath), entries);
+}
+
+
+/**
+ * virStorageBackendProbeCacheDrop:
+ * @poolpath: target path of the pool
+ *
+ * Forgets cached metadata of volumes of pool at @poolpath. To be called
+ * once the pool is stopped or undefined.
+ */
+void
+virStorageBackendProbeCacheDrop(const char *poolpath)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&probeCacheLock);
+
+    if (!probeCache || !poolpath)
+        return;
+
+    g_hash_table_remove(probeCache, poolpath);
+}
+
+
+static void
+virStorageBackendProbeCacheStatFill(virStorageBackendProbeCacheStat *st,
+                                    struct stat *sb)
+{
+    st->dev = sb->st_dev;
+    st->ino = sb->st_ino;
+    st->size = sb->st_size;
+#ifdef __APPLE__
+    st->mtime = sb->st_mtimespec;
+    st->ctime = sb->st_ctimespec;
+#else /* ! __APPLE__ */
+    st->mtime = sb->st_mtim;
+    st->ctime = sb->st_ctim;
+#endif /* ! __APPLE__ */
+}
+
+
+static bool
+virStorageBackendProbeCacheStatEqual(const virStorageBackendProbeCacheStat *a,
+                                     const virStorageBackendProbeCacheStat *b)
+{
+    return a->dev == b->dev &&
+           a->ino == b->ino &&
+           a->size == b->size &&
+           a->mtime.tv_sec == b->mtime.tv_sec &&
+           a->mtime.tv_nsec == b->mtime.tv_nsec &&
+           a->ctime.tv_sec == b->ctime.tv_sec &&
+           a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+
+/*
+ * Fills in @st with stat data of @backingStore if it is a local file.
+ * Returns 1 if @st was filled, 0 if @backingStore is not a local file and
+ * -1 if it could not be accessed.
+ */
+static int
+virStorageBackendProbeCacheStatBacking(virStorageSource *backingStore,
+                                       virStorageBackendProbeCacheStat *st)
+{
+    struct stat sb;
+
+    if (!backingStore ||
+        backingStore->type != VIR_STORAGE_TYPE_FILE ||
+        !backingStore->path)
+        return 0;
+
+    if (stat(backingStore->path, &sb) < 0)
+        return -1;
+
+    virStorageBackendProbeCacheStatFill(st, &sb);
+    return 1;
+}
+
+
+static bool
+virStorageBackendProbeCacheEntryMatch(virStorageBackendProbeCacheEntry *entry,
+                                      struct stat *sb)
+{
+    virStorageBackendProbeCacheStat st;
+
+    virStorageBackendProbeCacheStatFill(&st, sb);
+
+    if (!virStorageBackendProbeCacheStatEqual(&entry->stat, &st))
+        return false;
+
+    if (!entry->hasBackingStat)
+        return true;
+
+    /* The backing file could have been replaced or reformatted in which
+     * case its cached format and capacity are stale */
+    if (virStorageBackendProbeCacheStatBacking(entry->backingStore, &st) != 1)
+        return false;
+
+    return virStorageBackendProbeCacheStatEqual(&entry->backingStat, &st);
+}
+
+
+static virStorageBackendProbeCacheEntry *
+virStorageBackendProbeCacheEntryNew(virStorageSource *target,
+                                    struct stat *sb,
+                                    virStorageBackendProbeCacheStat *backingStat,
+                                    virStorageSource *meta)
+{
+    g_autoptr(virStorageSource) metacopy = NULL;
+    g_autoptr(virStorageSource) backingcopy = NULL;
+    virStorageBackendProbeCacheEntry *entry;
+
+    if (!(metacopy = virStorageSourceCopy(meta, false)))
+        return NULL;
+
+    if (target->backingStore &&
+        !(backingcopy = virStorageSourceCopy(target->backingStore, true)))
+        return NULL;
+
+    entry = g_new0(virStorageBackendProbeCacheEntry, 1);
+    virStorageBackendProbeCacheStatFill(&entry->stat, sb);
+    if (backingStat) {
+        entry->hasBackingStat = true;
+        entry->backingStat = *backingStat;
+    }
+    entry->clusterSize = meta->clusterSize;
+    entry->meta = g_steal_pointer(&metacopy);
+    entry->backingStore = g_steal_pointer(&backingcopy);
+
+    return entry;
+}
+
+
 static int
 storageBackendProbeTarget(virStorageSource *target,
-                          virStorageEncryption **encryption)
+                          virStorageEncryption **encryption,
+                          virStorageBackendProbeCache *cache)
 {
     int rc;
     struct stat sb;
     g_autoptr(virStorageSource) meta = NULL;
+    virStorageBackendProbeCacheEntry *entry = NULL;
+    bool cacheable = false;
+    char *key = NULL;
     VIR_AUTOCLOSE fd = -1;
 
     if (encryption)
@@ -3396,12 +3675,41 @@ storageBackendProbeTarget(virStorageSource *target,
         }
     }
 
-    if (!(meta = virStorageSourceGetMetadataFromFD(target->path,
-                                                   fd,
-                                                   VIR_STORAGE_FILE_AUTO)))
+    if (cache && S_ISREG(sb.st_mode)) {
+        cacheable = true;
+
+        if (cache->prev &&
+            (entry = g_hash_table_lookup(cache->prev, target->path)) &&
+            !virStorageBackendProbeCacheEntryMatch(entry, &sb))
+            entry = NULL;
+    }
+
+    if (entry) {
+        VIR_DEBUG("using cached metadata of '%s'", target->path);
+
+        if (!(meta = virStorageSourceCopy(entry->meta, false)))
+            return -1;
+        meta->clusterSize = entry->clusterSize;
+
+        virObjectUnref(target->backingStore);
+        target->backingStore = NULL;
+
+        if (entry->backingStore &&
+            !(target->backingStore = virStorageSourceCopy(entry->backingStore,
+                                                          true)))
+            return -1;
+
+        /* The entry is still valid, move it over to the new table */
+        if (g_hash_table_steal_extended(cache->prev, target->path,
+                                        (gpointer *) &key, NULL))
+            g_hash_table_insert(cache->next, key, entry);
+    } else if (!(meta = virStorageSourceGetMetadataFromFD(target->path,
+                                                          fd,
+                                                          VIR_STORAGE_FILE_AUTO))) {
         return -1;
+    }
 
-    if (meta->backingStoreRaw) {
+    if (!entry && meta->backingStoreRaw) {
         /* XXX: Remote storage doesn't play nicely with volumes backed by
          * remote storage. To avoid trouble, just fake the backing store is RAW
          * and put the string from the metadata as the path of the target. */
@@ -3427,12 +3735,33 @@ storageBackendProbeTarget(virStorageSource *target,
                 virReportError(VIR_ERR_INTERNAL_ERROR,
                                _("cannot probe backing volume format: %1$s"),
                                target->backingStore->path);
+                /* Retry the probe on next refresh */
+                cacheable = false;
             } else {
                 target->backingStore->format = rc;
             }
         }
     }
 
+    if (cacheable && !entry) {
+        virStorageBackendProbeCacheEntry *newentry;
+        virStorageBackendProbeCacheStat backingStat;
+
+        /* Volumes with an inaccessible backing file are probed again on
+         * next refresh */
+        rc = virStorageBackendProbeCacheStatBacking(target->backingStore,
+                                                    &backingStat);
+
+        if (rc >= 0) {
+            if (!(newentry = virStorageBackendProbeCacheEntryNew(target, &sb,
+                                                                 rc == 1 ? &backingStat : NULL,
+                                                                 meta)))
+                return -1;
+
+            g_hash_table_insert(cache->next, g_strdup(target->path), newentry);
+        }
+    }
+
     target->format = meta->format;
 
     /* Default to success below this point */
@@ -3468,15 +3797,19 @@ storageBackendProbeTarget(virStorageSource *target,
 
 
 /**
- * virStorageBackendRefreshVolTargetUpdate:
+ * storageBackendRefreshVolTargetUpdate:
  * @vol: Volume def that needs updating
+ * @cache: cache of probed metadata (may be NULL)
  *
- * Attempt to probe the volume in order to get more details.
+ * Attempt to probe the volume in order to get more details. If @cache is
+ * provided metadata of unmodified volumes is taken from it rather than
+ * being probed again.
  *
  * Returns 0 on success, -2 to ignore failure, -1 on failure
  */
-int
-virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol)
+static int
+storageBackendRefreshVolTargetUpdate(virStorageVolDef *vol,
+                                     virStorageBackendProbeCache *cache)
 {
     int err;
 
@@ -3484,7 +3817,8 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol)
     vol->target.format = VIR_STORAGE_FILE_RAW;
 
     if ((err = storageBackendProbeTarget(&vol->target,
-                                         &vol->target.encryption)) < 0) {
+                                         &vol->target.encryption,
+                                         cache)) < 0) {
         if (err == -2) {
             return -2;
         } else if (err == -3) {
@@ -3519,9 +3853,27 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol)
 }
 
 
+/**
+ * virStorageBackendRefreshVolTargetUpdate:
+ * @vol: Volume def that needs updating
+ *
+ * Attempt to probe the volume in order to get more details.
+ *
+ * Returns 0 on success, -2 to ignore failure, -1 on failure
+ */
+int
+virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol)
+{
+    return storageBackendRefreshVolTargetUpdate(vol, NULL);
+}
+
+
 /**
  * Iterate over the pool's directory and enumerate all disk images
  * within it. This is non-recursive.
+ *
+ * Image metadata probed by the previous refresh of the pool is reused for
+ * volumes which were not modified since then.
  */
 int
 virStorageBackendRefreshLocal(virStoragePoolObj *pool)
@@ -3535,10 +3887,18 @@ virStorageBackendRefreshLocal(virStoragePoolObj *pool)
     g_autoptr(virStorageVolDef) vol = NULL;
     VIR_AUTOCLOSE fd = -1;
     g_autoptr(virStorageSource) target = NULL;
+    g_autoptr(GHashTable) prevcache = NULL;
+    g_autoptr(GHashTable) nextcache = NULL;
+    virStorageBackendProbeCache cache = { 0 };
 
     if (virDirOpen(&dir, def->target.path) < 0)
         return -1;
 
+    prevcache = virStorageBackendProbeCacheSteal(def->target.path);
+    nextcache = virHashNew(virStorageBackendProbeCacheEntryFree);
+    cache.prev = prevcache;
+    cache.next = nextcache;
+
     while ((direrr = virDirRead(dir, &ent, def->target.path)) > 0) {
         int err;
 
@@ -3557,7 +3917,7 @@ virStorageBackendRefreshLocal(virStoragePoolObj *pool)
 
         vol->key = g_strdup(vol->target.path);
 
-        if ((err = virStorageBackendRefreshVolTargetUpdate(vol)) < 0) {
+        if ((err = storageBackendRefreshVolTargetUpdate(vol, &cache)) < 0) {
             if (err == -2) {
                 /* Silently ignore non-regular files,
                  * eg 'lost+found', dangling symbolic link */
@@ -3574,6 +3934,9 @@ virStorageBackendRefreshLocal(virStoragePoolObj *pool)
     if (direrr < 0)
         return -1;
 
+    virStorageBackendProbeCacheStore(def->target.path,
+                                     g_steal_pointer(&nextcache));
+
     target = virStorageSourceNew();
 
     if ((fd = open(def->target.path, O_RDONLY)) < 0) {
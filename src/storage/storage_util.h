@@ -103,6 +103,8 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol);
 
 int virStorageBackendRefreshLocal(virStoragePoolObj *pool);
 
+void virStorageBackendProbeCacheDrop(const char *poolpath);
+
 int virStorageUtilGlusterExtractPoolSources(const char *host,
                                             const char *xml,
                                             virStoragePoolSourceList *list,
@@ -22,6 +22,7 @@
 #include <config.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "internal.h"
@@ -32,6 +33,7 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
 #include "virstoragefile.h"
@@ -1333,6 +1335,200 @@ virStorageSourceReportBrokenChain(int errcode,
 }
 
 
+/*
+ * Process wide cache of image headers of local backing files. Backing images
+ * are usually shared by many guests and are not modified while they are in
+ * use so there is no point in reading their headers again whenever a
+ * backing chain is detected. An entry is used only if the identity, size and
+ * timestamps of the file still match the ones recorded when the header was
+ * read.
+ */
+#define VIR_STORAGE_SOURCE_HEADER_CACHE_MAX 1024
+
+typedef struct _virStorageSourceHeaderCacheEntry virStorageSourceHeaderCacheEntry;
+struct _virStorageSourceHeaderCacheEntry {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+
+    char *buf;
+    size_t len;
+};
+
+static virMutex virStorageSourceHeaderCacheLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStorageSourceHeaderCache;
+
+
+static void
+virStorageSourceHeaderCacheEntryFree(void *opaque)
+{
+    virStorageSourceHeaderCacheEntry *entry = opaque;
+
+    if (!entry)
+        return;
+
+    g_free(entry->buf);
+    g_free(entry);
+}
+
+
+static void
+virStorageSourceHeaderCacheEntryFill(virStorageSourceHeaderCacheEntry *entry,
+                                     const struct stat *st)
+{
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+#ifdef __APPLE__
+    entry->mtime = st->st_mtimespec;
+    entry->ctime = st->st_ctimespec;
+#else
+    entry->mtime = st->st_mtim;
+    entry->ctime = st->st_ctim;
+#endif
+}
+
+
+static bool
+virStorageSourceHeaderCacheEntryMatch(const virStorageSourceHeaderCacheEntry *entry,
+                                      const struct stat *st)
+{
+    virStorageSourceHeaderCacheEntry tmp = { 0 };
+
+    virStorageSourceHeaderCacheEntryFill(&tmp, st);
+
+    return entry->dev == tmp.dev &&
+           entry->ino == tmp.ino &&
+           entry->size == tmp.size &&
+           entry->mtime.tv_sec == tmp.mtime.tv_sec &&
+           entry->mtime.tv_nsec == tmp.mtime.tv_nsec &&
+           entry->ctime.tv_sec == tmp.ctime.tv_sec &&
+           entry->ctime.tv_nsec == tmp.ctime.tv_nsec;
+}
+
+
+/**
+ * virStorageSourceHeaderCacheLookup:
+ * @key: user, group and path of the image
+ * @st: current stat data of the image
+ * @buf: filled with a copy of the cached header
+ *
+ * Returns the length of the cached header or -1 if there's no valid entry
+ * for @key.
+ */
+static ssize_t
+virStorageSourceHeaderCacheLookup(const char *key,
+                                  const struct stat *st,
+                                  char **buf)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virStorageSourceHeaderCacheLock);
+    virStorageSourceHeaderCacheEntry *entry;
+
+    if (!virStorageSourceHeaderCache ||
+        !(entry = g_hash_table_lookup(virStorageSourceHeaderCache, key)))
+        return -1;
+
+    if (!virStorageSourceHeaderCacheEntryMatch(entry, st)) {
+        g_hash_table_remove(virStorageSourceHeaderCache, key);
+        return -1;
+    }
+
+    *buf = g_malloc0(entry->len + 1);
+    memcpy(*buf, entry->buf, entry->len);
+
+    return entry->len;
+}
+
+
+static void
+virStorageSourceHeaderCacheStore(const char *key,
+                                 const struct stat *st,
+                                 const char *buf,
+                                 size_t len)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virStorageSourceHeaderCacheLock);
+    virStorageSourceHeaderCacheEntry *entry;
+
+    if (!virStorageSourceHeaderCache)
+        virStorageSourceHeaderCache = virHashNew(virStorageSourceHeaderCacheEntryFree);
+
+    /* Rather than tracking usage of the entries simply start over once the
+     * cache grows too large. */
+    if (g_hash_table_size(virStorageSourceHeaderCache) >= VIR_STORAGE_SOURCE_HEADER_CACHE_MAX)
+        g_hash_table_remove_all(virStorageSourceHeaderCache);
+
+    entry = g_new0(virStorageSourceHeaderCacheEntry, 1);
+    virStorageSourceHeaderCacheEntryFill(entry, st);
+    entry->buf = g_malloc0(len + 1);
+    memcpy(entry->buf, buf, len);
+    entry->len = len;
+
+    g_hash_table_insert(virStorageSourceHeaderCache, g_strdup(key), entry);
+}
+
+
+/**
+ * virStorageSourceGetMetadataRecurseReadHeaderCached:
+ *
+ * Reads the header of a backing image @src using the header cache. Only
+ * regular local files are cached as the timestamps of other kinds of storage
+ * don't reflect modification of their contents.
+ *
+ * Entries are kept separately for every @uid and @gid and are stored only
+ * after the file was found to be readable by them, so a cache hit does not
+ * need to check access again. That check forks a child process whenever
+ * @uid and @gid differ from the ones of the daemon. Changing the permissions
+ * of the file changes its ctime and thus invalidates the entry.
+ *
+ * Returns the length of the header, -1 on error with error reported and -2
+ * if @src is not eligible for caching or could not be accessed.
+ */
+static ssize_t
+virStorageSourceGetMetadataRecurseReadHeaderCached(virStorageSource *src,
+                                                   uid_t uid,
+                                                   gid_t gid,
+                                                   char **buf)
+{
+    g_autofree char *key = NULL;
+    struct stat st;
+    ssize_t len;
+
+    if (virStorageSourceGetActualType(src) != VIR_STORAGE_TYPE_FILE)
+        return -2;
+
+    if (virStorageSourceStat(src, &st) < 0 ||
+        !S_ISREG(st.st_mode))
+        return -2;
+
+    if (uid == (uid_t) -1)
+        uid = geteuid();
+    if (gid == (gid_t) -1)
+        gid = getegid();
+
+    key = g_strdup_printf("%u:%u:%s",
+                          (unsigned int) uid, (unsigned int) gid, src->path);
+
+    if ((len = virStorageSourceHeaderCacheLookup(key, &st, buf)) >= 0) {
+        VIR_DEBUG("using cached header of '%s'", src->path);
+        return len;
+    }
+
+    /* the image is not necessarily readable by the user we are probing as
+     * even if another user has read it before */
+    if (virStorageSourceAccess(src, R_OK) < 0)
+        return -2;
+
+    if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
+        return -1;
+
+    virStorageSourceHeaderCacheStore(key, &st, *buf, len);
+
+    return len;
+}
+
+
 static int
 virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
                                              virStorageSource *parent,
@@ -1342,7 +1538,7 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
                                              size_t *headerLen)
 {
     int ret = -1;
-    ssize_t len;
+    ssize_t len = -2;
 
     if (virStorageSourceIsFD(src)) {
         if (!src->fdtuple) {
@@ -1362,13 +1558,22 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
     if (virStorageSourceInitAs(src, uid, gid) < 0)
         return -1;
 
-    if (virStorageSourceAccess(src, F_OK) < 0) {
-        virStorageSourceReportBrokenChain(errno, src, parent);
+    /* The top image is likely to be written to, use the cache only for the
+     * backing images */
+    if (src != parent &&
+        (len = virStorageSourceGetMetadataRecurseReadHeaderCached(src, uid, gid,
+                                                                  buf)) == -1)
         goto cleanup;
-    }
 
-    if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
-        goto cleanup;
+    if (len == -2) {
+        if (virStorageSourceAccess(src, F_OK) < 0) {
+            virStorageSourceReportBrokenChain(errno, src, parent);
+            goto cleanup;
+        }
+
+        if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
+            goto cleanup;
+    }
 
     *headerLen = len;
     ret = 0;
@@ -41,6 +41,7 @@
 #include "virlog.h"
 #include "virfile.h"
 #include "virgdbus.h"
+#include "virhash.h"
 #include "virstring.h"
 #include "virsystemd.h"
 #include "virtypedparam.h"
@@ -53,6 +54,12 @@ VIR_LOG_INIT("util.cgroup");
 #define CGROUP_NB_TOTAL_CPU_STAT_PARAM 3
 #define CGROUP_NB_PER_CPU_STAT_PARAM   1
 
+#define VIR_CGROUP_MAX_CACHED_FDS 16
+#define VIR_CGROUP_MAX_CACHED_FDS_TOTAL 1024
+
+/* Number of fds cached by all groups, see virCgroupGetValueCached */
+static int virCgroupCachedFDs;
+
 VIR_ENUM_IMPL(virCgroupController,
               VIR_CGROUP_CONTROLLER_LAST,
               "cpu", "cpuacct", "cpuset", "memory", "devices",
@@ -576,6 +583,123 @@ virCgroupSetValueStr(virCgroup *group,
 }
 
 
+static void
+virCgroupFDFree(void *opaque)
+{
+    int fd = GPOINTER_TO_INT(opaque);
+
+    VIR_FORCE_CLOSE(fd);
+    g_atomic_int_add(&virCgroupCachedFDs, -1);
+}
+
+
+static int
+virCgroupFDOpenCached(const char *keypath)
+{
+    int fd;
+
+    if (g_atomic_int_add(&virCgroupCachedFDs, 1) >= VIR_CGROUP_MAX_CACHED_FDS_TOTAL) {
+        g_atomic_int_add(&virCgroupCachedFDs, -1);
+        return -1;
+    }
+
+    if ((fd = open(keypath, O_RDONLY | O_CLOEXEC)) < 0)
+        g_atomic_int_add(&virCgroupCachedFDs, -1);
+
+    return fd;
+}
+
+
+/**
+ * virCgroupGetValueCached:
+ * @group: the cgroup
+ * @keypath: path of the file to read
+ * @value: filled with the contents of the file
+ *
+ * Statistics are read from the same few files over and over again.
+ * Keep them open for the lifetime of @group and re-read them from
+ * the beginning, which saves opening and closing them each time.
+ *
+ * This costs up to VIR_CGROUP_MAX_CACHED_FDS file descriptors for every
+ * group which is kept around, e.g. the cgroup of each running domain, and
+ * no more than VIR_CGROUP_MAX_CACHED_FDS_TOTAL for all groups together so
+ * that hosts with many domains don't run out of file descriptors. Files
+ * beyond those limits are read the usual way.
+ *
+ * Returns 0 on success, 1 if the file should be read the usual way
+ * (without reporting an error) and -1 on error.
+ */
+static int
+virCgroupGetValueCached(virCgroup *group,
+                        const char *keypath,
+                        char **value)
+{
+    g_autofree char *buf = NULL;
+    size_t size = 0;
+    size_t len = 0;
+    gpointer fdptr;
+    int fd;
+    int ret = 1;
+
+    g_mutex_lock(&group->fdsLock);
+
+    if (!group->fds)
+        group->fds = virHashNew(virCgroupFDFree);
+
+    if (g_hash_table_lookup_extended(group->fds, keypath, NULL, &fdptr)) {
+        fd = GPOINTER_TO_INT(fdptr);
+    } else {
+        if (virHashSize(group->fds) >= VIR_CGROUP_MAX_CACHED_FDS ||
+            (fd = virCgroupFDOpenCached(keypath)) < 0)
+            goto cleanup;
+
+        g_hash_table_insert(group->fds, g_strdup(keypath), GINT_TO_POINTER(fd));
+    }
+
+    while (true) {
+        ssize_t got;
+
+        if (len > 1024 * 1024) {
+            virReportSystemError(EOVERFLOW,
+                                 _("Unable to read from '%1$s'"), keypath);
+            ret = -1;
+            goto cleanup;
+        }
+
+        if (size - len < 1024) {
+            size += 4096;
+            buf = g_realloc(buf, size);
+        }
+
+        if ((got = pread(fd, buf + len, size - len - 1, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            /* e.g. the cgroup was removed, retry with a fresh fd */
+            g_hash_table_remove(group->fds, keypath);
+            goto cleanup;
+        }
+
+        if (got == 0)
+            break;
+
+        len += got;
+    }
+
+    buf[len] = '\0';
+
+    /* Terminated with '\n' has sometimes harmful effects to the caller */
+    if (len > 0 && buf[len - 1] == '\n')
+        buf[len - 1] = '\0';
+
+    *value = g_steal_pointer(&buf);
+    ret = 0;
+
+ cleanup:
+    g_mutex_unlock(&group->fdsLock);
+    return ret;
+}
+
+
 int
 virCgroupGetValueStr(virCgroup *group,
                      int controller,
@@ -583,10 +707,14 @@ virCgroupGetValueStr(virCgroup *group,
                      char **value)
 {
     g_autofree char *keypath = NULL;
+    int rc;
 
     if (virCgroupPathOfController(group, controller, key, &keypath) < 0)
         return -1;
 
+    if ((rc = virCgroupGetValueCached(group, keypath, value)) <= 0)
+        return rc;
+
     return virCgroupGetValueRaw(keypath, value);
 }
 
@@ -615,6 +743,52 @@ virCgroupGetValueForBlkDev(const char *str,
 }
 
 
+/**
+ * virCgroupParseNumaStatNodes:
+ * @str: per-node part of a line of memory.numa_stat ("N0=123 N1=456")
+ * @values: array of values indexed by node id
+ * @nvalues: number of items in @values
+ *
+ * Adds values of all nodes from @str to @values, growing the array if
+ * needed.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virCgroupParseNumaStatNodes(const char *str,
+                            unsigned long long **values,
+                            size_t *nvalues)
+{
+    g_auto(GStrv) tokens = g_strsplit(str, " ", -1);
+    GStrv tmp;
+
+    for (tmp = tokens; *tmp; tmp++) {
+        const char *node;
+        char *end;
+        unsigned int id;
+        unsigned long long value;
+
+        if (!(node = STRSKIP(*tmp, "N")))
+            continue;
+
+        if (virStrToLong_ui(node, &end, 10, &id) < 0 || *end != '=' ||
+            virStrToLong_ull(end + 1, NULL, 10, &value) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Cannot parse '%1$s' from 'memory.numa_stat' cgroup file"),
+                           *tmp);
+            return -1;
+        }
+
+        if (id >= *nvalues)
+            VIR_EXPAND_N(*values, *nvalues, id + 1 - *nvalues);
+
+        (*values)[id] += value;
+    }
+
+    return 0;
+}
+
+
 int
 virCgroupSetValueU64(virCgroup *group,
                      int controller,
@@ -724,6 +898,17 @@ virCgroupExists(virCgroup *group)
 }
 
 
+static virCgroup *
+virCgroupAlloc(void)
+{
+    virCgroup *group = g_new0(virCgroup, 1);
+
+    g_mutex_init(&group->fdsLock);
+
+    return group;
+}
+
+
 /**
  * virCgroupNew:
  * @path: path for the new group
@@ -744,7 +929,7 @@ virCgroupNew(const char *path,
               path, controllers, group);
 
     *group = NULL;
-    newGroup = g_new0(virCgroup, 1);
+    newGroup = virCgroupAlloc();
 
     if (virCgroupSetBackends(newGroup) < 0)
         return -1;
@@ -890,7 +1075,7 @@ virCgroupNewFromParent(virCgroup *parent,
                        int controllers,
                        virCgroup **group)
 {
-    g_autoptr(virCgroup) new = g_new0(virCgroup, 1);
+    g_autoptr(virCgroup) new = virCgroupAlloc();
 
     VIR_DEBUG("parent=%p path=%s controllers=%d group=%p",
               parent, path, controllers, group);
@@ -1151,7 +1336,7 @@ virCgroupNewDetect(pid_t pid,
                    int controllers,
                    virCgroup **group)
 {
-    g_autoptr(virCgroup) new = g_new0(virCgroup, 1);
+    g_autoptr(virCgroup) new = virCgroupAlloc();
 
     VIR_DEBUG("pid=%lld controllers=%d group=%p",
               (long long) pid, controllers, group);
@@ -1845,6 +2030,30 @@ virCgroupGetMemoryStat(virCgroup *group,
 }
 
 
+/**
+ * virCgroupGetMemoryNumaStat:
+ *
+ * @group: The cgroup to get memory statistics for
+ * @nodes: array of anonymous memory in KiB indexed by host NUMA node
+ * @nnodes: number of items in @nodes
+ *
+ * Reports how the anonymous (and shared, where the kernel accounts it per
+ * node) memory of @group is spread across host NUMA nodes.
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int
+virCgroupGetMemoryNumaStat(virCgroup *group,
+                           unsigned long long **nodes,
+                           size_t *nnodes)
+{
+    virCgroup *parent = virCgroupGetNested(group);
+
+    VIR_CGROUP_BACKEND_CALL(parent, VIR_CGROUP_CONTROLLER_MEMORY,
+                            getMemoryNumaStat, -1, nodes, nnodes);
+}
+
+
 /**
  * virCgroupGetMemoryUsage:
  *
@@ -3381,6 +3590,17 @@ virCgroupGetMemoryStat(virCgroup *group G_GNUC_UNUSED,
 }
 
 
+int
+virCgroupGetMemoryNumaStat(virCgroup *group G_GNUC_UNUSED,
+                           unsigned long long **nodes G_GNUC_UNUSED,
+                           size_t *nnodes G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return -1;
+}
+
+
 int
 virCgroupGetMemoryUsage(virCgroup *group G_GNUC_UNUSED,
                         unsigned long *kb G_GNUC_UNUSED)
@@ -3830,6 +4050,9 @@ virCgroupFree(virCgroup *group)
     g_free(group->unified.placement);
     g_free(group->unitName);
 
+    g_clear_pointer(&group->fds, g_hash_table_unref);
+    g_mutex_clear(&group->fdsLock);
+
     virCgroupFree(group->nested);
 
     g_free(group);
@@ -167,6 +167,9 @@ int virCgroupGetMemoryStat(virCgroup *group,
                            unsigned long long *activeFile,
                            unsigned long long *inactiveFile,
                            unsigned long long *unevictable);
+int virCgroupGetMemoryNumaStat(virCgroup *group,
+                               unsigned long long **nodes,
+                               size_t *nnodes);
 int virCgroupGetMemoryUsage(virCgroup *group, unsigned long *kb);
 
 int virCgroupSetMemoryHardLimit(virCgroup *group, unsigned long long kb);
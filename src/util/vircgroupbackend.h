@@ -244,6 +244,11 @@ typedef int
                             unsigned long long *inactiveFile,
                             unsigned long long *unevictable);
 
+typedef int
+(*virCgroupGetMemoryNumaStatCB)(virCgroup *group,
+                                unsigned long long **nodes,
+                                size_t *nnodes);
+
 typedef int
 (*virCgroupGetMemoryUsageCB)(virCgroup *group,
                              unsigned long *kb);
@@ -413,6 +418,7 @@ struct _virCgroupBackend {
 
     virCgroupSetMemoryCB setMemory;
     virCgroupGetMemoryStatCB getMemoryStat;
+    virCgroupGetMemoryNumaStatCB getMemoryNumaStat;
     virCgroupGetMemoryUsageCB getMemoryUsage;
     virCgroupSetMemoryHardLimitCB setMemoryHardLimit;
     virCgroupGetMemoryHardLimitCB getMemoryHardLimit;
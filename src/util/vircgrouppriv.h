@@ -64,6 +64,10 @@ struct _virCgroup {
 
     char *unitName;
     virCgroup *nested;
+
+    /* files kept open for reading values, keyed by path */
+    GMutex fdsLock;
+    GHashTable *fds;
 };
 
 #define virCgroupGetNested(cgroup) \
@@ -117,6 +121,10 @@ int virCgroupGetValueForBlkDev(const char *str,
                                const char *devPath,
                                char **value);
 
+int virCgroupParseNumaStatNodes(const char *str,
+                                unsigned long long **values,
+                                size_t *nvalues);
+
 int virCgroupNewPartition(const char *path,
                           bool create,
                           int controllers,
@@ -42,6 +42,7 @@
 #include "virerror.h"
 #include "viralloc.h"
 #include "virthread.h"
+#include "virutil.h"
 
 VIR_LOG_INIT("util.cgroup");
 
@@ -1630,6 +1631,49 @@ virCgroupV1GetMemoryStat(virCgroup *group,
 }
 
 
+static int
+virCgroupV1GetMemoryNumaStat(virCgroup *group,
+                             unsigned long long **nodes,
+                             size_t *nnodes)
+{
+    g_autofree char *stat = NULL;
+    g_auto(GStrv) lines = NULL;
+    g_autofree unsigned long long *values = NULL;
+    size_t nvalues = 0;
+    unsigned long long pageSizeKB = virGetSystemPageSizeKB();
+    GStrv tmp;
+    size_t i;
+
+    if (virCgroupGetValueStr(group,
+                             VIR_CGROUP_CONTROLLER_MEMORY,
+                             "memory.numa_stat",
+                             &stat) < 0) {
+        return -1;
+    }
+
+    lines = g_strsplit(stat, "\n", -1);
+
+    /* "anon=<total> N0=<pages> N1=<pages> ..." */
+    for (tmp = lines; *tmp; tmp++) {
+        const char *value;
+
+        if (!(value = STRSKIP(*tmp, "anon=")))
+            continue;
+
+        if (virCgroupParseNumaStatNodes(value, &values, &nvalues) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < nvalues; i++)
+        values[i] *= pageSizeKB;
+
+    *nodes = g_steal_pointer(&values);
+    *nnodes = nvalues;
+
+    return 0;
+}
+
+
 static int
 virCgroupV1GetMemoryUsage(virCgroup *group,
                           unsigned long *kb)
@@ -2180,6 +2224,7 @@ virCgroupBackend virCgroupV1Backend = {
 
     .setMemory = virCgroupV1SetMemory,
     .getMemoryStat = virCgroupV1GetMemoryStat,
+    .getMemoryNumaStat = virCgroupV1GetMemoryNumaStat,
     .getMemoryUsage = virCgroupV1GetMemoryUsage,
     .setMemoryHardLimit = virCgroupV1SetMemoryHardLimit,
     .getMemoryHardLimit = virCgroupV1GetMemoryHardLimit,
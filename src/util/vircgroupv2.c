@@ -1306,6 +1306,50 @@ virCgroupV2GetMemoryStat(virCgroup *group,
 }
 
 
+static int
+virCgroupV2GetMemoryNumaStat(virCgroup *group,
+                             unsigned long long **nodes,
+                             size_t *nnodes)
+{
+    g_autofree char *stat = NULL;
+    g_auto(GStrv) lines = NULL;
+    g_autofree unsigned long long *values = NULL;
+    size_t nvalues = 0;
+    GStrv tmp;
+    size_t i;
+
+    if (virCgroupGetValueStr(group,
+                             VIR_CGROUP_CONTROLLER_MEMORY,
+                             "memory.numa_stat",
+                             &stat) < 0) {
+        return -1;
+    }
+
+    lines = g_strsplit(stat, "\n", -1);
+
+    /* "anon N0=<bytes> N1=<bytes> ...", guest memory backed by memfd or
+     * shared memory is accounted as "shmem" */
+    for (tmp = lines; *tmp; tmp++) {
+        const char *value;
+
+        if (!(value = STRSKIP(*tmp, "anon ")) &&
+            !(value = STRSKIP(*tmp, "shmem ")))
+            continue;
+
+        if (virCgroupParseNumaStatNodes(value, &values, &nvalues) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < nvalues; i++)
+        values[i] >>= 10;
+
+    *nodes = g_steal_pointer(&values);
+    *nnodes = nvalues;
+
+    return 0;
+}
+
+
 static int
 virCgroupV2GetMemoryUsage(virCgroup *group,
                           unsigned long *kb)
@@ -1944,6 +1988,7 @@ virCgroupBackend virCgroupV2Backend = {
 
     .setMemory = virCgroupV2SetMemory,
     .getMemoryStat = virCgroupV2GetMemoryStat,
+    .getMemoryNumaStat = virCgroupV2GetMemoryNumaStat,
     .getMemoryUsage = virCgroupV2GetMemoryUsage,
     .setMemoryHardLimit = virCgroupV2SetMemoryHardLimit,
     .getMemoryHardLimit = virCgroupV2GetMemoryHardLimit,
@@ -47,6 +47,10 @@ struct _virFileCache {
 
     GHashTable *table;
 
+    /* names of data being created with the cache unlocked */
+    GHashTable *pending;
+    virCond pendingCond;
+
     char *dir;
     char *suffix;
 
@@ -76,6 +80,8 @@ virFileCacheDispose(void *obj)
     g_free(cache->suffix);
 
     g_clear_pointer(&cache->table, g_hash_table_unref);
+    g_clear_pointer(&cache->pending, g_hash_table_unref);
+    virCondDestroy(&cache->pendingCond);
 
     virFileCachePrivFree(cache);
 }
@@ -192,6 +198,19 @@ virFileCacheSave(virFileCache *cache,
 }
 
 
+/**
+ * virFileCacheNewData:
+ * @cache: existing cache object, locked
+ * @name: name of the new data
+ *
+ * Loads the data from a file or creates new data and stores it in the cache.
+ * Creating new data can take a long time (e.g., QEMU capabilities probing)
+ * and thus it is done with @cache unlocked to allow data with a different
+ * name to be created or looked up in parallel. Concurrent requests for the
+ * same @name wait for the result instead of creating it again.
+ *
+ * Returns data object or NULL on error.
+ */
 static void *
 virFileCacheNewData(virFileCache *cache,
                     const char *name)
@@ -199,16 +218,35 @@ virFileCacheNewData(virFileCache *cache,
     void *data = NULL;
     int rv;
 
+    while (virHashHasEntry(cache->pending, name)) {
+        VIR_DEBUG("Waiting for data for '%s' created by another thread", name);
+        ignore_value(virCondWait(&cache->pendingCond, &cache->parent.lock));
+
+        if ((data = virHashLookup(cache->table, name)))
+            return data;
+    }
+
     if ((rv = virFileCacheLoad(cache, name, &data)) < 0)
         return NULL;
 
     if (rv == 0) {
-        if (!(data = cache->handlers.newData(name, cache->priv)))
+        if (virHashAddEntry(cache->pending, name, NULL) < 0)
             return NULL;
 
-        if (virFileCacheSave(cache, name, data) < 0) {
+        virObjectUnlock(cache);
+        data = cache->handlers.newData(name, cache->priv);
+        virObjectLock(cache);
+
+        if (data && virFileCacheSave(cache, name, data) < 0)
             g_clear_object(&data);
-        }
+    }
+
+    if (data && virHashUpdateEntry(cache->table, name, data) < 0)
+        g_clear_pointer(&data, g_object_unref);
+
+    if (rv == 0) {
+        virHashRemoveEntry(cache->pending, name);
+        virCondBroadcast(&cache->pendingCond);
     }
 
     return data;
@@ -240,6 +278,13 @@ virFileCacheNew(const char *dir,
         return NULL;
 
     cache->table = virHashNew(g_object_unref);
+    cache->pending = virHashNew(NULL);
+
+    if (virCondInit(&cache->pendingCond) < 0) {
+        virReportSystemError(errno, "%s", _("unable to initialize condition"));
+        virObjectUnref(cache);
+        return NULL;
+    }
 
     cache->dir = g_strdup(dir);
 
@@ -266,13 +311,8 @@ virFileCacheValidate(virFileCache *cache,
 
     if (!*data && name) {
         VIR_DEBUG("Creating data for '%s'", name);
-        *data = virFileCacheNewData(cache, name);
-        if (*data) {
+        if ((*data = virFileCacheNewData(cache, name)))
             VIR_DEBUG("Caching data '%p' for '%s'", *data, name);
-            if (virHashAddEntry(cache->table, name, *data) < 0) {
-                g_clear_pointer(data, g_object_unref);
-            }
-        }
     }
 }
 
@@ -368,6 +408,8 @@ virFileCacheGetPriv(virFileCache *cache)
  *
  * Sets private data used by @handlers.  If there is already some @priv
  * set, privFree() will be called on the old @priv before setting a new one.
+ * Waits for newData() handlers running with @cache unlocked to finish as
+ * they still use the old @priv, thus it must not be called from a handler.
  */
 void
 virFileCacheSetPriv(virFileCache *cache,
@@ -375,6 +417,9 @@ virFileCacheSetPriv(virFileCache *cache,
 {
     virObjectLock(cache);
 
+    while (virHashSize(cache->pending) > 0)
+        ignore_value(virCondWait(&cache->pendingCond, &cache->parent.lock));
+
     virFileCachePrivFree(cache);
 
     cache->priv = priv;
@@ -31,6 +31,10 @@
 #include "virfile.h"
 #include "virthread.h"
 
+#if WITH_LIBNFTABLES
+# include <nftables/libnftables.h>
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_FIREWALL
 
 VIR_LOG_INIT("util.firewall");
@@ -661,6 +665,214 @@ virFirewallCmdIptablesApply(virFirewall *firewall,
 #define VIR_NFTABLES_ARG_IS_CREATE(arg) \
     (STREQ(arg, "insert") || STREQ(arg, "add") || STREQ(arg, "create"))
 
+
+/**
+ * virFirewallNftablesUseLibrary:
+ *
+ * Returns true if nftables commands are to be executed through
+ * libnftables within this process instead of spawning nft.
+ */
+bool
+virFirewallNftablesUseLibrary(void)
+{
+#if WITH_LIBNFTABLES
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+#if WITH_LIBNFTABLES
+/* Reused across commands, protected by fwCmdLock */
+static struct nft_ctx *nftCtx;
+
+static int
+virFirewallNftablesRunLibrary(const char *text,
+                              bool echo,
+                              char **output,
+                              char **error,
+                              int *status)
+{
+    if (!nftCtx) {
+        if (!(nftCtx = nft_ctx_new(NFT_CTX_DEFAULT)) ||
+            nft_ctx_buffer_output(nftCtx) < 0 ||
+            nft_ctx_buffer_error(nftCtx) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to initialize nftables context"));
+            g_clear_pointer(&nftCtx, nft_ctx_free);
+            return -1;
+        }
+    }
+
+    nft_ctx_output_set_flags(nftCtx,
+                             echo ? NFT_CTX_OUTPUT_ECHO | NFT_CTX_OUTPUT_HANDLE : 0);
+
+    *status = nft_run_cmd_from_buffer(nftCtx, text) < 0 ? 1 : 0;
+
+    /* getting the buffers also resets them for the next command */
+    *output = g_strdup(nft_ctx_get_output_buffer(nftCtx));
+    *error = g_strdup(nft_ctx_get_error_buffer(nftCtx));
+    return 0;
+}
+#endif /* WITH_LIBNFTABLES */
+
+
+/**
+ * virFirewallNftablesRun:
+ * @fwCmds: nft commands to run
+ * @ncmds: number of commands in @fwCmds
+ * @echo: whether nft should echo the created objects with their handles
+ * @cmdStr: filled with the string form of the command for reporting
+ * @output: filled with stdout of nft
+ * @error: filled with stderr of nft
+ * @status: filled with the exit status of nft
+ *
+ * Run @fwCmds as one nft invocation, separated by ';'. Unless some
+ * command starts with an option, this is done in-process if the
+ * library is available.
+ *
+ * Returns 0 if the commands were run (regardless of their status),
+ * -1 on error.
+ */
+static int
+virFirewallNftablesRun(virFirewallCmd **fwCmds,
+                       size_t ncmds,
+                       bool echo,
+                       char **cmdStr,
+                       char **output,
+                       char **error,
+                       int *status)
+{
+    g_autoptr(virCommand) cmd = virCommandNew(NFT);
+    size_t i;
+    size_t j;
+
+    if (echo)
+        virCommandAddArg(cmd, "-ae");
+
+    for (i = 0; i < ncmds; i++) {
+        if (i > 0)
+            virCommandAddArg(cmd, ";");
+        for (j = 0; j < fwCmds[i]->argsLen; j++)
+            virCommandAddArg(cmd, fwCmds[i]->args[j]);
+    }
+
+    *cmdStr = virCommandToString(cmd, false);
+    VIR_INFO("Applying '%s'", NULLSTR(*cmdStr));
+
+#if WITH_LIBNFTABLES
+    if (virFirewallNftablesUseLibrary()) {
+        g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+
+        /* nft itself joins its arguments with spaces, too. Options
+         * can't be passed that way though. */
+        for (i = 0; i < ncmds; i++) {
+            if (fwCmds[i]->args[0][0] == '-')
+                break;
+            if (i > 0)
+                virBufferAddLit(&buf, " ; ");
+            for (j = 0; j < fwCmds[i]->argsLen; j++) {
+                if (j > 0)
+                    virBufferAddChar(&buf, ' ');
+                virBufferAdd(&buf, fwCmds[i]->args[j], -1);
+            }
+        }
+
+        if (i == ncmds)
+            return virFirewallNftablesRunLibrary(virBufferCurrentContent(&buf),
+                                                 echo, output, error, status);
+    }
+#endif /* WITH_LIBNFTABLES */
+
+    virCommandSetOutputBuffer(cmd, output);
+    virCommandSetErrorBuffer(cmd, error);
+
+    return virCommandRun(cmd, status);
+}
+
+
+/**
+ * virFirewallCmdNftablesAddRollback:
+ * @firewall: the firewall
+ * @fwCmd: nft command which created a table, chain or rule
+ * @cmdIdx: index of the command verb in arguments of @fwCmd
+ * @cmdStr: string form of the executed command, for error reporting
+ * @output: stdout of the executed nft command, starting at the
+ *          output relevant for @fwCmd
+ *
+ * Record a rollback command deleting the object created by @fwCmd,
+ * using the handle reported in @output.
+ *
+ * Returns true on success, false on error.
+ */
+static bool
+virFirewallCmdNftablesAddRollback(virFirewall *firewall,
+                                  virFirewallCmd *fwCmd,
+                                  size_t cmdIdx,
+                                  const char *cmdStr,
+                                  const char *output)
+{
+    const char *objectType = fwCmd->args[cmdIdx + 1];
+    virFirewallCmd *rollback;
+    const char *handleStart = NULL;
+    size_t handleLen = 0;
+    g_autofree char *handleStr = NULL;
+    g_autofree char *rollbackStr = NULL;
+
+    /* Search for "# handle n" in stdout of the nft add command -
+     * that is the handle of the table/rule/chain that will later
+     * need to be deleted.
+     */
+
+    if (output && (handleStart = strstr(output, "# handle "))) {
+        handleStart += 9; /* move past "# handle " */
+        handleLen = strspn(handleStart, "0123456789");
+    }
+
+    if (!handleLen) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("couldn't register rollback command - command '%1$s' had no valid handle in output ('%2$s')"),
+                       NULLSTR(cmdStr), NULLSTR(output));
+        return false;
+    }
+
+    handleStr = g_strdup_printf("%.*s", (int)handleLen, handleStart);
+
+    /* The rollback command is created from the original command like this:
+     *
+     * 1) skip any leading options
+     * 2) replace add/insert with delete
+     * 3) keep the type of item being added (rule/chain/table)
+     * 4) keep the class (ip/ip6/inet)
+     * 5) for chain/rule, keep the table name
+     * 6) for rule, keep the chain name
+     * 7) add "handle n" where "n" is parsed from the
+     *    stdout of the original nft command
+     */
+    rollback = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
+    virFirewallCmdAddArgList(firewall, rollback, "delete", objectType,
+                             fwCmd->args[cmdIdx + 2], /* ip/ip6/inet */
+                             NULL);
+
+    if (STREQ_NULLABLE(objectType, "rule") ||
+        STREQ_NULLABLE(objectType, "chain")) {
+        /* include table name in command */
+        virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 3]);
+    }
+
+    if (STREQ_NULLABLE(objectType, "rule")) {
+        /* include chain name in command */
+        virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 4]);
+    }
+
+    virFirewallCmdAddArgList(firewall, rollback, "handle", handleStr, NULL);
+
+    rollbackStr = virFirewallCmdToString(NFT, rollback);
+    VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
+    return true;
+}
+
 static int
 virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
                             virFirewallCmd *fwCmd,
@@ -684,9 +896,19 @@ virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
 
         /* NB: RAW commands don't support auto-rollback command creation */
 
-    } else {
+        for (i = 0; i < fwCmd->argsLen; i++)
+            virCommandAddArg(cmd, fwCmd->args[i]);
+
+        cmdStr = virCommandToString(cmd, false);
+        VIR_INFO("Applying '%s'", NULLSTR(cmdStr));
 
-        cmd = virCommandNew(NFT);
+        virCommandSetOutputBuffer(cmd, output);
+        virCommandSetErrorBuffer(cmd, &error);
+
+        if (virCommandRun(cmd, &status) < 0)
+            return -1;
+
+    } else {
 
         if ((virFirewallTransactionGetFlags(firewall) & VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK) &&
             fwCmd->argsLen > 1) {
@@ -712,29 +934,19 @@ virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
                     STREQ_NULLABLE(objectType, "chain") ||
                     STREQ_NULLABLE(objectType, "table")) {
 
-                    needRollback = true;
-                    /* this option to nft instructs it to add the
-                     * "handle" of the created object to stdout
+                    /* nft is asked to add the "handle" of the
+                     * created object to stdout
                      */
-                    virCommandAddArg(cmd, "-ae");
+                    needRollback = true;
                 }
             }
         }
 
+        if (virFirewallNftablesRun(&fwCmd, 1, needRollback,
+                                   &cmdStr, output, &error, &status) < 0)
+            return -1;
     }
 
-    for (i = 0; i < fwCmd->argsLen; i++)
-        virCommandAddArg(cmd, fwCmd->args[i]);
-
-    cmdStr = virCommandToString(cmd, false);
-    VIR_INFO("Applying '%s'", NULLSTR(cmdStr));
-
-    virCommandSetOutputBuffer(cmd, output);
-    virCommandSetErrorBuffer(cmd, &error);
-
-    if (virCommandRun(cmd, &status) < 0)
-        return -1;
-
     if (status != 0) {
         if (STREQ_NULLABLE(fwCmd->args[0], "list")) {
             /* nft returns error status when the target of a "list"
@@ -757,63 +969,104 @@ virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
         return 0;
     }
 
-    if (needRollback) {
-        virFirewallCmd *rollback = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
-        const char *handleStart = NULL;
-        size_t handleLen = 0;
-        g_autofree char *handleStr = NULL;
-        g_autofree char *rollbackStr = NULL;
+    if (needRollback &&
+        !virFirewallCmdNftablesAddRollback(firewall, fwCmd, cmdIdx,
+                                           cmdStr, *output))
+        return -1;
 
-        /* Search for "# handle n" in stdout of the nft add command -
-         * that is the handle of the table/rule/chain that will later
-         * need to be deleted.
-         */
+    return 0;
+}
 
-        if ((handleStart = strstr(*output, "# handle "))) {
-            handleStart += 9; /* move past "# handle " */
-            handleLen = strspn(handleStart, "0123456789");
-        }
 
-        if (!handleLen) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("couldn't register rollback command - command '%1$s' had no valid handle in output ('%2$s')"),
-                           NULLSTR(cmdStr), NULLSTR(*output));
-            return -1;
-        }
+/* Returns true if @fwCmd can be applied as a part of one nft invocation
+ * with other commands of the current transaction. Commands whose result
+ * is needed on their own (queries, commands with ignored errors) can't.
+ * With auto-rollback, only creation of objects we know how to roll back
+ * can, since the handles echoed by nft are matched to commands by their
+ * order. */
+static bool
+virFirewallCmdNftablesCanBatch(virFirewall *firewall,
+                               virFirewallCmd *fwCmd)
+{
+    if (fwCmd->layer == VIR_FIREWALL_LAYER_TC ||
+        fwCmd->queryCB ||
+        fwCmd->ignoreErrors ||
+        fwCmd->argsLen < 2 ||
+        fwCmd->args[0][0] == '-' ||
+        STREQ(fwCmd->args[0], "list"))
+        return false;
+
+    if (!(virFirewallTransactionGetFlags(firewall) & VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK))
+        return true;
+
+    if (!VIR_NFTABLES_ARG_IS_CREATE(fwCmd->args[0]))
+        return false;
+
+    /* family, table, chain names are needed for the rollback */
+    if (STREQ(fwCmd->args[1], "rule"))
+        return fwCmd->argsLen > 4;
+    if (STREQ(fwCmd->args[1], "chain"))
+        return fwCmd->argsLen > 3;
+    if (STREQ(fwCmd->args[1], "table"))
+        return fwCmd->argsLen > 2;
+
+    return false;
+}
 
-        handleStr = g_strdup_printf("%.*s", (int)handleLen, handleStart);
-
-        /* The rollback command is created from the original command like this:
-         *
-         * 1) skip any leading options
-         * 2) replace add/insert with delete
-         * 3) keep the type of item being added (rule/chain/table)
-         * 4) keep the class (ip/ip6/inet)
-         * 5) for chain/rule, keep the table name
-         * 6) for rule, keep the chain name
-         * 7) add "handle n" where "n" is parsed from the
-         *    stdout of the original nft command
-         */
-        virFirewallCmdAddArgList(firewall, rollback, "delete", objectType,
-                                 fwCmd->args[cmdIdx + 2], /* ip/ip6/inet */
-                                 NULL);
-
-        if (STREQ_NULLABLE(objectType, "rule") ||
-            STREQ_NULLABLE(objectType, "chain")) {
-            /* include table name in command */
-            virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 3]);
-        }
 
-        if (STREQ_NULLABLE(objectType, "rule")) {
-            /* include chain name in command */
-            virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 4]);
-        }
+/**
+ * virFirewallCmdNftablesBatchApply:
+ * @firewall: the firewall
+ * @fwCmds: commands to apply
+ * @ncmds: number of commands in @fwCmds
+ *
+ * Apply all of @fwCmds with a single nft invocation, separating the
+ * individual commands by ';'. nft applies them as one transaction,
+ * so either all or none of them take effect. All of @fwCmds must
+ * satisfy virFirewallCmdNftablesCanBatch().
+ *
+ * Returns 0 on success, -1 on error (with nothing applied).
+ */
+static int
+virFirewallCmdNftablesBatchApply(virFirewall *firewall,
+                                 virFirewallCmd **fwCmds,
+                                 size_t ncmds)
+{
+    bool needRollback = (virFirewallTransactionGetFlags(firewall) &
+                         VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK);
+    g_autofree char *cmdStr = NULL;
+    g_autofree char *output = NULL;
+    g_autofree char *error = NULL;
+    const char *cur;
+    size_t i;
+    int status;
 
-        virFirewallCmdAddArgList(firewall, rollback, "handle", handleStr, NULL);
+    VIR_DEBUG("Applying batch of %zu commands", ncmds);
 
-        rollbackStr = virFirewallCmdToString(NFT, rollback);
-        VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
+    if (virFirewallNftablesRun(fwCmds, ncmds, needRollback,
+                               &cmdStr, &output, &error, &status) < 0)
+        return -1;
+
+    if (status != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Failed to apply firewall command '%1$s': %2$s"),
+                       NULLSTR(cmdStr), NULLSTR(error));
+        return -1;
+    }
+
+    if (!needRollback)
+        return 0;
+
+    /* nft echoes the created objects in the order of the commands */
+    cur = output;
+    for (i = 0; i < ncmds; i++) {
+        if (!virFirewallCmdNftablesAddRollback(firewall, fwCmds[i], 0,
+                                               cmdStr, cur))
+            return -1;
+
+        cur = strstr(cur, "# handle ") + 9;
     }
+
     return 0;
 }
 
@@ -886,6 +1139,23 @@ virFirewallApplyGroup(virFirewall *firewall,
     firewall->currentGroup = idx;
     group->addingRollback = false;
     for (i = 0; i < group->naction; i++) {
+        if ((group->actionFlags & VIR_FIREWALL_TRANSACTION_BATCH) &&
+            virFirewallGetBackend(firewall) == VIR_FIREWALL_BACKEND_NFTABLES) {
+            size_t n = 0;
+
+            while (i + n < group->naction &&
+                   virFirewallCmdNftablesCanBatch(firewall, group->action[i + n]))
+                n++;
+
+            if (n > 1) {
+                if (virFirewallCmdNftablesBatchApply(firewall,
+                                                     group->action + i, n) < 0)
+                    return -1;
+                i += n - 1;
+                continue;
+            }
+        }
+
         if (virFirewallApplyCmd(firewall, group->action[i]) < 0)
             return -1;
     }
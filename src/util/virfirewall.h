@@ -127,6 +127,9 @@ typedef enum {
     VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS = (1 << 0),
     /* Set to auto-add a rollback rule for each rule that is applied */
     VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK = (1 << 1),
+    /* Apply runs of consecutive rules with a single, atomic,
+     * invocation of the firewall tool where the backend allows it */
+    VIR_FIREWALL_TRANSACTION_BATCH = (1 << 2),
 } virFirewallTransactionFlags;
 
 void virFirewallStartTransaction(virFirewall *firewall,
@@ -143,6 +146,8 @@ void virFirewallStartRollback(virFirewall *firewall,
 
 int virFirewallApply(virFirewall *firewall);
 
+bool virFirewallNftablesUseLibrary(void) ATTRIBUTE_MOCKABLE;
+
 int virFirewallParseXML(virFirewall **firewall,
                         xmlNodePtr node,
                         xmlXPathContextPtr ctxt);
@@ -0,0 +1,162 @@
+/*
+ * virperiodicworker.c: thread running a function periodically
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "virperiodicworker.h"
+#include "virerror.h"
+#include "virlog.h"
+#include "virthread.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_THREAD
+
+VIR_LOG_INIT("util.periodicworker");
+
+struct _virPeriodicWorker {
+    char *name;
+    unsigned long long period; /* in ms */
+    virPeriodicWorkerFunc func;
+    void *opaque;
+
+    virThread thread;
+    virMutex lock;
+    virCond cond;
+    bool quit;
+};
+
+
+static void
+virPeriodicWorkerThread(void *opaque)
+{
+    virPeriodicWorker *worker = opaque;
+    unsigned long long deadline = 0;
+    unsigned long long now = 0;
+
+    virMutexLock(&worker->lock);
+
+    if (virTimeMillisNow(&deadline) < 0)
+        goto cleanup;
+    deadline += worker->period;
+
+    while (!worker->quit) {
+        if (virCondWaitUntil(&worker->cond, &worker->lock, deadline) < 0 &&
+            errno != ETIMEDOUT) {
+            VIR_WARN("Unable to wait for next period of '%s'", worker->name);
+            break;
+        }
+
+        if (worker->quit)
+            break;
+
+        if (virTimeMillisNow(&now) < 0)
+            break;
+
+        /* spurious wakeup */
+        if (now < deadline)
+            continue;
+
+        deadline = now + worker->period;
+
+        virMutexUnlock(&worker->lock);
+        worker->func(now, worker->opaque);
+        virMutexLock(&worker->lock);
+    }
+
+ cleanup:
+    virMutexUnlock(&worker->lock);
+}
+
+
+/**
+ * virPeriodicWorkerNew:
+ * @name: name of the thread
+ * @period: period in ms
+ * @func: function to call
+ * @opaque: data passed to @func
+ *
+ * Starts a thread which calls @func every @period until the worker is freed.
+ * The first call happens one @period after the worker is started. Calls of
+ * @func never overlap; if @func takes longer than @period the next call
+ * happens one @period after it returned.
+ *
+ * Returns the worker or NULL on error.
+ */
+virPeriodicWorker *
+virPeriodicWorkerNew(const char *name,
+                     unsigned long long period,
+                     virPeriodicWorkerFunc func,
+                     void *opaque)
+{
+    g_autofree virPeriodicWorker *worker = g_new0(virPeriodicWorker, 1);
+
+    worker->period = period;
+    worker->func = func;
+    worker->opaque = opaque;
+
+    if (virMutexInit(&worker->lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return NULL;
+    }
+
+    if (virCondInit(&worker->cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&worker->lock);
+        return NULL;
+    }
+
+    worker->name = g_strdup(name);
+
+    if (virThreadCreateFull(&worker->thread, true, virPeriodicWorkerThread,
+                            worker->name, false, worker) < 0) {
+        virReportSystemError(errno, _("Unable to create thread '%1$s'"), name);
+        g_free(worker->name);
+        virCondDestroy(&worker->cond);
+        virMutexDestroy(&worker->lock);
+        return NULL;
+    }
+
+    return g_steal_pointer(&worker);
+}
+
+
+/**
+ * virPeriodicWorkerFree:
+ * @worker: worker started by virPeriodicWorkerNew
+ *
+ * Stops @worker, waiting for the current call of its function to finish,
+ * and frees it.
+ */
+void
+virPeriodicWorkerFree(virPeriodicWorker *worker)
+{
+    if (!worker)
+        return;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&worker->lock) {
+        worker->quit = true;
+        virCondSignal(&worker->cond);
+    }
+
+    virThreadJoin(&worker->thread);
+
+    virCondDestroy(&worker->cond);
+    virMutexDestroy(&worker->lock);
+    g_free(worker->name);
+    g_free(worker);
+}
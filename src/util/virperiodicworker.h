@@ -0,0 +1,38 @@
+/*
+ * virperiodicworker.h: thread running a function periodically
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "internal.h"
+
+typedef struct _virPeriodicWorker virPeriodicWorker;
+
+/* @now is the time the function was called at in ms since the epoch */
+typedef void (*virPeriodicWorkerFunc)(unsigned long long now,
+                                      void *opaque);
+
+virPeriodicWorker *
+virPeriodicWorkerNew(const char *name,
+                     unsigned long long period,
+                     virPeriodicWorkerFunc func,
+                     void *opaque) ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(3);
+
+void
+virPeriodicWorkerFree(virPeriodicWorker *worker);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virPeriodicWorker, virPeriodicWorkerFree);
@@ -1933,6 +1933,52 @@ virResctrlAllocGetUnused(virResctrlInfo *resctrl)
 }
 
 
+/*
+ * Finds the smallest contiguous region of set bits in @f_mask which can hold
+ * @need_bits bits.  Returns position of the region or -1 if there is none.
+ */
+static ssize_t
+virResctrlFindRegion(virBitmap *f_mask,
+                     unsigned long long need_bits)
+{
+    ssize_t pos = -1;
+    ssize_t last_bits = 0;
+    ssize_t last_pos = -1;
+
+    while ((pos = virBitmapNextSetBit(f_mask, pos)) >= 0) {
+        ssize_t pos_clear = virBitmapNextClearBit(f_mask, pos);
+        ssize_t bits;
+
+        if (pos_clear < 0)
+            pos_clear = virBitmapSize(f_mask);
+
+        bits = pos_clear - pos;
+
+        /* Not enough bits, move on and skip all of them */
+        if (bits < need_bits) {
+            pos = pos_clear;
+            continue;
+        }
+
+        /* This fits perfectly */
+        if (bits == need_bits) {
+            last_pos = pos;
+            break;
+        }
+
+        /* Remember the smaller region if we already found on before */
+        if (last_pos < 0 || (last_bits && bits < last_bits)) {
+            last_bits = bits;
+            last_pos = pos;
+        }
+
+        pos = pos_clear;
+    }
+
+    return last_pos;
+}
+
+
 /*
  * Given the information about requested allocation type `a_type`, the host
  * cache for a particular type `i_type` and unused bits in the system `f_type`
@@ -1956,8 +2002,6 @@ virResctrlAllocFindUnused(virResctrlAlloc *alloc,
     virBitmap *f_mask = NULL;
     unsigned long long need_bits;
     size_t i = 0;
-    ssize_t pos = -1;
-    ssize_t last_bits = 0;
     ssize_t last_pos = -1;
 
     if (!size)
@@ -2002,37 +2046,7 @@ virResctrlAllocFindUnused(virResctrlAlloc *alloc,
         return -1;
     }
 
-    while ((pos = virBitmapNextSetBit(f_mask, pos)) >= 0) {
-        ssize_t pos_clear = virBitmapNextClearBit(f_mask, pos);
-        ssize_t bits;
-
-        if (pos_clear < 0)
-            pos_clear = virBitmapSize(f_mask);
-
-        bits = pos_clear - pos;
-
-        /* Not enough bits, move on and skip all of them */
-        if (bits < need_bits) {
-            pos = pos_clear;
-            continue;
-        }
-
-        /* This fits perfectly */
-        if (bits == need_bits) {
-            last_pos = pos;
-            break;
-        }
-
-        /* Remember the smaller region if we already found on before */
-        if (last_pos < 0 || (last_bits && bits < last_bits)) {
-            last_bits = bits;
-            last_pos = pos;
-        }
-
-        pos = pos_clear;
-    }
-
-    if (last_pos < 0) {
+    if ((last_pos = virResctrlFindRegion(f_mask, need_bits)) < 0) {
         virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                        _("Not enough room for allocation of %1$llu bytes for level %2$u cache %3$u scope type '%4$s'"),
                        *size, level, cache,
@@ -2392,6 +2406,529 @@ virResctrlAllocRemove(virResctrlAlloc *alloc)
 }
 
 
+/* Occupancy threshold in percent of the configured cache below which an
+ * allocation is considered idle.  It must not be relative to the currently
+ * assigned cache, otherwise shrinking an idle allocation could make it look
+ * in use again in the next round. */
+#define VIR_RESCTRL_SHARE_IDLE 50
+
+/* Occupancy threshold in percent of the currently assigned cache above
+ * which an allocation is considered busy */
+#define VIR_RESCTRL_SHARE_BUSY 90
+
+
+static bool
+virResctrlShareIsIdle(const virResctrlShare *share)
+{
+    return share->monitored &&
+        share->used * 100ULL < share->configured * (unsigned long long)VIR_RESCTRL_SHARE_IDLE;
+}
+
+
+static bool
+virResctrlShareIsBusy(const virResctrlShare *share)
+{
+    return share->monitored &&
+        share->used * 100ULL >= share->current * (unsigned long long)VIR_RESCTRL_SHARE_BUSY;
+}
+
+
+static bool
+virResctrlShareIsRecipient(const virResctrlShare *share,
+                           bool any_busy,
+                           bool any_idle)
+{
+    if (any_busy)
+        return virResctrlShareIsBusy(share);
+
+    if (any_idle)
+        return virResctrlShareIsIdle(share);
+
+    return true;
+}
+
+
+/*
+ * Computes the number of bits each of @shares should get out of the bits
+ * they are currently assigned altogether.  Every share is guaranteed its
+ * configured number of bits unless it is idle, in which case it is shrunk
+ * to half of that (but at least @min_bits).  Shares which are neither idle
+ * nor busy keep what they borrowed before and the rest is lent to busy
+ * shares in proportion to their configured sizes.  Without busy shares the
+ * idle ones get their bits back.  If the guarantees cannot
+ * be met, targets are left equal to the current sizes.
+ */
+void
+virResctrlShareCompute(virResctrlShare *shares,
+                       size_t nshares,
+                       unsigned int min_bits)
+{
+    unsigned long long pool = 0;
+    unsigned long long assigned = 0;
+    unsigned long long weight = 0;
+    unsigned long long left;
+    unsigned long long given = 0;
+    bool any_busy = false;
+    bool any_idle = false;
+    size_t i;
+
+    for (i = 0; i < nshares; i++) {
+        virResctrlShare *share = &shares[i];
+
+        pool += share->current;
+        share->target = share->configured;
+
+        if (virResctrlShareIsIdle(share)) {
+            share->target = MIN(share->configured,
+                                MAX(min_bits, share->configured / 2));
+            any_idle = true;
+        } else if (virResctrlShareIsBusy(share)) {
+            any_busy = true;
+        }
+
+        assigned += share->target;
+    }
+
+    if (assigned > pool) {
+        for (i = 0; i < nshares; i++)
+            shares[i].target = shares[i].current;
+        return;
+    }
+
+    left = pool - assigned;
+
+    /* Let allocations which are still using borrowed bits keep them */
+    for (i = 0; i < nshares && left > 0; i++) {
+        virResctrlShare *share = &shares[i];
+        unsigned long long extra;
+
+        if (virResctrlShareIsIdle(share) ||
+            virResctrlShareIsBusy(share) ||
+            share->current <= share->target)
+            continue;
+
+        extra = MIN(share->current - share->target, left);
+        share->target += extra;
+        left -= extra;
+    }
+
+    /* Lend the rest to busy allocations, or give it back to the idle ones if
+     * nobody needs it */
+    for (i = 0; i < nshares; i++) {
+        if (virResctrlShareIsRecipient(&shares[i], any_busy, any_idle))
+            weight += shares[i].configured;
+    }
+
+    if (weight == 0)
+        return;
+
+    for (i = 0; i < nshares; i++) {
+        virResctrlShare *share = &shares[i];
+        unsigned long long extra;
+
+        if (!virResctrlShareIsRecipient(share, any_busy, any_idle))
+            continue;
+
+        extra = left * share->configured / weight;
+        share->target += extra;
+        given += extra;
+    }
+
+    /* Rounding leftovers go to the first recipient */
+    for (i = 0; i < nshares; i++) {
+        if (virResctrlShareIsRecipient(&shares[i], any_busy, any_idle)) {
+            shares[i].target += left - given;
+            break;
+        }
+    }
+}
+
+
+static unsigned long long *
+virResctrlAllocGetSize(virResctrlAlloc *alloc,
+                       unsigned int level,
+                       virCacheType type,
+                       unsigned int cache)
+{
+    virResctrlAllocPerType *a_type = NULL;
+
+    if (level >= alloc->nlevels || !alloc->levels[level])
+        return NULL;
+
+    a_type = alloc->levels[level]->types[type];
+    if (!a_type || cache >= a_type->nsizes)
+        return NULL;
+
+    return a_type->sizes[cache];
+}
+
+
+static virBitmap *
+virResctrlAllocGetMask(virResctrlAlloc *alloc,
+                       unsigned int level,
+                       virCacheType type,
+                       unsigned int cache)
+{
+    virResctrlAllocPerType *a_type = NULL;
+
+    if (level >= alloc->nlevels || !alloc->levels[level])
+        return NULL;
+
+    a_type = alloc->levels[level]->types[type];
+    if (!a_type || cache >= a_type->nmasks)
+        return NULL;
+
+    return a_type->masks[cache];
+}
+
+
+static int
+virResctrlShareSorter(const void *a,
+                      const void *b,
+                      void *opaque)
+{
+    const virResctrlShare *shares = opaque;
+    unsigned int ta = shares[*(const size_t *)a].target;
+    unsigned int tb = shares[*(const size_t *)b].target;
+
+    return (tb > ta) - (tb < ta);
+}
+
+
+/*
+ * Redistributes the bits of one cache among the @groups which have a size
+ * configured for it in the matching @usage.  Only the bits the groups hold
+ * together are used so that allocations of other groups and the space left
+ * for new ones are not affected.  The new masks are stored in @groups.
+ */
+static int
+virResctrlAllocRedistributeCache(virResctrlInfoPerType *i_type,
+                                 unsigned int level,
+                                 virCacheType type,
+                                 unsigned int cache,
+                                 bool monitored,
+                                 virResctrlAllocUsage *usage,
+                                 virResctrlAlloc **groups,
+                                 size_t nusage)
+{
+    g_autofree virResctrlShare *shares = g_new0(virResctrlShare, nusage);
+    g_autofree size_t *members = g_new0(size_t, nusage);
+    g_autofree size_t *order = g_new0(size_t, nusage);
+    g_autoptr(virBitmap) pool = virBitmapNew(i_type->bits);
+    unsigned long long granularity = i_type->control.granularity;
+    unsigned long long pool_bits = 0;
+    virBitmap **masks = NULL;
+    size_t nshares = 0;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < nusage; i++) {
+        unsigned long long *size = NULL;
+        virBitmap *mask = NULL;
+        virResctrlShare *share = &shares[nshares];
+
+        if (!groups[i] ||
+            !(size = virResctrlAllocGetSize(usage[i].alloc, level, type, cache)) ||
+            !(mask = virResctrlAllocGetMask(groups[i], level, type, cache)))
+            continue;
+
+        share->configured = *size / granularity;
+        share->current = virBitmapCountBits(mask);
+
+        if (monitored && cache < usage[i].noccupancy) {
+            share->monitored = true;
+            share->used = MIN(VIR_DIV_UP(usage[i].occupancy[cache], granularity),
+                              i_type->bits);
+        }
+
+        pool_bits += share->current;
+        virBitmapUnion(pool, mask);
+        order[nshares] = nshares;
+        members[nshares++] = i;
+    }
+
+    /* Nothing to trade, or the masks overlap so they were not assigned by
+     * virResctrlAllocCreate() */
+    if (nshares < 2 || virBitmapCountBits(pool) != pool_bits)
+        return 0;
+
+    virResctrlShareCompute(shares, nshares, i_type->min_cbm_bits);
+
+    for (i = 0; i < nshares; i++) {
+        if (shares[i].target != shares[i].current)
+            break;
+    }
+
+    if (i == nshares)
+        return 0;
+
+    /* Place larger allocations first to avoid fragmenting the pool */
+    g_qsort_with_data(order, nshares, sizeof(*order),
+                      virResctrlShareSorter, shares);
+
+    masks = g_new0(virBitmap *, nshares);
+
+    for (i = 0; i < nshares; i++) {
+        size_t j = order[i];
+        ssize_t pos = virResctrlFindRegion(pool, shares[j].target);
+        size_t k;
+
+        if (pos < 0) {
+            VIR_DEBUG("Unable to fit resized allocations into level %u cache %u scope type '%s'",
+                      level, cache, virCacheTypeToString(type));
+            ret = 0;
+            goto cleanup;
+        }
+
+        masks[j] = virBitmapNew(i_type->bits);
+
+        for (k = pos; k < pos + shares[j].target; k++) {
+            ignore_value(virBitmapSetBit(masks[j], k));
+            ignore_value(virBitmapClearBit(pool, k));
+        }
+    }
+
+    for (i = 0; i < nshares; i++) {
+        if (virResctrlAllocUpdateMask(groups[members[i]], level, type,
+                                      cache, masks[i]) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    for (i = 0; masks && i < nshares; i++)
+        virBitmapFree(masks[i]);
+    g_free(masks);
+    return ret;
+}
+
+
+/*
+ * Unthrottled allocations get the same bandwidth as the default group which
+ * is the maximum no matter whether it is in percent or MBps.
+ */
+static void
+virResctrlAllocRedistributeMemBW(virResctrlAllocUsage *usage,
+                                 virResctrlAlloc *group,
+                                 virResctrlAlloc *alloc_default)
+{
+    virResctrlAllocMemBW *mem_bw = usage->alloc->mem_bw;
+    virResctrlAllocMemBW *max_bw = alloc_default->mem_bw;
+    size_t i;
+
+    if (!mem_bw || !group->mem_bw || !max_bw)
+        return;
+
+    for (i = 0; i < mem_bw->nbandwidths && i < group->mem_bw->nbandwidths; i++) {
+        if (!mem_bw->bandwidths[i] || !group->mem_bw->bandwidths[i] ||
+            i >= max_bw->nbandwidths || !max_bw->bandwidths[i])
+            continue;
+
+        if (usage->throttle)
+            *group->mem_bw->bandwidths[i] = *mem_bw->bandwidths[i];
+        else
+            *group->mem_bw->bandwidths[i] = *max_bw->bandwidths[i];
+    }
+}
+
+
+static int
+virResctrlAllocWriteGroup(virResctrlAlloc *alloc,
+                          virResctrlAlloc *group,
+                          const char *orig)
+{
+    g_autofree char *schemata_path = NULL;
+    g_autofree char *alloc_str = NULL;
+
+    if (!(alloc_str = virResctrlAllocFormat(group)))
+        return -1;
+
+    if (STREQ(alloc_str, orig))
+        return 0;
+
+    schemata_path = g_strdup_printf("%s/schemata", alloc->path);
+
+    VIR_DEBUG("Writing resctrl schemata '%s' into '%s'", alloc_str, schemata_path);
+    if (virFileWriteStr(schemata_path, alloc_str, 0) < 0) {
+        /* The domain was stopped in the meantime */
+        if (errno == ENOENT)
+            return 0;
+
+        virReportSystemError(errno,
+                             _("Cannot write into schemata file '%1$s'"),
+                             schemata_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static unsigned long long
+virResctrlAllocCountBits(virResctrlAlloc *alloc)
+{
+    unsigned long long ret = 0;
+    size_t level;
+
+    for (level = 0; level < alloc->nlevels; level++) {
+        size_t type;
+
+        if (!alloc->levels[level])
+            continue;
+
+        for (type = 0; type < VIR_CACHE_TYPE_LAST; type++) {
+            virResctrlAllocPerType *a_type = alloc->levels[level]->types[type];
+            size_t cache;
+
+            if (!a_type)
+                continue;
+
+            for (cache = 0; cache < a_type->nmasks; cache++) {
+                if (a_type->masks[cache])
+                    ret += virBitmapCountBits(a_type->masks[cache]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+/**
+ * virResctrlAllocRedistribute:
+ * @resctrl: host resctrl information
+ * @usage: allocations created by virResctrlAllocCreate() and their usage
+ * @nusage: number of items in @usage
+ *
+ * Resizes cache allocations of @usage according to their last level cache
+ * occupancy.  The configured sizes are treated as guaranteed shares: cache
+ * left unused by idle allocations is lent to busy ones until the idle ones
+ * need it again.  Only the cache the allocations hold together is moved
+ * around so space available for new allocations does not change.
+ *
+ * Memory bandwidth of allocations with @usage->throttle set is limited to
+ * the configured value while the other ones are not limited at all.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virResctrlAllocRedistribute(virResctrlInfo *resctrl,
+                            virResctrlAllocUsage *usage,
+                            size_t nusage)
+{
+    g_autoptr(virResctrlAlloc) alloc_default = NULL;
+    virResctrlAlloc **groups = NULL;
+    char **orig = NULL;
+    g_autofree unsigned long long *before = NULL;
+    unsigned int monitored_level = 0;
+    size_t level;
+    size_t pass;
+    size_t i;
+    int lockfd = -1;
+    int ret = -1;
+
+    if (virResctrlInfoIsEmpty(resctrl)) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                       _("Resource control is not supported on this host"));
+        return -1;
+    }
+
+    if (resctrl->monitor_info)
+        monitored_level = resctrl->monitor_info->cache_level;
+
+    lockfd = virResctrlLock();
+    if (lockfd < 0)
+        goto cleanup;
+
+    if (!(alloc_default = virResctrlAllocGetDefault(resctrl)))
+        goto cleanup;
+
+    groups = g_new0(virResctrlAlloc *, nusage);
+    orig = g_new0(char *, nusage);
+    before = g_new0(unsigned long long, nusage);
+
+    for (i = 0; i < nusage; i++) {
+        virResctrlAlloc *alloc = usage[i].alloc;
+        g_autofree char *groupname = NULL;
+        int rv;
+
+        if (!alloc->path || STREQ(alloc->path, SYSFS_RESCTRL_PATH))
+            continue;
+
+        groupname = g_path_get_basename(alloc->path);
+
+        /* The group is gone when the domain was stopped in the meantime */
+        if ((rv = virResctrlAllocGetGroup(resctrl, groupname, &groups[i])) == -2)
+            continue;
+
+        if (rv < 0 || !(orig[i] = virResctrlAllocFormat(groups[i])))
+            goto cleanup;
+
+        before[i] = virResctrlAllocCountBits(groups[i]);
+    }
+
+    for (level = 0; level < resctrl->nlevels; level++) {
+        virResctrlInfoPerLevel *i_level = resctrl->levels[level];
+        size_t type;
+
+        if (!i_level)
+            continue;
+
+        for (type = 0; type < VIR_CACHE_TYPE_LAST; type++) {
+            virResctrlInfoPerType *i_type = i_level->types[type];
+            bool monitored = level == monitored_level &&
+                             type == VIR_CACHE_TYPE_BOTH;
+            ssize_t cache = -1;
+
+            if (!i_type)
+                continue;
+
+            while ((cache = virBitmapNextSetBit(i_type->cache_ids, cache)) >= 0) {
+                if (virResctrlAllocRedistributeCache(i_type, level, type, cache,
+                                                     monitored, usage,
+                                                     groups, nusage) < 0)
+                    goto cleanup;
+            }
+        }
+    }
+
+    for (i = 0; i < nusage; i++) {
+        if (groups[i])
+            virResctrlAllocRedistributeMemBW(&usage[i], groups[i],
+                                             alloc_default);
+    }
+
+    /* Shrink allocations first so that the grown ones overlap them as little
+     * as possible */
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < nusage; i++) {
+            bool grows;
+
+            if (!groups[i])
+                continue;
+
+            grows = virResctrlAllocCountBits(groups[i]) > before[i];
+            if (grows != (pass == 1))
+                continue;
+
+            if (virResctrlAllocWriteGroup(usage[i].alloc, groups[i], orig[i]) < 0)
+                goto cleanup;
+        }
+    }
+
+    ret = 0;
+ cleanup:
+    virResctrlUnlock(lockfd);
+    for (i = 0; groups && i < nusage; i++) {
+        virObjectUnref(groups[i]);
+        g_free(orig[i]);
+    }
+    g_free(groups);
+    g_free(orig);
+    return ret;
+}
+
+
 /* virResctrlMonitor-related definitions */
 
 virResctrlMonitor *
@@ -2549,24 +3086,11 @@ virResctrlMonitorStatsSorter(const void *a,
 }
 
 
-/*
- * virResctrlMonitorGetStats
- *
- * @monitor: The monitor that the statistic data will be retrieved from.
- * @resources: A string list for the monitor feature names.
- * @stats: Pointer of of virResctrlMonitorStats * array for holding cache or
- * memory bandwidth usage data.
- * @nstats: A size_t pointer to hold the returned array length of @stats
- *
- * Get cache or memory bandwidth utilization information.
- *
- * Returns 0 on success, -1 on error.
- */
-int
-virResctrlMonitorGetStats(virResctrlMonitor *monitor,
-                          const char **resources,
-                          virResctrlMonitorStats ***stats,
-                          size_t *nstats)
+static int
+virResctrlGetStats(const char *path,
+                   const char **resources,
+                   virResctrlMonitorStats ***stats,
+                   size_t *nstats)
 {
     int rv = -1;
     int ret = -1;
@@ -2578,13 +3102,7 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
     virResctrlMonitorStats *stat = NULL;
     size_t nresources = g_strv_length((char **) resources);
 
-    if (!monitor) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Invalid resctrl monitor"));
-        return -1;
-    }
-
-    datapath = g_strdup_printf("%s/mon_data", monitor->path);
+    datapath = g_strdup_printf("%s/mon_data", path);
 
     if (virDirOpen(&dirp, datapath) < 0)
         goto cleanup;
@@ -2657,6 +3175,65 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
 }
 
 
+/*
+ * virResctrlMonitorGetStats
+ *
+ * @monitor: The monitor that the statistic data will be retrieved from.
+ * @resources: A string list for the monitor feature names.
+ * @stats: Pointer of of virResctrlMonitorStats * array for holding cache or
+ * memory bandwidth usage data.
+ * @nstats: A size_t pointer to hold the returned array length of @stats
+ *
+ * Get cache or memory bandwidth utilization information.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virResctrlMonitorGetStats(virResctrlMonitor *monitor,
+                          const char **resources,
+                          virResctrlMonitorStats ***stats,
+                          size_t *nstats)
+{
+    if (!monitor) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Invalid resctrl monitor"));
+        return -1;
+    }
+
+    return virResctrlGetStats(monitor->path, resources, stats, nstats);
+}
+
+
+/*
+ * virResctrlAllocGetStats
+ *
+ * @alloc: The allocation that the statistic data will be retrieved from.
+ * @resources: A string list for the monitor feature names.
+ * @stats: Pointer of of virResctrlMonitorStats * array for holding cache or
+ * memory bandwidth usage data.
+ * @nstats: A size_t pointer to hold the returned array length of @stats
+ *
+ * Get cache or memory bandwidth utilization information of all tasks in the
+ * resctrl group of @alloc, no matter which monitors were defined for it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virResctrlAllocGetStats(virResctrlAlloc *alloc,
+                        const char **resources,
+                        virResctrlMonitorStats ***stats,
+                        size_t *nstats)
+{
+    if (!alloc || !alloc->path) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Invalid resctrl allocation"));
+        return -1;
+    }
+
+    return virResctrlGetStats(alloc->path, resources, stats, nstats);
+}
+
+
 void
 virResctrlMonitorStatsFree(virResctrlMonitorStats *stat)
 {
@@ -177,6 +177,22 @@ virResctrlAllocAddPID(virResctrlAlloc *alloc,
 int
 virResctrlAllocRemove(virResctrlAlloc *alloc);
 
+typedef struct _virResctrlAllocUsage virResctrlAllocUsage;
+struct _virResctrlAllocUsage {
+    virResctrlAlloc *alloc;
+    /* Last level cache occupancy in bytes indexed by cache id, empty if
+     * cache monitoring is not available */
+    unsigned long long *occupancy;
+    size_t noccupancy;
+    /* Limit memory bandwidth to the configured values */
+    bool throttle;
+};
+
+int
+virResctrlAllocRedistribute(virResctrlInfo *resctrl,
+                            virResctrlAllocUsage *usage,
+                            size_t nusage);
+
 void
 virResctrlInfoMonFree(virResctrlInfoMon *mon);
 
@@ -238,5 +254,11 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
                           virResctrlMonitorStats ***stats,
                           size_t *nstats);
 
+int
+virResctrlAllocGetStats(virResctrlAlloc *alloc,
+                        const char **resources,
+                        virResctrlMonitorStats ***stats,
+                        size_t *nstats);
+
 void
 virResctrlMonitorStatsFree(virResctrlMonitorStats *stats);
@@ -26,3 +26,17 @@
 
 virResctrlAlloc *
 virResctrlAllocGetUnused(virResctrlInfo *resctrl);
+
+typedef struct _virResctrlShare virResctrlShare;
+struct _virResctrlShare {
+    unsigned int configured; /* bits requested by the configuration */
+    unsigned int current;    /* bits currently assigned */
+    unsigned int used;       /* bits worth of occupied cache */
+    bool monitored;          /* whether @used is known */
+    unsigned int target;     /* bits to be assigned */
+};
+
+void
+virResctrlShareCompute(virResctrlShare *shares,
+                       size_t nshares,
+                       unsigned int min_bits);
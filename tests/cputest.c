@@ -486,7 +486,8 @@ cpuTestMakeQEMUCaps(const struct data *data)
                                         cpu, true, false, fail_no_props, &model) < 0)
         return NULL;
 
-    qemuCaps = virQEMUCapsNew();
+    if (!(qemuCaps = virQEMUCapsNew()))
+        return NULL;
 
     virQEMUCapsSet(qemuCaps, QEMU_CAPS_KVM);
     if (data->flags == JSON_MODELS ||
@@ -81,12 +81,22 @@ testCommandDryRun(const char *const*args G_GNUC_UNUSED,
     *status = 0;
     /* if arg[1] is -ae then this is an nft command,
      * and the caller requested to get the handle
-     * of the newly added object in stdout
+     * of the newly added object in stdout - one
+     * for each of the ';' separated commands
      */
-    if (STREQ_NULLABLE(args[1], "-ae"))
-        *output = g_strdup("# handle 5309");
-    else
+    if (STREQ_NULLABLE(args[1], "-ae")) {
+        g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+        size_t i;
+
+        virBufferAddLit(&buf, "# handle 5309\n");
+        for (i = 2; args[i]; i++) {
+            if (STREQ(args[i], ";"))
+                virBufferAddLit(&buf, "# handle 5309\n");
+        }
+        *output = virBufferContentAndReset(&buf);
+    } else {
         *output = g_strdup("");
+    }
     *error = g_strdup("");
 }
 
@@ -444,6 +444,45 @@ testNWFilterEBIPTablesApplyDropAllRules(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testNWFilterEBIPTablesApplyUnchangedRules(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+    int ret = -1;
+
+    virCommandSetDryRun(dryRunToken, &buf, false, true, NULL, NULL);
+
+    if (ebiptables_driver.applyNewRules("vnet0", NULL, 0) < 0 ||
+        ebiptables_driver.tearOldRules("vnet0") < 0)
+        goto cleanup;
+
+    if (virBufferUse(&buf) == 0) {
+        fprintf(stderr, "Expected rules to be applied\n");
+        goto cleanup;
+    }
+
+    virBufferFreeAndReset(&buf);
+
+    /* the very same rules are already active */
+    if (ebiptables_driver.applyNewRules("vnet0", NULL, 0) < 0 ||
+        ebiptables_driver.tearOldRules("vnet0") < 0)
+        goto cleanup;
+
+    actual = virBufferContentAndReset(&buf);
+
+    if (virTestCompareToString("", NULLSTR_EMPTY(actual)) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    ebiptables_driver.allTeardown("vnet0");
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -484,6 +523,11 @@ mymain(void)
                    NULL) < 0)
         ret = -1;
 
+    if (virTestRun("ebiptablesApplyUnchangedRules",
+                   testNWFilterEBIPTablesApplyUnchangedRules,
+                   NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -22,6 +22,8 @@
 #include <unistd.h>
 
 #include "testutils.h"
+#include "datatypes.h"
+#include "domain_event.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -444,6 +446,140 @@ testDomainStartStopEvent(const void *data)
     return ret;
 }
 
+
+#define MANY_CALLBACKS 10000
+
+static int
+testDomainManyCallbacks(const void *data)
+{
+    const objecteventTest *test = data;
+    lifecycleEventCounter counter = { 0 };
+    lifecycleEventCounter otherCounter = { 0 };
+    virObjectEventState *state = NULL;
+    unsigned char uuid[VIR_UUID_BUFLEN] = { 0 };
+    g_autofree int *ids = g_new0(int, MANY_CALLBACKS);
+    int globalID = -1;
+    size_t target = MANY_CALLBACKS / 2;
+    size_t nids = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(state = virObjectEventStateNew()))
+        return -1;
+
+    /* One global callback and lots of per-domain ones, of which only one
+     * is interested in the event queued below */
+    if (virDomainEventStateRegisterID(test->conn, state, NULL,
+                                      VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                      VIR_DOMAIN_EVENT_CALLBACK(&domainLifecycleCb),
+                                      &counter, NULL, &globalID) < 0)
+        goto cleanup;
+
+    for (i = 0; i < MANY_CALLBACKS; i++) {
+        g_autofree char *name = g_strdup_printf("dom%zu", i);
+        virDomainPtr dom;
+        int rc;
+
+        memcpy(uuid, &i, sizeof(i));
+        if (!(dom = virGetDomain(test->conn, name, uuid, -1)))
+            goto cleanup;
+
+        rc = virDomainEventStateRegisterID(test->conn, state, dom,
+                                           VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                           VIR_DOMAIN_EVENT_CALLBACK(&domainLifecycleCb),
+                                           i == target ? &counter : &otherCounter,
+                                           NULL, &ids[nids]);
+        virObjectUnref(dom);
+        if (rc < 0)
+            goto cleanup;
+        nids++;
+    }
+
+    memcpy(uuid, &target, sizeof(target));
+    virObjectEventStateQueue(state,
+                             virDomainEventLifecycleNew(-1, "target", uuid,
+                                                        VIR_DOMAIN_EVENT_STARTED,
+                                                        0));
+
+    if (virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (counter.startEvents != 2 || otherCounter.startEvents != 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nids; i++)
+        virObjectEventStateDeregisterID(test->conn, state, ids[i], true);
+    if (globalID >= 0)
+        virObjectEventStateDeregisterID(test->conn, state, globalID, true);
+    virObjectUnref(state);
+    return ret;
+}
+
+
+typedef struct {
+    int events;
+    unsigned long long actual;
+} balloonEventCounter;
+
+static void
+domainBalloonChangeCb(virConnectPtr conn G_GNUC_UNUSED,
+                      virDomainPtr dom G_GNUC_UNUSED,
+                      unsigned long long actual,
+                      void *opaque)
+{
+    balloonEventCounter *counter = opaque;
+
+    counter->events++;
+    counter->actual = actual;
+}
+
+static int
+testDomainCoalesceEvents(const void *data)
+{
+    const objecteventTest *test = data;
+    balloonEventCounter counter = { 0 };
+    virObjectEventState *state = NULL;
+    virDomainPtr dom = NULL;
+    int id = -1;
+    int ret = -1;
+
+    if (!(state = virObjectEventStateNew()))
+        return -1;
+
+    if (!(dom = virDomainLookupByName(test->conn, "test")))
+        goto cleanup;
+
+    if (virDomainEventStateRegisterID(test->conn, state, dom,
+                                      VIR_DOMAIN_EVENT_ID_BALLOON_CHANGE,
+                                      VIR_DOMAIN_EVENT_CALLBACK(&domainBalloonChangeCb),
+                                      &counter, NULL, &id) < 0)
+        goto cleanup;
+
+    /* Only the last value is worth delivering */
+    virObjectEventStateQueue(state, virDomainEventBalloonChangeNewFromDom(dom, 1024));
+    virObjectEventStateQueue(state, virDomainEventBalloonChangeNewFromDom(dom, 2048));
+    virObjectEventStateQueue(state, virDomainEventBalloonChangeNewFromDom(dom, 4096));
+
+    if (virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (counter.events != 1 || counter.actual != 4096)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    if (id >= 0)
+        virObjectEventStateDeregisterID(test->conn, state, id, true);
+    virObjectUnref(state);
+    if (dom)
+        virDomainFree(dom);
+    return ret;
+}
+
 static int
 testNetworkCreateXML(const void *data)
 {
@@ -804,6 +940,12 @@ mymain(void)
         ret = EXIT_FAILURE;
     if (virTestRun("Domain start stop events", testDomainStartStopEvent, &test) < 0)
         ret = EXIT_FAILURE;
+    if (virTestRun("Domain event with many callbacks",
+                   testDomainManyCallbacks, &test) < 0)
+        ret = EXIT_FAILURE;
+    if (virTestRun("Domain events coalesced",
+                   testDomainCoalesceEvents, &test) < 0)
+        ret = EXIT_FAILURE;
 
     /* Network event tests */
     /* Tests requiring the test network not to be set up */
@@ -106,7 +106,8 @@ testQemuCaps(const void *opaque)
     binary = g_strdup_printf("/usr/bin/qemu-system-%s",
                              data->archName);
 
-    capsActual = virQEMUCapsNewBinary(binary);
+    if (!(capsActual = virQEMUCapsNewBinary(binary)))
+        return -1;
 
     if (virQEMUCapsInitQMPMonitor(capsActual, qemuMonitorTestGetMonitor(mon)) < 0)
         return -1;
@@ -174,6 +175,60 @@ testQemuCapsCopy(const void *opaque)
 }
 
 
+/* Results cached in capabilities must be returned by later lookups of the
+ * same capabilities and disappear from them once they are found invalid. */
+static int
+testQemuCapsCachedResult(const void *opaque)
+{
+    testQemuData *data = (void *) opaque;
+    virFileCache *cache = data->driver.qemuCapsCache;
+    const char *capsFile = TEST_QEMU_CAPS_PATH "/caps_9.2.0_x86_64.xml";
+    g_autoptr(virQEMUCaps) caps = NULL;
+    g_autoptr(virQEMUCaps) found = NULL;
+    g_autofree char *result = NULL;
+
+    if (!(caps = qemuTestParseCapabilitiesArch(VIR_ARCH_X86_64, capsFile)))
+        return -1;
+
+    if (qemuTestCapsCacheInsert(cache, caps) < 0)
+        return -1;
+
+    virQEMUCapsSetCachedResult(caps, "test", "result", 0);
+
+    found = virQEMUCapsCacheLookup(cache, virQEMUCapsGetBinary(caps));
+    if (found != caps) {
+        fprintf(stderr, "lookup didn't return the inserted capabilities\n");
+        return -1;
+    }
+
+    if (!(result = virQEMUCapsGetCachedResult(found, "test")) ||
+        STRNEQ(result, "result")) {
+        fprintf(stderr, "expected cached result 'result', got '%s'\n",
+                NULLSTR(result));
+        return -1;
+    }
+    g_clear_pointer(&result, g_free);
+
+    /* the capabilities come from a different libvirt version so they are
+     * outdated once checked */
+    virQEMUCapsSetInvalidation(caps, true);
+
+    if (virQEMUCapsCacheIsValid(caps, virFileCacheGetPriv(cache))) {
+        fprintf(stderr, "outdated capabilities considered valid\n");
+        return -1;
+    }
+
+    /* @found still refers to the outdated capabilities */
+    if ((result = virQEMUCapsGetCachedResult(found, "test"))) {
+        fprintf(stderr, "unexpected cached result '%s' after invalidation\n",
+                result);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 doCapsTest(const char *inputDir,
            const char *prefix,
@@ -222,6 +277,9 @@ mymain(void)
 
     /* See documentation in qemucapabilitiesdata/README.rst */
 
+    if (virTestRun("cached result", testQemuCapsCachedResult, &data) < 0)
+        data.ret = -1;
+
     testQemuDataReset(&data);
 
     return (data.ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -65,7 +65,8 @@ testQemuGetCaps(char *caps)
         return NULL;
     }
 
-    qemuCaps = virQEMUCapsNew();
+    if (!(qemuCaps = virQEMUCapsNew()))
+        return NULL;
 
     for (i = 0; i < n; i++) {
         g_autofree char *str = virXMLPropString(nodes[i], "name");
@@ -2258,6 +2258,236 @@ testQemuMonitorJSONGetNonExistingCPUData(const void *opaque)
     return 0;
 }
 
+static int
+testQemuMonitorJSONReplyCacheGetIOThreads(qemuMonitor *mon,
+                                          int expect)
+{
+    qemuMonitorIOThreadInfo **info = NULL;
+    int ninfo = 0;
+    size_t i;
+    int ret = -1;
+
+    if (qemuMonitorGetIOThreads(mon, &info, &ninfo) < 0)
+        goto cleanup;
+
+    if (ninfo != expect) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "ninfo %d is not %d", ninfo, expect);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < ninfo; i++)
+        VIR_FREE(info[i]);
+    VIR_FREE(info);
+
+    return ret;
+}
+
+
+static int
+testQemuMonitorJSONReplyCache(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    g_autoptr(qemuMonitorTest) test = NULL;
+    qemuMonitor *mon;
+
+    if (!(test = qemuMonitorTestNewSchema(data->xmlopt, data->schema)))
+        return -1;
+
+    mon = qemuMonitorTestGetMonitor(test);
+
+    if (qemuMonitorTestAddItem(test, "query-iothreads",
+                               "{\"return\": [{\"id\": \"iothread1\", \"thread-id\": 30992},"
+                               "             {\"id\": \"iothread2\", \"thread-id\": 30993}]}") < 0 ||
+        qemuMonitorTestAddItem(test, "object-del", "{\"return\": {}}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-iothreads",
+                               "{\"return\": [{\"id\": \"iothread1\", \"thread-id\": 30992}]}") < 0 ||
+        qemuMonitorTestAddItem(test, "object-del", "{\"return\": {}}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-iothreads",
+                               "{\"return\": [{\"id\": \"iothread2\", \"thread-id\": 30993}]}\r\n"
+                               "{\"event\": \"RESUME\","
+                               " \"timestamp\": {\"seconds\": 1, \"microseconds\": 2}}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-iothreads", "{\"return\": []}") < 0)
+        return -1;
+
+    /* the second query must be answered from the cache */
+    if (testQemuMonitorJSONReplyCacheGetIOThreads(mon, 2) < 0 ||
+        testQemuMonitorJSONReplyCacheGetIOThreads(mon, 2) < 0)
+        return -1;
+
+    /* any command which is not a query drops the cached replies */
+    if (qemuMonitorDelObject(mon, "iothread2", true) < 0)
+        return -1;
+
+    if (testQemuMonitorJSONReplyCacheGetIOThreads(mon, 1) < 0)
+        return -1;
+
+    /* a reply followed by an event which arrived before the caller woke up
+     * must not be cached as it may be outdated already */
+    if (qemuMonitorDelObject(mon, "iothread1", true) < 0 ||
+        testQemuMonitorJSONReplyCacheGetIOThreads(mon, 1) < 0 ||
+        testQemuMonitorJSONReplyCacheGetIOThreads(mon, 0) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+struct testQemuMonitorJSONPrefetchData {
+    char *heldID;
+    char *heldTypename;
+    bool bogusID;
+};
+
+
+static char *
+testQemuMonitorJSONPrefetchReply(const char *typename,
+                                 const char *id)
+{
+    return g_strdup_printf("{\"return\": [{\"name\": \"%s-prop\", \"type\": \"str\"}],"
+                           " \"id\": \"%s\"}", typename, id);
+}
+
+
+/* Holds back the reply to the first command and sends it after the reply to
+ * the second one, or replies with an ID matching no command if @bogusID */
+static int
+testQemuMonitorJSONPrefetchHandler(qemuMonitorTest *test,
+                                   qemuMonitorTestItem *item,
+                                   const char *cmdstr)
+{
+    struct testQemuMonitorJSONPrefetchData *data;
+    g_autoptr(virJSONValue) val = NULL;
+    g_autofree char *reply = NULL;
+    g_autofree char *heldReply = NULL;
+    const char *typename;
+    const char *id;
+
+    data = qemuMonitorTestItemGetPrivateData(item);
+
+    if (!(val = virJSONValueFromString(cmdstr)))
+        return -1;
+
+    if (!(id = virJSONValueObjectGetString(val, "id")))
+        return qemuMonitorTestAddErrorResponse(test, "Missing id in %s", cmdstr);
+
+    if (!(typename = virJSONValueObjectGetString(virJSONValueObjectGet(val, "arguments"),
+                                                 "typename")))
+        return qemuMonitorTestAddErrorResponse(test, "Missing typename in %s", cmdstr);
+
+    if (data->bogusID) {
+        reply = testQemuMonitorJSONPrefetchReply(typename, "bogus");
+        return qemuMonitorTestAddResponse(test, reply);
+    }
+
+    if (!data->heldID) {
+        data->heldID = g_strdup(id);
+        data->heldTypename = g_strdup(typename);
+        return 0;
+    }
+
+    reply = testQemuMonitorJSONPrefetchReply(typename, id);
+    heldReply = testQemuMonitorJSONPrefetchReply(data->heldTypename, data->heldID);
+
+    if (qemuMonitorTestAddResponse(test, reply) < 0 ||
+        qemuMonitorTestAddResponse(test, heldReply) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testQemuMonitorJSONPrefetchCheckProps(qemuMonitor *mon,
+                                      const char *device)
+{
+    g_autoptr(GHashTable) props = NULL;
+    g_autofree char *prop = g_strdup_printf("%s-prop", device);
+
+    if (!(props = qemuMonitorGetDeviceProps(mon, device)))
+        return -1;
+
+    if (g_hash_table_size(props) != 1 || !virHashLookup(props, prop)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "properties of '%s' don't match the device", device);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testQemuMonitorJSONPrefetch(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    struct testQemuMonitorJSONPrefetchData handlerData = { 0 };
+    g_autoptr(qemuMonitorTest) test = NULL;
+    const char *devices[] = { "virtio-blk-pci", "virtio-net-pci", NULL };
+    qemuMonitor *mon;
+    int ret = -1;
+
+    if (!(test = qemuMonitorTestNewSchema(data->xmlopt, data->schema)))
+        return -1;
+
+    mon = qemuMonitorTestGetMonitor(test);
+
+    qemuMonitorTestAddHandler(test, "device-list-properties",
+                              testQemuMonitorJSONPrefetchHandler,
+                              &handlerData, NULL);
+    qemuMonitorTestAddHandler(test, "device-list-properties",
+                              testQemuMonitorJSONPrefetchHandler,
+                              &handlerData, NULL);
+
+    /* replies are matched by their ID rather than by their order */
+    if (qemuMonitorPrefetchDeviceProps(mon, devices) < 0)
+        goto cleanup;
+
+    /* both replies must be served without talking to QEMU */
+    if (testQemuMonitorJSONPrefetchCheckProps(mon, "virtio-net-pci") < 0 ||
+        testQemuMonitorJSONPrefetchCheckProps(mon, "virtio-blk-pci") < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    g_free(handlerData.heldID);
+    g_free(handlerData.heldTypename);
+    return ret;
+}
+
+
+static int
+testQemuMonitorJSONPrefetchBogusID(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    struct testQemuMonitorJSONPrefetchData handlerData = { .bogusID = true };
+    g_autoptr(qemuMonitorTest) test = NULL;
+    const char *devices[] = { "virtio-blk-pci", NULL };
+
+    if (!(test = qemuMonitorTestNewSchema(data->xmlopt, data->schema)))
+        return -1;
+
+    qemuMonitorTestAddHandler(test, "device-list-properties",
+                              testQemuMonitorJSONPrefetchHandler,
+                              &handlerData, NULL);
+
+    /* a reply to no command sent must not be taken for another one's */
+    if (qemuMonitorPrefetchDeviceProps(qemuMonitorTestGetMonitor(test),
+                                       devices) == 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "reply with unknown ID was accepted");
+        return -1;
+    }
+
+    virResetLastError();
+    return 0;
+}
+
+
 static int
 testQemuMonitorJSONGetIOThreads(const void *opaque)
 {
@@ -3009,6 +3239,9 @@ mymain(void)
     DO_TEST(CPU);
     DO_TEST(GetNonExistingCPUData);
     DO_TEST(GetIOThreads);
+    DO_TEST(ReplyCache);
+    DO_TEST(Prefetch);
+    DO_TEST(PrefetchBogusID);
     DO_TEST(GetSEVInfo);
     DO_TEST(Transaction);
     DO_TEST(BlockExportAdd);
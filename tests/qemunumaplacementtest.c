@@ -0,0 +1,263 @@
+/*
+ * qemunumaplacementtest.c: Test automatic NUMA placement of domains
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#ifdef WITH_QEMU
+
+# include "internal.h"
+# include "qemu/qemu_numa_placement.h"
+
+# define VIR_FROM_THIS VIR_FROM_QEMU
+
+# define TEST_CELLS 4
+# define TEST_CPUS_IN_CELL 4
+# define TEST_GiB (1024ULL * 1024)
+
+/* Two sockets with two nodes each, nodes sharing a socket are close */
+static const unsigned int testDistances[TEST_CELLS][TEST_CELLS] = {
+    { 10, 12, 32, 32 },
+    { 12, 10, 32, 32 },
+    { 32, 32, 10, 12 },
+    { 32, 32, 12, 10 },
+};
+
+struct testInfo {
+    const char *name;
+    unsigned int vcpus;
+    unsigned long long memory;
+    unsigned long long memFree[TEST_CELLS];
+    double load[TEST_CELLS]; /* vCPUs of other domains pinned to each node */
+    const char *expected;
+    const char *current; /* nodes of a running domain */
+    bool move;
+};
+
+
+static qemuNumaPlacementHost *
+testBuildHost(const struct testInfo *info)
+{
+    g_autoptr(qemuNumaPlacementHost) host = g_new0(qemuNumaPlacementHost, 1);
+    size_t i;
+    size_t j;
+
+    host->numa = virCapabilitiesHostNUMANew();
+    host->memFree = g_new0(unsigned long long, TEST_CELLS);
+    host->ncpuLoad = TEST_CELLS * TEST_CPUS_IN_CELL;
+    host->cpuLoad = g_new0(double, host->ncpuLoad);
+
+    for (i = 0; i < TEST_CELLS; i++) {
+        virCapsHostNUMACellCPU *cpus = g_new0(virCapsHostNUMACellCPU,
+                                              TEST_CPUS_IN_CELL);
+        virNumaDistance *distances = g_new0(virNumaDistance, TEST_CELLS);
+
+        for (j = 0; j < TEST_CPUS_IN_CELL; j++) {
+            unsigned int id = i * TEST_CPUS_IN_CELL + j;
+
+            cpus[j].id = id;
+            cpus[j].socket_id = i / 2;
+            cpus[j].core_id = id;
+            host->cpuLoad[id] = info->load[i] / TEST_CPUS_IN_CELL;
+        }
+
+        for (j = 0; j < TEST_CELLS; j++) {
+            distances[j].cellid = j;
+            distances[j].value = testDistances[i][j];
+        }
+
+        virCapabilitiesHostNUMAAddCell(host->numa, i,
+                                       info->memFree[i],
+                                       TEST_CPUS_IN_CELL, &cpus,
+                                       TEST_CELLS, &distances,
+                                       0, NULL,
+                                       NULL);
+
+        host->memFree[i] = info->memFree[i];
+    }
+
+    return g_steal_pointer(&host);
+}
+
+
+static int
+testNumaPlacement(const void *opaque)
+{
+    const struct testInfo *info = opaque;
+    g_autoptr(qemuNumaPlacementHost) host = testBuildHost(info);
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autofree char *actual = NULL;
+
+    if (!(nodeset = qemuNumaPlacementCompute(host, info->vcpus, info->memory)))
+        return -1;
+
+    actual = virBitmapFormat(nodeset);
+
+    if (STRNEQ(actual, info->expected)) {
+        VIR_TEST_DEBUG("nodeset mismatch: expected '%s', got '%s'",
+                       info->expected, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testNumaRebalance(const void *opaque)
+{
+    const struct testInfo *info = opaque;
+    g_autoptr(qemuNumaPlacementHost) host = testBuildHost(info);
+    g_autoptr(virBitmap) current = NULL;
+    g_autoptr(virBitmap) advice = NULL;
+    bool move;
+
+    if (virBitmapParse(info->current, &current, TEST_CELLS) < 0)
+        return -1;
+
+    if (!(advice = qemuNumaPlacementCompute(host, info->vcpus, info->memory)))
+        return -1;
+
+    move = qemuNumaPlacementShouldMove(host, current, advice,
+                                       info->vcpus, info->memory);
+
+    if (move != info->move) {
+        g_autofree char *adviceStr = virBitmapFormat(advice);
+
+        VIR_TEST_DEBUG("move from '%s' to '%s': expected %d, got %d",
+                       info->current, adviceStr, info->move, move);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+# define DO_TEST(_name, _vcpus, _memory, _memFree, _load, _expected) \
+    do { \
+        static struct testInfo info = { \
+            .name = _name, \
+            .vcpus = _vcpus, \
+            .memory = _memory, \
+            .memFree = _memFree, \
+            .load = _load, \
+            .expected = _expected, \
+        }; \
+        if (virTestRun("NUMA placement " _name, \
+                       testNumaPlacement, &info) < 0) \
+            ret = -1; \
+    } while (0)
+
+# define DO_TEST_MOVE(_name, _vcpus, _memory, _memFree, _load, _current, _move) \
+    do { \
+        static struct testInfo info = { \
+            .name = _name, \
+            .vcpus = _vcpus, \
+            .memory = _memory, \
+            .memFree = _memFree, \
+            .load = _load, \
+            .current = _current, \
+            .move = _move, \
+        }; \
+        if (virTestRun("NUMA rebalance " _name, \
+                       testNumaRebalance, &info) < 0) \
+            ret = -1; \
+    } while (0)
+
+# define MEM(a, b, c, d) { (a) * TEST_GiB, (b) * TEST_GiB, \
+                          (c) * TEST_GiB, (d) * TEST_GiB }
+# define LOAD(a, b, c, d) { a, b, c, d }
+
+    /* fits into a single node, the one with most free memory wins */
+    DO_TEST("single-node", 2, 4 * TEST_GiB,
+            MEM(8, 8, 16, 8), LOAD(0, 0, 0, 0), "2");
+
+    /* equally free nodes, the least loaded one wins */
+    DO_TEST("single-node-load", 4, 4 * TEST_GiB,
+            MEM(8, 8, 8, 8), LOAD(8, 2, 4, 6), "1");
+
+    /* a node which can't hold the memory is skipped even if idle */
+    DO_TEST("single-node-mem", 2, 6 * TEST_GiB,
+            MEM(4, 8, 4, 4), LOAD(0, 8, 0, 0), "1");
+
+    /* too many vCPUs for one node, stay within a socket */
+    DO_TEST("vcpus-socket", 8, 2 * TEST_GiB,
+            MEM(8, 8, 8, 8), LOAD(4, 4, 0, 0), "2-3");
+
+    /* too much memory for one node, stay within a socket */
+    DO_TEST("memory-socket", 2, 12 * TEST_GiB,
+            MEM(8, 8, 6, 6), LOAD(0, 0, 0, 0), "0-1");
+
+    /* a socket does not have enough memory, cross to the nearest one */
+    DO_TEST("memory-cross", 2, 20 * TEST_GiB,
+            MEM(8, 8, 6, 6), LOAD(0, 0, 0, 0), "0-2");
+
+    /* free hugepages are sparse, only one node can back the domain */
+    DO_TEST("hugepages", 2, 2 * TEST_GiB,
+            MEM(0, 1, 0, 2), LOAD(0, 0, 0, 0), "3");
+
+    /* more vCPUs than host CPUs, keep the memory local */
+    DO_TEST("overcommit", 32, 4 * TEST_GiB,
+            MEM(8, 8, 8, 8), LOAD(0, 0, 0, 0), "0-3");
+
+    /* the domain does not fit anywhere */
+    DO_TEST("no-fit", 2, 64 * TEST_GiB,
+            MEM(8, 8, 8, 8), LOAD(0, 0, 0, 0), "0-3");
+
+    /* Free memory below includes memory of the running domain itself. */
+
+    /* already at the best place */
+    DO_TEST_MOVE("stay", 2, 4 * TEST_GiB,
+                 MEM(8, 4, 4, 4), LOAD(0, 0, 0, 0), "0", false);
+
+    /* slightly less loaded node elsewhere is not worth the move */
+    DO_TEST_MOVE("stay-small-gain", 4, 4 * TEST_GiB,
+                 MEM(8, 8, 8, 8), LOAD(1, 0, 1, 1), "0", false);
+
+    /* the current node got crowded by other domains */
+    DO_TEST_MOVE("move-load", 4, 4 * TEST_GiB,
+                 MEM(8, 8, 8, 8), LOAD(8, 2, 4, 6), "0", true);
+
+    /* spread over both sockets while one socket has room now */
+    DO_TEST_MOVE("move-distance", 2, 12 * TEST_GiB,
+                 MEM(8, 4, 8, 2), LOAD(0, 0, 0, 0), "0,2", true);
+
+    /* nowhere to go */
+    DO_TEST_MOVE("no-fit", 2, 64 * TEST_GiB,
+                 MEM(8, 8, 8, 8), LOAD(0, 0, 0, 0), "0", false);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+
+#else
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WITH_QEMU */
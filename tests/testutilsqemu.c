@@ -226,7 +226,8 @@ qemuTestParseCapabilitiesArch(virArch arch,
                                               virArchToString(arch));
     g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(binary);
 
-    if (virQEMUCapsLoadCache(arch, qemuCaps, capsFile, true) < 0)
+    if (!qemuCaps ||
+        virQEMUCapsLoadCache(arch, qemuCaps, capsFile, true) < 0)
         return NULL;
 
     return g_steal_pointer(&qemuCaps);
@@ -952,7 +953,8 @@ testQemuInfoInitArgs(testQemuInfo *info)
         if (!info->qemuCaps)
             return -1;
     } else {
-        info->qemuCaps = virQEMUCapsNew();
+        if (!(info->qemuCaps = virQEMUCapsNew()))
+            return -1;
     }
 
     for (cap = -1; (cap = virBitmapNextSetBit(info->args.fakeCapsAdd, cap)) >= 0;)
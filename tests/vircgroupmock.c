@@ -149,6 +149,15 @@ static int make_controller_v1(const char *path, mode_t mode)
         MAKE_FILE("memory.memsw.limit_in_bytes", ""); /* Not supported */
         MAKE_FILE("memory.memsw.usage_in_bytes", ""); /* Not supported */
         MAKE_FILE("memory.soft_limit_in_bytes", "9223372036854775807\n");
+        MAKE_FILE("memory.numa_stat",
+                  "total=56093 N0=40000 N1=16093\n"
+                  "file=26150 N0=20000 N1=6150\n"
+                  "anon=29043 N0=19100 N1=9943\n"
+                  "unevictable=900 N0=900 N1=0\n"
+                  "hierarchical_total=56093 N0=40000 N1=16093\n"
+                  "hierarchical_file=26150 N0=20000 N1=6150\n"
+                  "hierarchical_anon=29043 N0=19100 N1=9943\n"
+                  "hierarchical_unevictable=900 N0=900 N1=0\n");
         MAKE_FILE("memory.stat",
                   "cache 1336619008\n"
                   "rss 97792000\n"
@@ -31,6 +31,7 @@
 # include "virbuffer.h"
 # include "testutilslxc.h"
 # include "virhostcpu.h"
+# include "virutil.h"
 
 # define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -786,6 +787,39 @@ static int testCgroupGetMemoryUsage(const void *args G_GNUC_UNUSED)
 }
 
 
+static int testCgroupGetValueReread(const void *args G_GNUC_UNUSED)
+{
+    g_autoptr(virCgroup) cgroup = NULL;
+    unsigned long long shares;
+    unsigned long long values[] = { 2048, 4096, 512 };
+    size_t i;
+    int rv;
+
+    if ((rv = virCgroupNewPartition("/virtualmachines", true,
+                                    (1 << VIR_CGROUP_CONTROLLER_CPU),
+                                    &cgroup)) < 0) {
+        fprintf(stderr, "Could not create /virtualmachines cgroup: %d\n", -rv);
+        return -1;
+    }
+
+    /* the file is kept open between reads, which must still see
+     * every update */
+    for (i = 0; i < G_N_ELEMENTS(values); i++) {
+        if (virCgroupSetCpuShares(cgroup, values[i]) < 0 ||
+            virCgroupGetCpuShares(cgroup, &shares) < 0)
+            return -1;
+
+        if (shares != values[i]) {
+            fprintf(stderr, "Wrong value from virCgroupGetCpuShares "
+                    "(expected %llu, got %llu)\n", values[i], shares);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 testCgroupGetMemoryStat(const void *args G_GNUC_UNUSED)
 {
@@ -841,6 +875,50 @@ testCgroupGetMemoryStat(const void *args G_GNUC_UNUSED)
 }
 
 
+static int
+testCgroupGetMemoryNumaStat(const void *args G_GNUC_UNUSED)
+{
+    g_autoptr(virCgroup) cgroup = NULL;
+    g_autofree unsigned long long *nodes = NULL;
+    size_t nnodes = 0;
+    const unsigned long long expected_pages[] = { 19100, 9943 };
+    unsigned long long pageSizeKB = virGetSystemPageSizeKB();
+    size_t i;
+    int rv;
+
+    if ((rv = virCgroupNewPartition("/virtualmachines", true,
+                                    (1 << VIR_CGROUP_CONTROLLER_MEMORY),
+                                    &cgroup)) < 0) {
+        fprintf(stderr, "Could not create /virtualmachines cgroup: %d\n", -rv);
+        return -1;
+    }
+
+    if (virCgroupGetMemoryNumaStat(cgroup, &nodes, &nnodes) < 0) {
+        fprintf(stderr, "Could not retrieve GetMemoryNumaStat for /virtualmachines cgroup\n");
+        return -1;
+    }
+
+    if (nnodes != G_N_ELEMENTS(expected_pages)) {
+        fprintf(stderr, "Wrong number of nodes (%zu) from virCgroupGetMemoryNumaStat "
+                "(expected %zu)\n", nnodes, G_N_ELEMENTS(expected_pages));
+        return -1;
+    }
+
+    for (i = 0; i < nnodes; i++) {
+        /* NB: virCgroupGetMemoryNumaStat returns a KiB scaled value */
+        if (expected_pages[i] * pageSizeKB != nodes[i]) {
+            fprintf(stderr,
+                    "Wrong value (%llu) for node %zu from virCgroupGetMemoryNumaStat "
+                    "(expected %llu)\n",
+                    nodes[i], i, expected_pages[i] * pageSizeKB);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int testCgroupGetBlkioIoServiced(const void *args G_GNUC_UNUSED)
 {
     g_autoptr(virCgroup) cgroup = NULL;
@@ -1058,6 +1136,12 @@ mymain(void)
     if (virTestRun("virCgroupGetMemoryStat works", testCgroupGetMemoryStat, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("virCgroupGetMemoryNumaStat works", testCgroupGetMemoryNumaStat, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("virCgroupGetValue rereads", testCgroupGetValueReread, NULL) < 0)
+        ret = -1;
+
     if (virTestRun("virCgroupGetPercpuStats works", testCgroupGetPercpuStats, NULL) < 0)
         ret = -1;
     cleanupFakeFS(fakerootdir);
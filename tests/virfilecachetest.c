@@ -80,6 +80,8 @@ struct _testFileCachePriv {
     bool dataSaved;
     const char *newData;
     const char *expectData;
+    int newDataCount;
+    unsigned long newDataDelay; /* microseconds */
 };
 typedef struct _testFileCachePriv testFileCachePriv;
 
@@ -101,6 +103,11 @@ testFileCacheNewData(const char *name G_GNUC_UNUSED,
 {
     testFileCachePriv *testPriv = priv;
 
+    g_atomic_int_inc(&testPriv->newDataCount);
+
+    if (testPriv->newDataDelay)
+        g_usleep(testPriv->newDataDelay);
+
     return testFileCacheObjNew(testPriv->newData);
 }
 
@@ -192,6 +199,86 @@ testFileCache(const void *opaque)
 }
 
 
+#define TEST_CONCURRENT_THREADS 4
+
+struct _testFileCacheThread {
+    virFileCache *cache;
+    const char *name;
+    testFileCacheObj *obj;
+};
+typedef struct _testFileCacheThread testFileCacheThread;
+
+
+static void
+testFileCacheLookupThread(void *opaque)
+{
+    testFileCacheThread *thr = opaque;
+
+    thr->obj = virFileCacheLookup(thr->cache, thr->name);
+}
+
+
+static int
+testFileCacheConcurrent(const void *opaque)
+{
+    int ret = -1;
+    const testFileCacheData *data = opaque;
+    testFileCachePriv *testPriv = virFileCacheGetPriv(data->cache);
+    testFileCacheThread thr[TEST_CONCURRENT_THREADS] = { 0 };
+    virThread threads[TEST_CONCURRENT_THREADS];
+    size_t nthreads = 0;
+    size_t i;
+
+    testPriv->dataSaved = false;
+    testPriv->newData = data->newData;
+    testPriv->expectData = data->expectData;
+    testPriv->newDataCount = 0;
+    /* give concurrent lookups a chance to wait for the first one */
+    testPriv->newDataDelay = 50 * 1000;
+
+    for (i = 0; i < TEST_CONCURRENT_THREADS; i++) {
+        thr[i].cache = data->cache;
+        thr[i].name = data->name;
+
+        if (virThreadCreate(&threads[i], true,
+                            testFileCacheLookupThread, &thr[i]) < 0) {
+            fprintf(stderr, "Failed to create lookup thread.\n");
+            break;
+        }
+        nthreads++;
+    }
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    if (nthreads != TEST_CONCURRENT_THREADS)
+        goto cleanup;
+
+    for (i = 0; i < nthreads; i++) {
+        if (!thr[i].obj || STRNEQ_NULLABLE(data->expectData, thr[i].obj->data)) {
+            fprintf(stderr, "Expect data '%s', thread %zu got '%s'.\n",
+                    data->expectData, i,
+                    thr[i].obj ? NULLSTR(thr[i].obj->data) : "(null)");
+            goto cleanup;
+        }
+    }
+
+    if (testPriv->newDataCount != 1) {
+        fprintf(stderr, "Expect data to be created once, created %d times.\n",
+                testPriv->newDataCount);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    testPriv->newDataDelay = 0;
+    for (i = 0; i < nthreads; i++)
+        virObjectUnref(thr[i].obj);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -220,6 +307,14 @@ mymain(void)
     TEST_RUN("cacheInvalid", "bbb\n", "bbb\n", true);
     TEST_RUN("cacheMissing", "ccc\n", "ccc\n", true);
 
+    {
+        testFileCacheData data = {
+            cache, "cacheConcurrent", "ddd\n", "ddd\n", true
+        };
+        if (virTestRun("cacheConcurrent", testFileCacheConcurrent, &data) < 0)
+            ret = -1;
+    }
+
     virObjectUnref(cache);
 
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
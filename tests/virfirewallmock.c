@@ -18,9 +18,17 @@
 
 #include "internal.h"
 #include "virfirewalld.h"
+#include "virfirewall.h"
 
 int
 virFirewallDIsRegistered(void)
 {
     return -2;
 }
+
+bool
+virFirewallNftablesUseLibrary(void)
+{
+    /* nft commands need to go through virCommand dry run */
+    return false;
+}
@@ -763,6 +763,59 @@ testFirewallQuery(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testFirewallNftablesBatch(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_NFTABLES);
+    const char *actual = NULL;
+    const char *expected =
+        NFT " insert rule ip libvirt_network guest_output iif virbr0 counter reject"
+        " ';' insert rule ip libvirt_network guest_input oif virbr0 counter reject"
+        " ';' insert rule ip6 libvirt_network guest_output iif virbr0 counter reject\n"
+        NFT " delete chain ip libvirt_network guest_cross\n"
+        NFT " insert rule ip libvirt_network guest_cross iif virbr0 oif virbr0 counter accept\n";
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+
+    virCommandSetDryRun(dryRunToken, &cmdbuf, false, false, NULL, NULL);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_BATCH);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "insert", "rule", "ip", "libvirt_network", "guest_output",
+                      "iif", "virbr0", "counter", "reject", NULL);
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "insert", "rule", "ip", "libvirt_network", "guest_input",
+                      "oif", "virbr0", "counter", "reject", NULL);
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV6,
+                      "insert", "rule", "ip6", "libvirt_network", "guest_output",
+                      "iif", "virbr0", "counter", "reject", NULL);
+
+    /* commands with ignored errors must be run on their own */
+    virFirewallAddCmdFull(fw, VIR_FIREWALL_LAYER_IPV4,
+                          true, NULL, NULL,
+                          "delete", "chain", "ip", "libvirt_network",
+                          "guest_cross", NULL);
+
+    /* as does a lone command */
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "insert", "rule", "ip", "libvirt_network", "guest_cross",
+                      "iif", "virbr0", "oif", "virbr0", "counter", "accept", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        return -1;
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (virTestCompareToString(expected, actual) < 0) {
+        fprintf(stderr, "Unexpected command execution\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -784,6 +837,7 @@ mymain(void)
     RUN_TEST("many rollback", testFirewallManyRollback);
     RUN_TEST("chained rollback", testFirewallChainedRollback);
     RUN_TEST("query transaction", testFirewallQuery);
+    RUN_TEST("nftables batch", testFirewallNftablesBatch);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
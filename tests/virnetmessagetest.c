@@ -510,6 +510,72 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static int testMessagePayloadStreamEncodeInPlace(const void *args G_GNUC_UNUSED)
+{
+    const char *stream = "The quick brown fox jumps over the lazy dog";
+    virNetMessage *msg = virNetMessageNew(true);
+    static const char expect[] = {
+        0x00, 0x00, 0x00, 0x2b,  /* Length */
+        0x11, 0x22, 0x33, 0x44,  /* Program */
+        0x00, 0x00, 0x00, 0x01,  /* Version */
+        0x00, 0x00, 0x06, 0x66,  /* Procedure */
+        0x00, 0x00, 0x00, 0x03,  /* Type */
+        0x00, 0x00, 0x00, 0x99,  /* Serial */
+        0x00, 0x00, 0x00, 0x02,  /* Status */
+
+        'T', 'h', 'e', ' ',
+        'q', 'u', 'i', 'c',
+        'k', ' ', 'b', 'r',
+        'o', 'w', 'n',
+    };
+    char *buf;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    /* Reserve room for the whole string but fill in only its start */
+    if (!(buf = virNetMessageEncodePayloadRawBuffer(msg, strlen(stream))))
+        goto cleanup;
+
+    memcpy(buf, stream, 15);
+
+    if (virNetMessageEncodePayloadRaw(msg, buf, 15) < 0)
+        goto cleanup;
+
+    if (G_N_ELEMENTS(expect) != msg->bufferLength) {
+        VIR_DEBUG("Expect message length %zu got %zu",
+                  sizeof(expect), msg->bufferLength);
+        goto cleanup;
+    }
+
+    if (msg->bufferOffset != 0) {
+        VIR_DEBUG("Expect message offset 0 got %zu",
+                  msg->bufferOffset);
+        goto cleanup;
+    }
+
+    if (memcmp(expect, msg->buffer, sizeof(expect)) != 0) {
+        virTestDifferenceBin(stderr, expect, msg->buffer, sizeof(expect));
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
 
 static int
 mymain(void)
@@ -535,6 +601,10 @@ mymain(void)
     if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Payload Stream Encode In Place",
+                   testMessagePayloadStreamEncodeInPlace, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -65,6 +65,72 @@ test_virResctrlGetUnused(const void *opaque)
 }
 
 
+struct virResctrlShareData {
+    unsigned int min_bits;
+    size_t nshares;
+    virResctrlShare shares[4];
+    unsigned int expected[4];
+};
+
+
+static int
+test_virResctrlShareCompute(const void *opaque)
+{
+    const struct virResctrlShareData *data = opaque;
+    virResctrlShare shares[4];
+    size_t i;
+
+    memcpy(shares, data->shares, sizeof(shares));
+
+    virResctrlShareCompute(shares, data->nshares, data->min_bits);
+
+    for (i = 0; i < data->nshares; i++) {
+        if (shares[i].target != data->expected[i]) {
+            VIR_TEST_DEBUG("share %zu: expected %u bits, got %u",
+                           i, data->expected[i], shares[i].target);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Runs the computation once more with the targets of the first round
+ * assigned, as the scheduler would, and checks that nothing changes.
+ */
+static int
+test_virResctrlShareComputeStable(const void *opaque)
+{
+    const struct virResctrlShareData *data = opaque;
+    virResctrlShare shares[4];
+    size_t i;
+
+    if (test_virResctrlShareCompute(opaque) < 0)
+        return -1;
+
+    memcpy(shares, data->shares, sizeof(shares));
+
+    for (i = 0; i < data->nshares; i++) {
+        shares[i].current = data->expected[i];
+        shares[i].used = MIN(shares[i].used, shares[i].current);
+    }
+
+    virResctrlShareCompute(shares, data->nshares, data->min_bits);
+
+    for (i = 0; i < data->nshares; i++) {
+        if (shares[i].target != data->expected[i]) {
+            VIR_TEST_DEBUG("share %zu: expected %u bits in the next round, got %u",
+                           i, data->expected[i], shares[i].target);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -86,6 +152,79 @@ mymain(void)
     DO_TEST_UNUSED("resctrl-amd");
     DO_TEST_UNUSED("resctrl-mba_MBps");
 
+#define SHARE(_configured, _current, _used) \
+    { .configured = _configured, .current = _current, \
+      .used = _used, .monitored = true }
+#define SHARE_UNMONITORED(_configured, _current) \
+    { .configured = _configured, .current = _current }
+#define SHARES(...) { __VA_ARGS__ }
+#define BITS(...) { __VA_ARGS__ }
+
+#define DO_TEST_SHARE_FULL(_name, _func, _min_bits, _nshares, _shares, _expected) \
+    do { \
+        static struct virResctrlShareData share = { \
+            .min_bits = _min_bits, \
+            .nshares = _nshares, \
+            .shares = _shares, \
+            .expected = _expected, \
+        }; \
+        if (virTestRun("Share: " _name, _func, &share) < 0) \
+            ret = -1; \
+    } while (0)
+
+#define DO_TEST_SHARE(_name, _min_bits, _nshares, _shares, _expected) \
+    DO_TEST_SHARE_FULL(_name, test_virResctrlShareCompute, \
+                       _min_bits, _nshares, _shares, _expected)
+
+#define DO_TEST_SHARE_STABLE(_name, _min_bits, _nshares, _shares, _expected) \
+    DO_TEST_SHARE_FULL(_name, test_virResctrlShareComputeStable, \
+                       _min_bits, _nshares, _shares, _expected)
+
+    /* without monitoring the configured sizes are kept */
+    DO_TEST_SHARE("unmonitored", 1, 2,
+                  SHARES(SHARE_UNMONITORED(4, 4), SHARE_UNMONITORED(4, 4)),
+                  BITS(4, 4));
+
+    /* a busy allocation borrows from an idle one */
+    DO_TEST_SHARE("borrow", 1, 2,
+                  SHARES(SHARE(4, 4, 1), SHARE(4, 4, 4)),
+                  BITS(2, 6));
+
+    /* the idle allocation never goes below the minimum */
+    DO_TEST_SHARE("borrow-min", 2, 2,
+                  SHARES(SHARE(2, 2, 0), SHARE(6, 6, 6)),
+                  BITS(2, 6));
+
+    /* busy allocations borrow in proportion to their configured sizes */
+    DO_TEST_SHARE("borrow-weighted", 1, 3,
+                  SHARES(SHARE(8, 8, 0), SHARE(2, 2, 2), SHARE(6, 6, 6)),
+                  BITS(4, 3, 9));
+
+    /* an allocation in use keeps what it borrowed */
+    DO_TEST_SHARE("keep", 1, 2,
+                  SHARES(SHARE(4, 2, 0), SHARE(4, 6, 4)),
+                  BITS(2, 6));
+
+    /* an allocation which needs its cache again gets it back */
+    DO_TEST_SHARE("reclaim", 1, 2,
+                  SHARES(SHARE(4, 2, 2), SHARE(4, 6, 6)),
+                  BITS(4, 4));
+
+    /* nobody needs the cache, give it back */
+    DO_TEST_SHARE("return", 1, 2,
+                  SHARES(SHARE(4, 2, 0), SHARE(4, 6, 1)),
+                  BITS(4, 4));
+
+    /* a shrunk allocation using between a quarter and a half of its
+     * configured size stays idle */
+    DO_TEST_SHARE_STABLE("stable-idle", 1, 2,
+                         SHARES(SHARE(8, 8, 3), SHARE(8, 8, 8)),
+                         BITS(4, 12));
+
+    DO_TEST_SHARE_STABLE("stable-borrow", 1, 2,
+                         SHARES(SHARE(4, 4, 1), SHARE(4, 4, 4)),
+                         BITS(2, 6));
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -0,0 +1,52 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "virmock.h"
+
+static int (*real_access)(const char *path, int mode);
+
+
+static void
+init_syms(void)
+{
+    if (real_access)
+        return;
+
+    VIR_MOCK_REAL_INIT(access);
+}
+
+
+/* Fails every access check of a path ending with the value of
+ * VIR_STORAGE_TEST_DENY_ACCESS so that tests can verify that no check
+ * was done. */
+int
+access(const char *path, int mode)
+{
+    const char *deny = getenv("VIR_STORAGE_TEST_DENY_ACCESS");
+
+    init_syms();
+
+    if (deny && g_str_has_suffix(path, deny)) {
+        errno = EACCES;
+        return -1;
+    }
+
+    return real_access(path, mode);
+}
@@ -432,6 +432,41 @@ testBackingParse(const void *args)
 }
 
 
+/* Reading a backing image header from the cache must not check access of the
+ * backing image again as that forks when probing as a different user. The
+ * mock fails any such check. */
+static int
+testStorageChainCachedAccess(const void *args G_GNUC_UNUSED)
+{
+    const char *start = abs_srcdir "/virstoragetestdata/images/qcow2_raw-raw-relative.qcow2";
+    g_autoptr(virStorageSource) meta = NULL;
+    int ret = -1;
+
+    if (!(meta = testStorageFileGetMetadata(start, VIR_STORAGE_FILE_QCOW2, -1, -1)))
+        return -1;
+    g_clear_pointer(&meta, virObjectUnref);
+
+    g_setenv("VIR_STORAGE_TEST_DENY_ACCESS", "/virstoragetestdata/images/raw", true);
+
+    if (!(meta = testStorageFileGetMetadata(start, VIR_STORAGE_FILE_QCOW2, -1, -1))) {
+        fprintf(stderr, "cached backing image header was access checked\n");
+        goto cleanup;
+    }
+
+    if (!meta->backingStore ||
+        meta->backingStore->format != VIR_STORAGE_FILE_RAW) {
+        fprintf(stderr, "unexpected backing chain from cached header\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    g_unsetenv("VIR_STORAGE_TEST_DENY_ACCESS");
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -475,6 +510,10 @@ mymain(void)
                abs_srcdir "/virstoragetestdata/images/qcow2_raw-raw-relative.qcow2",
                VIR_STORAGE_FILE_AUTO, EXP_PASS);
 
+    if (virTestRun("qcow2-qcow2_raw-raw-relative cached access",
+                   testStorageChainCachedAccess, NULL) < 0)
+        ret = -1;
+
     /* qcow2 chain with absolute backing formatted with a real qemu-img */
 
     /* Prep some files with qemu-img; if that is not found on PATH, the test
@@ -1234,4 +1273,4 @@ mymain(void)
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-VIR_TEST_MAIN(mymain)
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virstorage"))